@@ -0,0 +1,328 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "console.h"
+#include "metric_ring.h"
+#include "pseudographic_text.h"
+#include "trace.h"
+
+// Block elements as UTF-8 bytes, so the narrow execution charset does not matter
+static inline const char* const verticalEighths[9] = { " ",
+	"\xE2\x96\x81", "\xE2\x96\x82", "\xE2\x96\x83", "\xE2\x96\x84", "\xE2\x96\x85", "\xE2\x96\x86", "\xE2\x96\x87", "\xE2\x96\x88" };
+static inline const char* const horizontalEighths[9] = { " ",
+	"\xE2\x96\x8F", "\xE2\x96\x8E", "\xE2\x96\x8D", "\xE2\x96\x8C", "\xE2\x96\x8B", "\xE2\x96\x8A", "\xE2\x96\x89", "\xE2\x96\x88" };
+
+// Cell grid that remembers what is on screen and re-emits only changed cells
+class ChartSurface {
+	int width, height;
+	std::vector<std::string> cells, shown;
+	bool shownValid = false;
+
+public:
+	ChartSurface(int width, int height) : width(width), height(height),
+		cells(static_cast<std::size_t>(width) * height, " "), shown(cells.size()) {
+
+	}
+
+	int getWidth() const {
+		return this->width;
+	}
+
+	int getHeight() const {
+		return this->height;
+	}
+
+	void set(int x, int y, const std::string& glyph) {
+		if (x >= 0 && y >= 0 && x < this->width && y < this->height) {
+			this->cells[static_cast<std::size_t>(y) * this->width + x] = glyph;
+		}
+	}
+
+	// Moves rows [0, rows) one cell to the left and blanks the last column
+	void scrollLeft(int rows) {
+		for (int y = 0; y < std::min(rows, this->height); y++) {
+			auto row = this->cells.begin() + static_cast<std::ptrdiff_t>(y) * this->width;
+			std::rotate(row, row + 1, row + this->width);
+			row[this->width - 1] = " ";
+		}
+	}
+
+	void text(int x, int y, const std::string& str) {
+		for (int i = 0; i < static_cast<int>(str.size()); i++) {
+			this->set(x + i, y, std::string(1, str[i]));
+		}
+	}
+
+	std::size_t present(int line, int column, Color color) {
+		Console::enableUtf8();
+		Console::setColor(color);
+		std::size_t emitted = 0;
+		std::string run;
+		for (int y = 0; y < this->height; y++) {
+			const std::size_t base = static_cast<std::size_t>(y) * this->width;
+			int x = 0;
+			while (x < this->width) {
+				if (this->shownValid && this->cells[base + x] == this->shown[base + x]) {
+					x++;
+					continue;
+				}
+				Console::setCursor(line + y, column + x);
+				while (x < this->width && (!this->shownValid || this->cells[base + x] != this->shown[base + x])) {
+					run += this->cells[base + x];
+					this->shown[base + x] = this->cells[base + x];
+					emitted++;
+					x++;
+				}
+				Console::write(run);
+				run.clear();
+			}
+		}
+		this->shownValid = true;
+		Console::resetColor();
+		Console::flush();
+		return emitted;
+	}
+};
+
+// A widget with a big-font banner above its chart area.
+// refresh() reads at most maxSamples values from the rings, so one refresh has a bounded cost
+// however fast the producers are.
+class Chart {
+protected:
+	PseudographicText banner;
+	ChartSurface surface;
+	Color color;
+	std::size_t maxSamples;
+	bool bannerShown = false;
+
+public:
+	Chart(const std::string& title, int width, int height, Color color, std::size_t maxSamples) :
+		banner(title, '#', ' ', FontSize::Small, color), surface(width, height), color(color), maxSamples(maxSamples) {
+
+	}
+
+	virtual ~Chart() {
+
+	}
+
+	virtual void refresh() = 0;
+
+	// Prints the banner once, then only the changed chart cells; returns the number of cells written
+	std::size_t present(int line, int column) {
+		TRACE_SCOPE("Chart::present", "text");
+		if (!this->bannerShown) {
+			this->banner.print(line, column);
+			this->bannerShown = true;
+		}
+		return this->surface.present(line + this->banner.height() + 1, column, this->color);
+	}
+
+	int height() const {
+		return this->banner.height() + 1 + this->surface.getHeight();
+	}
+
+protected:
+	static std::string formatValue(double value) {
+		char buffer[32];
+		std::snprintf(buffer, sizeof(buffer), "%.4g", value);
+		return buffer;
+	}
+};
+
+// Scrolling line of column heights: each refresh appends the mean of the new samples
+// and shifts the window left by one column. Only the new column is drawn unless the
+// window maximum, and with it the scale of every column, has changed
+class Sparkline : public Chart {
+	MetricRing<double>& ring;
+	std::vector<double> columns;
+	int start = 0, filled = 0;
+	double drawnTop = -1;
+
+public:
+	Sparkline(const std::string& title, MetricRing<double>& ring, int width = 60, int height = 4,
+		Color color = Color::BrightCyan, std::size_t maxSamples = 4096) :
+		Chart(title, width, height + 1, color, maxSamples), ring(ring), columns(width, 0.0) {
+
+	}
+
+	void refresh() override {
+		TRACE_SCOPE("Sparkline::refresh", "text");
+		double sum = 0;
+		std::size_t count = this->ring.consume([&sum](double value) { sum += value; }, this->maxSamples);
+		if (count == 0) {
+			return;
+		}
+
+		const int width = static_cast<int>(this->columns.size());
+		const int rows = this->surface.getHeight() - 1;
+		bool scrolled = false;
+		if (this->filled < width) {
+			this->columns[(this->start + this->filled) % width] = sum / count;
+			this->filled++;
+		}
+		else {
+			this->columns[this->start] = sum / count;
+			this->start = (this->start + 1) % width;
+			scrolled = true;
+		}
+
+		double top = 0;
+		for (int i = 0; i < this->filled; i++) {
+			top = std::max(top, this->columns[(this->start + i) % width]);
+		}
+
+		if (top != this->drawnTop) {
+			for (int x = 0; x < width; x++) {
+				this->drawColumn(x, top, rows);
+			}
+			this->drawnTop = top;
+		}
+		else {
+			if (scrolled) {
+				this->surface.scrollLeft(rows);
+			}
+			this->drawColumn(this->filled - 1, top, rows);
+		}
+		this->drawCaption(top, rows);
+	}
+
+private:
+	void drawColumn(int x, double top, int rows) {
+		const int width = static_cast<int>(this->columns.size());
+		int eighths = 0;
+		if (x < this->filled && top > 0) {
+			eighths = static_cast<int>(this->columns[(this->start + x) % width] / top * rows * 8 + 0.5);
+		}
+		for (int y = 0; y < rows; y++) {
+			int level = std::clamp(eighths - (rows - 1 - y) * 8, 0, 8);
+			this->surface.set(x, y, verticalEighths[level]);
+		}
+	}
+
+	void drawCaption(double top, int rows) {
+		const int width = static_cast<int>(this->columns.size());
+		std::string caption = "last " + formatValue(this->columns[(this->start + this->filled - 1) % width]) + "  max " + formatValue(top);
+		caption.resize(width, ' ');
+		this->surface.text(0, rows, caption);
+	}
+};
+
+// Horizontal bars, one per ring; a bar shows the mean of the samples read on the last refresh
+class BarChart : public Chart {
+	struct Bar {
+		std::string label;
+		MetricRing<double>* ring;
+		double value;
+	};
+
+	std::vector<Bar> bars;
+	int labelWidth = 0;
+
+public:
+	BarChart(const std::string& title, int width = 60, int maxBars = 8, Color color = Color::BrightGreen, std::size_t maxSamples = 4096) :
+		Chart(title, width, maxBars, color, maxSamples) {
+
+	}
+
+	void addBar(const std::string& label, MetricRing<double>& ring) {
+		if (static_cast<int>(this->bars.size()) < this->surface.getHeight()) {
+			this->bars.push_back({ label, &ring, 0.0 });
+			this->labelWidth = std::max(this->labelWidth, static_cast<int>(label.size()));
+		}
+	}
+
+	void refresh() override {
+		TRACE_SCOPE("BarChart::refresh", "text");
+		for (Bar& bar : this->bars) {
+			double sum = 0;
+			std::size_t count = bar.ring->consume([&sum](double value) { sum += value; }, this->maxSamples);
+			if (count) {
+				bar.value = sum / count;
+			}
+		}
+
+		double top = 0;
+		for (const Bar& bar : this->bars) {
+			top = std::max(top, bar.value);
+		}
+
+		const int valueWidth = 10;
+		const int barWidth = std::max(1, this->surface.getWidth() - this->labelWidth - valueWidth - 2);
+		for (int y = 0; y < static_cast<int>(this->bars.size()); y++) {
+			const Bar& bar = this->bars[y];
+			std::string label = bar.label;
+			label.resize(this->labelWidth, ' ');
+			this->surface.text(0, y, label);
+
+			int eighths = top > 0 ? static_cast<int>(bar.value / top * barWidth * 8 + 0.5) : 0;
+			for (int x = 0; x < barWidth; x++) {
+				this->surface.set(this->labelWidth + 1 + x, y, horizontalEighths[std::clamp(eighths - x * 8, 0, 8)]);
+			}
+
+			std::string value = formatValue(bar.value);
+			value.resize(valueWidth, ' ');
+			this->surface.text(this->labelWidth + 2 + barWidth, y, value);
+		}
+	}
+};
+
+// Fixed-range histogram; counts only grow, so each refresh bins just the new samples
+class Histogram : public Chart {
+	MetricRing<double>& ring;
+	std::vector<std::size_t> counts;
+	double low, high;
+	std::size_t total = 0;
+
+public:
+	Histogram(const std::string& title, MetricRing<double>& ring, double low, double high, int bins = 40, int height = 6,
+		Color color = Color::BrightYellow, std::size_t maxSamples = 4096) :
+		Chart(title, checkedBins(bins), height + 1, color, maxSamples), ring(ring), counts(bins, 0), low(low), high(high) {
+		if (!(high > low)) {
+			throw std::invalid_argument("Histogram range must have high > low");
+		}
+	}
+
+	void refresh() override {
+		TRACE_SCOPE("Histogram::refresh", "text");
+		const int bins = static_cast<int>(this->counts.size());
+		const double scale = bins / (this->high - this->low);
+		// NaN has no bin; everything else is clamped to the edge bins before the cast to int
+		this->ring.consume([this, bins, scale](double value) {
+			if (std::isnan(value)) {
+				return;
+			}
+			const double bin = std::clamp((value - this->low) * scale, 0.0, static_cast<double>(bins - 1));
+			this->counts[static_cast<int>(bin)]++;
+			this->total++;
+		}, this->maxSamples);
+
+		const std::size_t top = *std::max_element(this->counts.begin(), this->counts.end());
+		const int rows = this->surface.getHeight() - 1;
+		for (int x = 0; x < bins; x++) {
+			int eighths = top ? static_cast<int>(static_cast<double>(this->counts[x]) / top * rows * 8 + 0.5) : 0;
+			for (int y = 0; y < rows; y++) {
+				this->surface.set(x, y, verticalEighths[std::clamp(eighths - (rows - 1 - y) * 8, 0, 8)]);
+			}
+		}
+
+		std::string caption = formatValue(this->low) + " .. " + formatValue(this->high) + "  n=" + std::to_string(this->total);
+		caption.resize(bins, ' ');
+		this->surface.text(0, rows, caption);
+	}
+
+private:
+	// Checked before the base and counts are sized from it
+	static int checkedBins(int bins) {
+		if (bins < 1) {
+			throw std::invalid_argument("Histogram needs at least one bin");
+		}
+		return bins;
+	}
+};
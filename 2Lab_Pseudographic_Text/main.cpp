@@ -1,167 +1,132 @@
 #include <iostream>
 #include <string>
-#include <fstream>
-#include <windows.h>
-
-enum class Color { Black, Blue, Green, Cyan, Red, Magenta, Yellow, White, 
-	BrightBlack, BrightBlue, BrightGreen, BrightCyan, BrightRed, BrightMagenta, BrightYellow, BrightWhite };
-
-enum class FontSize { Small = 5, Big = 7};
-
-class PseudographicText {
-	std::string str;
-	char textChar = '#', backgroundChar = ' ';
-	int fontSize = static_cast<int>(FontSize::Small);
-	Color textColor = Color::BrightWhite;
-
-	static inline const std::string availableChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ .,!?0123456789";
-
-public:
-	PseudographicText() {
-
-	}
-
-	PseudographicText(const std::string& str, char textChar, char backgroundChar, FontSize fontSize, Color textColor) :
-		textChar(textChar), backgroundChar(backgroundChar), textColor(textColor) {
-		setString(str);
-		setFontSize(fontSize);
+#include <cstdlib>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "pseudographic_text.h"
+#include "charts.h"
+#include "path_text.h"
+#include "stroke_font.h"
+#include "trace.h"
+
+// Workers measure random vectors and report lengths and their own throughput
+int chartsDemo(int line) {
+	MetricRing<double> lengths(1 << 16);
+	std::vector<MetricRing<double>*> throughput;
+	BarChart bars("RATE", 60, 4);
+	for (int i = 0; i < 4; i++) {
+		throughput.push_back(new MetricRing<double>(256));
+		bars.addBar("worker " + std::to_string(i), *throughput.back());
 	}
-
-	void setString(const std::string& str) {
-		for (int i = 0; i < str.size(); i++) {
-			if (this->availableChars.find(str[i]) == -1) {
-				std::cerr << "Error: character '" << str[i] << "' is unavailable\n";
-				return;
+	// ring readers consume what they read, so the sparkline gets its own copy of worker 0's rate
+	MetricRing<double> load(256);
+	Sparkline spark("LOAD", load, 60, 4);
+	Histogram histogram("LENGTHS", lengths, 0.0, 1000.0, 60, 6);
+
+	std::atomic<bool> running(true);
+	std::vector<std::thread> workers;
+	for (int i = 0; i < 4; i++) {
+		workers.emplace_back([&running, &lengths, &throughput, &load, i]() {
+			unsigned state = 12345u + i;
+			while (running.load()) {
+				auto start = std::chrono::steady_clock::now();
+				int measured = 0;
+				for (; measured < 1000 * (i + 1); measured++) {
+					state = state * 1664525u + 1013904223u;
+					int x = static_cast<int>((state >> 8) % 800);
+					state = state * 1664525u + 1013904223u;
+					int y = static_cast<int>((state >> 8) % 600);
+					lengths.push(std::hypot(x, y));
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				throughput[i]->push(measured / seconds);
+				if (i == 0) {
+					load.push(measured / seconds);
+				}
 			}
-		}
-		this->str = str;
-	}
-
-	void setTextChar(char c) {
-		this->textChar = c;
-	}
-
-	void setBackgroundChar(char c) {
-		this->backgroundChar = c;
+		});
 	}
 
-	void setFontSize(FontSize size) {
-		this->fontSize = static_cast<int>(size);
+	std::size_t written = 0;
+	for (int frame = 0; frame < 40; frame++) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		bars.refresh();
+		spark.refresh();
+		histogram.refresh();
+		written += bars.present(line, 0);
+		written += spark.present(line + bars.height() + 1, 0);
+		written += histogram.present(line + bars.height() + spark.height() + 2, 0);
 	}
 
-	void setTextColor(Color color) {
-		this->textColor = color;
+	running.store(false);
+	for (std::thread& worker : workers) {
+		worker.join();
 	}
-
-	std::string state() const {
-		return "(String: " + this->str + ", TextChar: " + this->textChar + ", BackgroundChar: " + this->backgroundChar + ", FontSize: "
-			+ std::to_string(this->fontSize) + ", TextColor: " + std::to_string(static_cast<int>(this->textColor)) + ")";
-	}
-
-	void print(int line, int column) const {
-		char*** charTable = this->createCharTable();
-		char** text = this->createText(charTable);
-		this->output(text, line, column);
-		this->deleteCharTable(charTable);
-		this->deleteText(text);
-	}
-
-	static void print(const std::string& str, char textChar, char backgroundChar, FontSize fontSize, Color textColor, int line, int column) {
-		PseudographicText text(str, textChar, backgroundChar, fontSize, textColor);
-		text.print(line, column);
+	for (MetricRing<double>* ring : throughput) {
+		delete ring;
 	}
 
-private:
-	char*** createCharTable() const {
-		char*** charTable = new char** [this->availableChars.size()];
-		for (int i = 0; i < this->availableChars.size(); i++) {
-			charTable[i] = new char* [this->fontSize];
-			for (int j = 0; j < this->fontSize; j++) {
-				charTable[i][j] = new char[this->fontSize];
-			}
-		}
-
-		std::ifstream in;
-		in.open("font_size_" + std::to_string(this->fontSize) + ".txt", std::ios::in);
-
-		for (int j = 0; j < this->fontSize; j++) {
-			for (int i = 0; i < this->availableChars.size(); i++) {
-				for (int k = 0; k < this->fontSize; k++) {
-					in >> charTable[i][j][k];
-				}
-			}
-		}
+	int end = line + bars.height() + spark.height() + histogram.height() + 3;
+	Console::setCursor(end, 0);
+	std::cout << "Cells written in 40 frames: " << written << "\n";
+	return end + 2;
+}
 
-		in.close();
-		return charTable;
+// A label slides along a sine wave; the path is measured once, only placements are redone per frame
+int pathTextDemo(int line) {
+	std::vector<Point2d> wave;
+	for (int x = 20; x < 780; x += 10) {
+		wave.push_back(Point2d(x, 300 + static_cast<int>(150 * std::sin(x / 120.0)), screenWidth, screenHeight));
 	}
-
-	char** createText(char*** charTable) const {
-		char** text = new char* [this->fontSize];
-		for (int i = 0; i < this->fontSize; i++) {
-			text[i] = new char[this->str.size() * this->fontSize];
-		}
-
-		for (int i = 0; i < this->str.size(); i++) {
-			for (int j = 0; j < this->fontSize; j++) {
-				for (int k = 0; k < this->fontSize; k++) {
-					text[j][i * this->fontSize + k] = charTable[this->availableChars.find(this->str[i])][j][k];
-					if (charTable[this->availableChars.find(this->str[i])][j][k] == '1') {
-						text[j][i * this->fontSize + k] = this->textChar;
-					}
-					else if (charTable[this->availableChars.find(this->str[i])][j][k] == '0') {
-						text[j][i * this->fontSize + k] = this->backgroundChar;
-					}
-				}
-			}
-		}
-		
-		return text;
+	TextPath path(wave);
+	PseudographicFont font(FontSize::Small);
+	PathLabel label(path, font, "ON A CURVE", 0, 14);
+
+	TerminalCanvas canvas(100, 24);
+	std::size_t written = 0;
+	for (int frame = 0; frame < 20; frame++) {
+		label.setOffset(frame * 8.0);
+		canvas.clear();
+		canvas.polyline(path.getPoints(), Color::BrightBlack);
+		label.draw(canvas, Color::BrightMagenta);
+		written += canvas.present(line, 0);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
 	}
 
-	void output(char** text, int line, int column) const {
-		HANDLE  hConsole;
-		hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
-		SetConsoleTextAttribute(hConsole, static_cast<int>(textColor));
-		COORD coord;
-		coord.X = column;
-		coord.Y = line;
-		SetConsoleCursorPosition(hConsole, coord);
-
-		for (int i = 0; i < this->fontSize; i++) {
-			coord.Y = line + i;
-			SetConsoleCursorPosition(hConsole, coord);
-			for (int j = 0; j < this->str.size() * this->fontSize; j++) {
-				std::cout << text[i][j];
-				if ((j + 1) % this->fontSize == 0) {
-					std::cout << backgroundChar;
-				}
-			}
-			std::cout << "\n";
-		}
-
-		SetConsoleTextAttribute(hConsole, static_cast<int>(Color::Black) * 16 + static_cast<int>(Color::BrightWhite));
-	}
+	int end = line + canvas.getRows();
+	Console::setCursor(end, 0);
+	std::cout << "Path length: " << path.length() << ", cells written in 20 frames: " << written << "\n";
+	return end + 2;
+}
 
-	void deleteCharTable(char*** charTable) const {
-		for (int i = 0; i < this->availableChars.size(); i++) {
-			for (int j = 0; j < this->fontSize; j++) {
-				delete[] charTable[i][j];
-			}
-			delete[] charTable[i];
-		}
-		delete[] charTable;
+// The same stroke glyphs at three sizes; every size is rasterized once, reprints reuse the atlas
+int strokeTextDemo(int line) {
+	StrokeFont font;
+	GlyphAtlas atlas(font);
+	StrokeText small("STROKES AT ANY SIZE", 3, Color::BrightCyan);
+	StrokeText medium("SCALABLE", 6, Color::BrightGreen);
+	StrokeText large("BIG 42", 10, Color::BrightYellow);
+
+	for (int frame = 0; frame < 10; frame++) {
+		small.print(atlas, line, 0);
+		medium.print(atlas, line + 4, 0);
+		large.print(atlas, line + 11, 0);
 	}
 
-	void deleteText(char** text) const {
-		for (int i = 0; i < this->fontSize; i++) {
-			delete[] text[i];
-		}
-		delete[] text;
-	}
-};
+	int end = line + 22;
+	Console::setCursor(end, 0);
+	std::cout << "Glyph sizes rasterized: " << atlas.cachedSizes() << "\n";
+	return end + 2;
+}
 
 int main() {
+	TraceSession trace(std::getenv("TRACE_FILE"));
+
 	PseudographicText text1;
 	text1.setString("HELLO!");
 	std::cout << text1.state();
@@ -171,5 +136,9 @@ int main() {
 	text2.print(10, 10);
 
 	PseudographicText::print("FINALLY!", '$', ' ', FontSize::Big, Color::BrightYellow, 20, 20);
+
+	int line = chartsDemo(30);
+	line = pathTextDemo(line);
+	strokeTextDemo(line);
 	return 0;
 }
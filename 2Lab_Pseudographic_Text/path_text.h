@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "pseudographic_text.h"
+#include "terminal_canvas.h"
+#include "trace.h"
+
+// Position and unit direction at some distance along a path
+struct PathSample {
+	double x, y;
+	double ux, uy;
+};
+
+// Polyline of Point2d with its arc-length table; built once, then sampled by distance in O(log n)
+class TextPath {
+	std::vector<Point2d> points;
+	std::vector<double> lengths;
+
+public:
+	explicit TextPath(const std::vector<Point2d>& points) : points(points), lengths(points.size(), 0.0) {
+		for (std::size_t i = 1; i < this->points.size(); i++) {
+			Vector2d step(this->points[i], this->points[i - 1]);
+			this->lengths[i] = this->lengths[i - 1] + step.lenght();
+		}
+	}
+
+	double length() const {
+		return this->lengths.empty() ? 0.0 : this->lengths.back();
+	}
+
+	const std::vector<Point2d>& getPoints() const {
+		return this->points;
+	}
+
+	// Distances outside [0, length] continue along the first or last segment
+	PathSample sample(double distance) const {
+		if (this->points.size() < 2) {
+			double x = this->points.empty() ? 0 : this->points[0].getX();
+			double y = this->points.empty() ? 0 : this->points[0].getY();
+			return { x, y, 1.0, 0.0 };
+		}
+
+		std::size_t segment = std::upper_bound(this->lengths.begin(), this->lengths.end(), distance) - this->lengths.begin();
+		segment = std::clamp<std::size_t>(segment, 1, this->points.size() - 1);
+		// skip zero-length segments so the direction is always defined
+		while (segment + 1 < this->points.size() && this->lengths[segment] == this->lengths[segment - 1]) {
+			segment++;
+		}
+
+		const Point2d& from = this->points[segment - 1];
+		const Point2d& to = this->points[segment];
+		double span = this->lengths[segment] - this->lengths[segment - 1];
+		if (span <= 0) {
+			return { static_cast<double>(from.getX()), static_cast<double>(from.getY()), 1.0, 0.0 };
+		}
+		double ux = (to.getX() - from.getX()) / span;
+		double uy = (to.getY() - from.getY()) / span;
+		double t = distance - this->lengths[segment - 1];
+		return { from.getX() + ux * t, from.getY() + uy * t, ux, uy };
+	}
+};
+
+struct GlyphPlacement {
+	char c;
+	PathSample at;
+};
+
+// Pseudographic text laid along a TextPath.
+// Placements are cached until the string or offset changes; the rasterized dots are cached
+// until the label moves. Neither touches the path's arc-length table.
+class PathLabel {
+	const TextPath& path;
+	const PseudographicFont& font;
+	std::string str;
+	double offset;
+	double scale;
+	double shiftX = 0, shiftY = 0;
+
+	std::vector<GlyphPlacement> placements;
+	bool placed = false;
+	std::vector<std::pair<int, int>> dots;
+	int dotsWidth = -1, dotsHeight = -1;
+
+public:
+	// scale is the size of one font pixel in window units
+	PathLabel(const TextPath& path, const PseudographicFont& font, const std::string& str, double offset = 0, double scale = 8) :
+		path(path), font(font), str(str), offset(offset), scale(scale) {
+
+	}
+
+	void setString(const std::string& str) {
+		this->str = str;
+		this->invalidatePlacements();
+	}
+
+	void setOffset(double offset) {
+		this->offset = offset;
+		this->invalidatePlacements();
+	}
+
+	double getOffset() const {
+		return this->offset;
+	}
+
+	// Moves the whole label without re-sampling the path
+	void translate(double dx, double dy) {
+		this->shiftX += dx;
+		this->shiftY += dy;
+		this->dotsWidth = -1;
+	}
+
+	double advance() const {
+		return (this->font.getSize() + 1) * this->scale;
+	}
+
+	const std::vector<GlyphPlacement>& glyphs() {
+		if (!this->placed) {
+			TRACE_SCOPE("PathLabel::place", "text");
+			this->placements.clear();
+			for (std::size_t i = 0; i < this->str.size(); i++) {
+				if (this->str[i] != ' ') {
+					this->placements.push_back({ this->str[i], this->path.sample(this->offset + (i + 0.5) * this->advance()) });
+				}
+			}
+			this->placed = true;
+		}
+		return this->placements;
+	}
+
+	void draw(TerminalCanvas& canvas, Color color) {
+		if (this->dotsWidth != canvas.pixelWidth() || this->dotsHeight != canvas.pixelHeight()) {
+			this->rasterize(canvas);
+		}
+		for (const std::pair<int, int>& dot : this->dots) {
+			canvas.plot(dot.first, dot.second, color);
+		}
+	}
+
+private:
+	void invalidatePlacements() {
+		this->placed = false;
+		this->dotsWidth = -1;
+	}
+
+	// Every lit font pixel becomes a small square rotated with the path direction,
+	// sampled densely enough that no canvas dot inside it is skipped
+	void rasterize(const TerminalCanvas& canvas) {
+		TRACE_SCOPE("PathLabel::rasterize", "text");
+		const int size = this->font.getSize();
+		const int steps = std::max(1, static_cast<int>(std::ceil(this->scale * canvas.dotsPerUnit() * 1.5)));
+
+		this->dots.clear();
+		for (const GlyphPlacement& glyph : this->glyphs()) {
+			const double nx = -glyph.at.uy;
+			const double ny = glyph.at.ux;
+			for (int row = 0; row < size; row++) {
+				for (int column = 0; column < size; column++) {
+					if (!this->font.pixel(glyph.c, row, column)) {
+						continue;
+					}
+					for (int a = 0; a < steps; a++) {
+						for (int b = 0; b < steps; b++) {
+							double along = (column + (a + 0.5) / steps - size / 2.0) * this->scale;
+							double up = (size / 2.0 - row - (b + 0.5) / steps) * this->scale;
+							double x = glyph.at.x + this->shiftX + glyph.at.ux * along + nx * up;
+							double y = glyph.at.y + this->shiftY + glyph.at.uy * along + ny * up;
+							this->dots.push_back({ canvas.toPixelX(x), canvas.toPixelY(y) });
+						}
+					}
+				}
+			}
+		}
+		std::sort(this->dots.begin(), this->dots.end());
+		this->dots.erase(std::unique(this->dots.begin(), this->dots.end()), this->dots.end());
+		this->dotsWidth = canvas.pixelWidth();
+		this->dotsHeight = canvas.pixelHeight();
+	}
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <fstream>
+#include <vector>
+
+#include "console.h"
+#include "trace.h"
+
+enum class FontSize { Small = 5, Big = 7};
+
+class PseudographicText {
+	std::string str;
+	char textChar = '#', backgroundChar = ' ';
+	int fontSize = static_cast<int>(FontSize::Small);
+	Color textColor = Color::BrightWhite;
+
+	static inline const std::string availableChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZ .,!?0123456789";
+
+public:
+	PseudographicText() {
+
+	}
+
+	PseudographicText(const std::string& str, char textChar, char backgroundChar, FontSize fontSize, Color textColor) :
+		textChar(textChar), backgroundChar(backgroundChar), textColor(textColor) {
+		setString(str);
+		setFontSize(fontSize);
+	}
+
+	void setString(const std::string& str) {
+		for (int i = 0; i < str.size(); i++) {
+			if (this->availableChars.find(str[i]) == -1) {
+				std::cerr << "Error: character '" << str[i] << "' is unavailable\n";
+				return;
+			}
+		}
+		this->str = str;
+	}
+
+	void setTextChar(char c) {
+		this->textChar = c;
+	}
+
+	void setBackgroundChar(char c) {
+		this->backgroundChar = c;
+	}
+
+	void setFontSize(FontSize size) {
+		this->fontSize = static_cast<int>(size);
+	}
+
+	void setTextColor(Color color) {
+		this->textColor = color;
+	}
+
+	static const std::string& charset() {
+		return availableChars;
+	}
+
+	int width() const {
+		return static_cast<int>(this->str.size()) * (this->fontSize + 1);
+	}
+
+	int height() const {
+		return this->fontSize;
+	}
+
+	std::string state() const {
+		return "(String: " + this->str + ", TextChar: " + this->textChar + ", BackgroundChar: " + this->backgroundChar + ", FontSize: "
+			+ std::to_string(this->fontSize) + ", TextColor: " + std::to_string(static_cast<int>(this->textColor)) + ")";
+	}
+
+	void print(int line, int column) const {
+		TRACE_SCOPE("PseudographicText::print", "text");
+		char*** charTable = this->createCharTable();
+		char** text = this->createText(charTable);
+		this->output(text, line, column);
+		this->deleteCharTable(charTable);
+		this->deleteText(text);
+	}
+
+	static void print(const std::string& str, char textChar, char backgroundChar, FontSize fontSize, Color textColor, int line, int column) {
+		PseudographicText text(str, textChar, backgroundChar, fontSize, textColor);
+		text.print(line, column);
+	}
+
+private:
+	char*** createCharTable() const {
+		TRACE_SCOPE("PseudographicText::createCharTable", "text");
+		char*** charTable = new char** [this->availableChars.size()];
+		for (int i = 0; i < this->availableChars.size(); i++) {
+			charTable[i] = new char* [this->fontSize];
+			for (int j = 0; j < this->fontSize; j++) {
+				charTable[i][j] = new char[this->fontSize];
+			}
+		}
+
+		std::ifstream in;
+		in.open("font_size_" + std::to_string(this->fontSize) + ".txt", std::ios::in);
+
+		for (int j = 0; j < this->fontSize; j++) {
+			for (int i = 0; i < this->availableChars.size(); i++) {
+				for (int k = 0; k < this->fontSize; k++) {
+					in >> charTable[i][j][k];
+				}
+			}
+		}
+
+		in.close();
+		return charTable;
+	}
+
+	char** createText(char*** charTable) const {
+		TRACE_SCOPE("PseudographicText::createText", "text");
+		char** text = new char* [this->fontSize];
+		for (int i = 0; i < this->fontSize; i++) {
+			text[i] = new char[this->str.size() * this->fontSize];
+		}
+
+		for (int i = 0; i < this->str.size(); i++) {
+			for (int j = 0; j < this->fontSize; j++) {
+				for (int k = 0; k < this->fontSize; k++) {
+					text[j][i * this->fontSize + k] = charTable[this->availableChars.find(this->str[i])][j][k];
+					if (charTable[this->availableChars.find(this->str[i])][j][k] == '1') {
+						text[j][i * this->fontSize + k] = this->textChar;
+					}
+					else if (charTable[this->availableChars.find(this->str[i])][j][k] == '0') {
+						text[j][i * this->fontSize + k] = this->backgroundChar;
+					}
+				}
+			}
+		}
+		
+		return text;
+	}
+
+	void output(char** text, int line, int column) const {
+		TRACE_SCOPE("PseudographicText::output", "text");
+		Console::setColor(textColor);
+
+		for (int i = 0; i < this->fontSize; i++) {
+			Console::setCursor(line + i, column);
+			for (int j = 0; j < this->str.size() * this->fontSize; j++) {
+				std::cout << text[i][j];
+				if ((j + 1) % this->fontSize == 0) {
+					std::cout << backgroundChar;
+				}
+			}
+			std::cout << "\n";
+		}
+
+		Console::resetColor();
+	}
+
+	void deleteCharTable(char*** charTable) const {
+		for (int i = 0; i < this->availableChars.size(); i++) {
+			for (int j = 0; j < this->fontSize; j++) {
+				delete[] charTable[i][j];
+			}
+			delete[] charTable[i];
+		}
+		delete[] charTable;
+	}
+
+	void deleteText(char** text) const {
+		for (int i = 0; i < this->fontSize; i++) {
+			delete[] text[i];
+		}
+		delete[] text;
+	}
+};
+
+// Glyph bitmaps of one font file, loaded once and shared by every label drawn with it
+class PseudographicFont {
+	int size;
+	std::vector<std::string> rows;
+
+public:
+	explicit PseudographicFont(FontSize fontSize) : size(static_cast<int>(fontSize)) {
+		std::ifstream in("font_size_" + std::to_string(this->size) + ".txt", std::ios::in);
+		if (!in) {
+			std::cerr << "Error: font file for size " << this->size << " is missing\n";
+			return;
+		}
+		std::string row;
+		for (int j = 0; j < this->size && in >> row; j++) {
+			this->rows.push_back(row);
+		}
+	}
+
+	int getSize() const {
+		return this->size;
+	}
+
+	bool hasGlyph(char c) const {
+		return PseudographicText::charset().find(c) != std::string::npos;
+	}
+
+	bool pixel(char c, int row, int column) const {
+		std::size_t index = PseudographicText::charset().find(c);
+		if (index == std::string::npos || row < 0 || row >= this->rows.size() || column < 0 || column >= this->size) {
+			return false;
+		}
+		std::size_t at = index * this->size + column;
+		return at < this->rows[row].size() && this->rows[row][at] == '1';
+	}
+};
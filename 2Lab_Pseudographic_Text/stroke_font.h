@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "geometry.h"
+#include "console.h"
+#include "raster.h"
+#include "pseudographic_text.h"
+#include "trace.h"
+
+// One stroke of a glyph: start point and direction on a 4 x 6 design grid, y pointing up
+struct Stroke {
+	Point2d from;
+	Vector2d delta;
+};
+
+// Vector glyphs for the same characters as the bitmap fonts, drawn at any size
+class StrokeFont {
+	std::map<char, std::vector<Stroke>> glyphs;
+
+	// Each glyph is a list of polylines separated by '|'; every point is two digits, x then y
+	static inline const std::map<char, std::string> outlines = {
+		{ 'A', "00 04 26 44 40|03 43" }, { 'B', "00 06 36 45 44 33 03|33 42 41 30 00" },
+		{ 'C', "41 30 10 01 05 16 36 45" }, { 'D', "00 06 26 44 42 20 00" },
+		{ 'E', "40 00 06 46|03 33" }, { 'F', "00 06 46|03 33" },
+		{ 'G', "45 36 16 05 01 10 30 41 43 23" }, { 'H', "00 06|40 46|03 43" },
+		{ 'I', "10 30|20 26|16 36" }, { 'J', "01 10 30 41 46|26 46" },
+		{ 'K', "00 06|46 03 40" }, { 'L', "06 00 40" },
+		{ 'M', "00 06 23 46 40" }, { 'N', "00 06 40 46" },
+		{ 'O', "10 01 05 16 36 45 41 30 10" }, { 'P', "00 06 36 45 44 33 03" },
+		{ 'Q', "10 01 05 16 36 45 41 30 10|22 40" }, { 'R', "00 06 36 45 44 33 03|23 40" },
+		{ 'S', "01 10 30 41 42 33 13 04 05 16 36 45" }, { 'T', "06 46|20 26" },
+		{ 'U', "06 01 10 30 41 46" }, { 'V', "06 20 46" },
+		{ 'W', "06 10 23 30 46" }, { 'X', "00 46|06 40" },
+		{ 'Y', "06 23 46|23 20" }, { 'Z', "06 46 00 40" },
+		{ ' ', "" }, { '.', "20 20" }, { ',', "21 10" },
+		{ '!', "26 22|20 20" }, { '?', "05 16 36 45 44 23 22|20 20" },
+		{ '0', "10 01 05 16 36 45 41 30 10|11 35" }, { '1', "14 26 20|10 30" },
+		{ '2', "05 16 36 45 44 00 40" }, { '3', "05 16 36 45 44 33 13|33 42 41 30 10 01" },
+		{ '4', "30 36 02 42" }, { '5', "46 06 04 34 43 41 30 10 01" },
+		{ '6', "45 36 16 05 01 10 30 41 42 33 13 02" }, { '7', "06 46 20" },
+		{ '8', "10 01 02 13 33 44 45 36 16 05 04 13|33 42 41 30 10" },
+		{ '9', "01 10 30 41 45 36 16 05 04 13 33 44" }
+	};
+
+public:
+	static const int gridWidth = 4;
+	static const int gridHeight = 6;
+
+	StrokeFont() {
+		for (const auto& [c, outline] : outlines) {
+			std::vector<Stroke>& strokes = this->glyphs[c];
+			std::vector<Point2d> polyline;
+			for (std::size_t i = 0; i <= outline.size(); i++) {
+				if (i == outline.size() || outline[i] == '|') {
+					for (std::size_t j = 1; j < polyline.size(); j++) {
+						strokes.push_back({ polyline[j - 1], Vector2d(polyline[j], polyline[j - 1]) });
+					}
+					if (polyline.size() == 1) {
+						strokes.push_back({ polyline[0], Vector2d(polyline[0], polyline[0]) });
+					}
+					polyline.clear();
+				}
+				else if (outline[i] != ' ') {
+					polyline.push_back(Point2d(outline[i] - '0', outline[i + 1] - '0', screenWidth, screenHeight));
+					i++;
+				}
+			}
+		}
+	}
+
+	bool hasGlyph(char c) const {
+		return this->glyphs.count(c) != 0;
+	}
+
+	const std::vector<Stroke>& strokes(char c) const {
+		return this->glyphs.at(c);
+	}
+
+	// Glyph bitmap with square pixels, height pixels tall
+	Bitmap rasterize(char c, int height) const {
+		TRACE_SCOPE("StrokeFont::rasterize", "text");
+		const double thickness = std::max(1.0, std::round(height / 9.0));
+		const double scale = std::max(height - thickness, 1.0) / gridHeight;
+		const int width = static_cast<int>(std::ceil(gridWidth * scale + thickness));
+		Bitmap bitmap(width, height);
+		const double margin = thickness / 2;
+		for (const Stroke& stroke : this->strokes(c)) {
+			double x0 = margin + stroke.from.getX() * scale;
+			double y0 = margin + (gridHeight - stroke.from.getY()) * scale;
+			double x1 = x0 + stroke.delta.getCoordX() * scale;
+			double y1 = y0 - stroke.delta.getCoordY() * scale;
+			drawThickLine(bitmap, x0, y0, x1, y1, thickness);
+		}
+		return bitmap;
+	}
+};
+
+// Rasterized glyphs by size. The first request for a size rasterizes the whole character set once;
+// every later banner of that size only copies cells out of the atlas.
+class GlyphAtlas {
+	const StrokeFont& font;
+	std::map<int, std::map<char, Bitmap>> pages;
+
+public:
+	explicit GlyphAtlas(const StrokeFont& font) : font(font) {
+
+	}
+
+	const std::map<char, Bitmap>& page(int height) {
+		auto found = this->pages.find(height);
+		if (found != this->pages.end()) {
+			return found->second;
+		}
+		TRACE_SCOPE("GlyphAtlas::page", "text");
+		std::map<char, Bitmap>& page = this->pages[height];
+		for (char c : PseudographicText::charset()) {
+			if (this->font.hasGlyph(c)) {
+				page.emplace(c, this->font.rasterize(c, height));
+			}
+		}
+		return page;
+	}
+
+	const Bitmap& glyph(char c, int height) {
+		return this->page(height).at(c);
+	}
+
+	int cachedSizes() const {
+		return static_cast<int>(this->pages.size());
+	}
+};
+
+// Banner from stroke glyphs. A console cell is about twice as tall as wide, so each cell
+// shows two square pixels stacked with half-block characters.
+class StrokeText {
+	std::string str;
+	int rows;
+	Color textColor;
+
+public:
+	StrokeText(const std::string& str, int rows, Color textColor = Color::BrightWhite) : rows(rows), textColor(textColor) {
+		this->setString(str);
+	}
+
+	void setString(const std::string& str) {
+		for (std::size_t i = 0; i < str.size(); i++) {
+			if (PseudographicText::charset().find(str[i]) == std::string::npos) {
+				std::cerr << "Error: character '" << str[i] << "' is unavailable\n";
+				return;
+			}
+		}
+		this->str = str;
+	}
+
+	std::vector<std::string> render(GlyphAtlas& atlas) const {
+		TRACE_SCOPE("StrokeText::render", "text");
+		const int height = this->rows * 2;
+		std::vector<std::string> lines(this->rows);
+		for (char c : this->str) {
+			const Bitmap& glyph = atlas.glyph(c, height);
+			const int gap = std::max(1, height / 8);
+			for (int y = 0; y < this->rows; y++) {
+				for (int x = 0; x < glyph.getWidth() + gap; x++) {
+					static const char* const halves[4] = { " ", "\xE2\x96\x80", "\xE2\x96\x84", "\xE2\x96\x88" };
+					lines[y] += halves[glyph.get(x, 2 * y) + 2 * glyph.get(x, 2 * y + 1)];
+				}
+			}
+		}
+		return lines;
+	}
+
+	void print(GlyphAtlas& atlas, int line, int column) const {
+		std::vector<std::string> lines = this->render(atlas);
+		Console::enableUtf8();
+		Console::setColor(this->textColor);
+		for (int y = 0; y < static_cast<int>(lines.size()); y++) {
+			Console::setCursor(line + y, column);
+			Console::write(lines[y]);
+		}
+		Console::resetColor();
+		Console::flush();
+	}
+};
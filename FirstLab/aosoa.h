@@ -0,0 +1,198 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "geometry.h"
+
+// Блочная раскладка AoSoA: в каждом блоке Block координат x, затем Block координат y.
+// x и y одного вектора лежат в одной строке кэша, а внутри блока циклы векторизуются как в SoA.
+template <class T, std::size_t Block = 8>
+class AosoaVectors
+{
+	static_assert(Block > 0 && (Block & (Block - 1)) == 0, "Block must be a power of two");
+
+public:
+	struct alignas(64) Tile
+	{
+		T x[Block];
+		T y[Block];
+	};
+
+	class const_iterator
+	{
+	private:
+		const AosoaVectors* owner = nullptr;
+		std::size_t index = 0;
+
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = VectorN<T, 2>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		const_iterator() {}
+		const_iterator(const AosoaVectors* owner, std::size_t index) : owner(owner), index(index) {}
+
+		value_type operator*() const { return (*owner)[index]; }
+		value_type operator[](difference_type n) const { return (*owner)[index + n]; }
+
+		const_iterator& operator++() { index++; return *this; }
+		const_iterator operator++(int) { const_iterator old = *this; index++; return old; }
+		const_iterator& operator--() { index--; return *this; }
+		const_iterator operator--(int) { const_iterator old = *this; index--; return old; }
+		const_iterator& operator+=(difference_type n) { index += n; return *this; }
+		const_iterator& operator-=(difference_type n) { index -= n; return *this; }
+		const_iterator operator+(difference_type n) const { return const_iterator(owner, index + n); }
+		const_iterator operator-(difference_type n) const { return const_iterator(owner, index - n); }
+		difference_type operator-(const const_iterator& other) const { return static_cast<difference_type>(index) - static_cast<difference_type>(other.index); }
+
+		bool operator==(const const_iterator& other) const { return index == other.index; }
+		bool operator!=(const const_iterator& other) const { return index != other.index; }
+		bool operator<(const const_iterator& other) const { return index < other.index; }
+	};
+
+private:
+	std::vector<Tile> blocks;
+	std::size_t count = 0;
+
+public:
+	static constexpr std::size_t blockSize = Block;
+
+	AosoaVectors() {}
+
+	explicit AosoaVectors(std::size_t n) { resize(n); }
+
+	void reserve(std::size_t n) { blocks.reserve((n + Block - 1) / Block); }
+
+	void resize(std::size_t n)
+	{
+		blocks.resize((n + Block - 1) / Block, Tile{});
+		count = n;
+	}
+
+	void push(T x, T y)
+	{
+		if (count % Block == 0)
+		{
+			blocks.push_back(Tile{});
+		}
+		Tile& tile = blocks[count / Block];
+		tile.x[count % Block] = x;
+		tile.y[count % Block] = y;
+		count++;
+	}
+
+	void push(const VectorN<T, 2>& v) { push(v[0], v[1]); }
+
+	void clear()
+	{
+		blocks.clear();
+		count = 0;
+	}
+
+	std::size_t size() const { return count; }
+	std::size_t blockCount() const { return blocks.size(); }
+
+	T& x(std::size_t i) { return blocks[i / Block].x[i % Block]; }
+	T& y(std::size_t i) { return blocks[i / Block].y[i % Block]; }
+	const T& x(std::size_t i) const { return blocks[i / Block].x[i % Block]; }
+	const T& y(std::size_t i) const { return blocks[i / Block].y[i % Block]; }
+
+	VectorN<T, 2> operator[](std::size_t i) const
+	{
+		const Tile& tile = blocks[i / Block];
+		VectorN<T, 2> v;
+		v[0] = tile.x[i % Block];
+		v[1] = tile.y[i % Block];
+		return v;
+	}
+
+	void set(std::size_t i, const VectorN<T, 2>& v)
+	{
+		x(i) = v[0];
+		y(i) = v[1];
+	}
+
+	Tile* data() { return blocks.data(); }
+	const Tile* data() const { return blocks.data(); }
+
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, count); }
+};
+
+namespace aosoa_detail
+{
+	// op(tile, i) считает результат для полосы i; полные блоки пишутся прямо в out, хвост - через буфер
+	template <class T, std::size_t Block, class Out, class Op>
+	void forEachLane(const AosoaVectors<T, Block>& a, Out* out, Op op)
+	{
+		const std::size_t full = a.size() / Block;
+		for (std::size_t t = 0; t < full; t++)
+		{
+			Out* target = out + t * Block;
+			for (std::size_t i = 0; i < Block; i++)
+			{
+				target[i] = op(t, i);
+			}
+		}
+
+		const std::size_t tail = a.size() - full * Block;
+		if (tail)
+		{
+			Out result[Block];
+			for (std::size_t i = 0; i < Block; i++)
+			{
+				result[i] = op(full, i);
+			}
+			std::copy(result, result + tail, out + full * Block);
+		}
+	}
+}
+
+template <class T, std::size_t Block, class Out>
+void aosoaDot(const AosoaVectors<T, Block>& a, const AosoaVectors<T, Block>& b, Out* out)
+{
+	if (a.size() != b.size())
+	{
+		throw std::invalid_argument("Размеры пакетов должны совпадать");
+	}
+	const auto* ta = a.data();
+	const auto* tb = b.data();
+	aosoa_detail::forEachLane(a, out, [ta, tb](std::size_t t, std::size_t i)
+	{
+		return static_cast<Out>(ta[t].x[i]) * tb[t].x[i] + static_cast<Out>(ta[t].y[i]) * tb[t].y[i];
+	});
+}
+
+template <class T, std::size_t Block, class Out>
+void aosoaCross(const AosoaVectors<T, Block>& a, const AosoaVectors<T, Block>& b, Out* out)
+{
+	if (a.size() != b.size())
+	{
+		throw std::invalid_argument("Размеры пакетов должны совпадать");
+	}
+	const auto* ta = a.data();
+	const auto* tb = b.data();
+	aosoa_detail::forEachLane(a, out, [ta, tb](std::size_t t, std::size_t i)
+	{
+		return static_cast<Out>(ta[t].x[i]) * tb[t].y[i] - static_cast<Out>(tb[t].x[i]) * ta[t].y[i];
+	});
+}
+
+template <class T, std::size_t Block>
+void aosoaLength(const AosoaVectors<T, Block>& a, double* out)
+{
+	const auto* ta = a.data();
+	aosoa_detail::forEachLane(a, out, [ta](std::size_t t, std::size_t i)
+	{
+		double x = ta[t].x[i];
+		double y = ta[t].y[i];
+		return std::sqrt(x * x + y * y);
+	});
+}
@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+
+#include "geometry.h"
+#include "trace.h"
+
+// Пакетные операции над векторами в раскладке SoA (отдельные массивы x и y)
+
+inline void batchDot(const int* ax, const int* ay, const int* bx, const int* by, long long* out, std::size_t n)
+{
+	TRACE_SCOPE("batchDot", "geometry");
+	for (std::size_t i = 0; i < n; i++)
+	{
+		out[i] = static_cast<long long>(ax[i]) * bx[i] + static_cast<long long>(ay[i]) * by[i];
+	}
+}
+
+inline void batchCross(const int* ax, const int* ay, const int* bx, const int* by, long long* out, std::size_t n)
+{
+	TRACE_SCOPE("batchCross", "geometry");
+	for (std::size_t i = 0; i < n; i++)
+	{
+		out[i] = static_cast<long long>(ax[i]) * by[i] - static_cast<long long>(bx[i]) * ay[i];
+	}
+}
+
+inline void batchLength(const int* x, const int* y, double* out, std::size_t n)
+{
+	TRACE_SCOPE("batchLength", "geometry");
+	for (std::size_t i = 0; i < n; i++)
+	{
+		double dx = x[i];
+		double dy = y[i];
+		out[i] = std::sqrt(dx * dx + dy * dy);
+	}
+}
+
+inline double batchLengthSum(const int* x, const int* y, std::size_t n)
+{
+	TRACE_SCOPE("batchLengthSum", "geometry");
+	double sum = 0;
+	for (std::size_t i = 0; i < n; i++)
+	{
+		double dx = x[i];
+		double dy = y[i];
+		sum += std::sqrt(dx * dx + dy * dy);
+	}
+	return sum;
+}
+
+// Оставляет точки внутри [x0, x1] x [y0, y1], возвращает их число
+inline std::size_t batchClip(const int* x, const int* y, std::size_t n, int x0, int y0, int x1, int y1, int* outX, int* outY)
+{
+	TRACE_SCOPE("batchClip", "geometry");
+	std::size_t kept = 0;
+	for (std::size_t i = 0; i < n; i++)
+	{
+		outX[kept] = x[i];
+		outY[kept] = y[i];
+		kept += x[i] >= x0 && x[i] <= x1 && y[i] >= y0 && y[i] <= y1;
+	}
+	return kept;
+}
+
+// Аффинное преобразование: (x, y) -> (m[0]x + m[1]y + m[2], m[3]x + m[4]y + m[5])
+inline void batchTransform(const int* x, const int* y, const double* m, double* outX, double* outY, std::size_t n)
+{
+	TRACE_SCOPE("batchTransform", "geometry");
+	for (std::size_t i = 0; i < n; i++)
+	{
+		double px = x[i];
+		double py = y[i];
+		outX[i] = m[0] * px + m[1] * py + m[2];
+		outY[i] = m[3] * px + m[4] * py + m[5];
+	}
+}
+
+class PointBatch
+{
+private:
+	std::vector<int> xs;
+	std::vector<int> ys;
+
+public:
+	PointBatch() {}
+
+	explicit PointBatch(const std::vector<Point2d>& points)
+	{
+		reserve(points.size());
+		for (const Point2d& p : points)
+		{
+			push(p.getX(), p.getY());
+		}
+	}
+
+	void reserve(std::size_t n)
+	{
+		xs.reserve(n);
+		ys.reserve(n);
+	}
+
+	void push(int x, int y)
+	{
+		xs.push_back(x);
+		ys.push_back(y);
+	}
+
+	void push(const Point2d& p) { push(p.getX(), p.getY()); }
+	void push(const Vector2d& v) { push(v.getCoordX(), v.getCoordY()); }
+
+	void clear()
+	{
+		xs.clear();
+		ys.clear();
+	}
+
+	std::size_t size() const { return xs.size(); }
+	const int* x() const { return xs.data(); }
+	const int* y() const { return ys.data(); }
+	int* x() { return xs.data(); }
+	int* y() { return ys.data(); }
+};
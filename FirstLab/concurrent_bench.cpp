@@ -0,0 +1,209 @@
+﻿#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <shared_mutex>
+#include <string>
+#include <algorithm>
+
+#include "concurrent_grid.h"
+#include "parallel.h"
+
+using namespace std;
+
+// Смешанная нагрузка: один писатель непрерывно двигает точки, читатели ищут ближайшие.
+// Сравнивается ConcurrentGrid (читатели без блокировок, с повтором при переносе) с сеткой под shared_mutex.
+// Число читателей растет от 1 до всех ядер. Запускать в Release-сборке.
+
+static unsigned nextRandom(unsigned& state)
+{
+	state = state * 1664525u + 1013904223u;
+	return state >> 8;
+}
+
+// Та же сетка ячеек с векторами, защищенная одной блокировкой чтения-записи
+class LockedGrid
+{
+private:
+	int cellSize;
+	int columns;
+	int rows;
+	vector<vector<GridEntry>> cells;
+	vector<Point2d> positions;
+	mutable shared_mutex mutex;
+
+public:
+	LockedGrid(int cellSize) : cellSize(cellSize), columns((screenWidth + cellSize - 1) / cellSize),
+		rows((screenHeight + cellSize - 1) / cellSize), cells(static_cast<size_t>(columns) * rows) {}
+
+	void insert(const vector<Point2d>& points)
+	{
+		unique_lock<shared_mutex> lock(mutex);
+		for (const Point2d& p : points)
+		{
+			uint32_t id = static_cast<uint32_t>(positions.size());
+			positions.push_back(p);
+			cells[cellOf(p)].push_back({ id, p.getX(), p.getY() });
+		}
+	}
+
+	void move(uint32_t id, const Point2d& p)
+	{
+		unique_lock<shared_mutex> lock(mutex);
+		vector<GridEntry>& from = cells[cellOf(positions[id])];
+		from.erase(find_if(from.begin(), from.end(), [id](const GridEntry& e) { return e.id == id; }));
+		positions[id] = p;
+		cells[cellOf(p)].push_back({ id, p.getX(), p.getY() });
+	}
+
+	long long nearest(int x, int y) const
+	{
+		shared_lock<shared_mutex> lock(mutex);
+		long long best = -1;
+		long long bestDist2 = 1LL << 62;
+		int cx = x / cellSize;
+		int cy = y / cellSize;
+		for (int ring = 0; ring <= max(columns, rows); ring++)
+		{
+			if (best >= 0 && static_cast<long long>(ring - 1) * cellSize * (ring - 1) * cellSize > bestDist2)
+			{
+				break;
+			}
+			for (int gy = max(cy - ring, 0); gy <= min(cy + ring, rows - 1); gy++)
+			{
+				for (int gx = max(cx - ring, 0); gx <= min(cx + ring, columns - 1); gx++)
+				{
+					if (max(abs(gx - cx), abs(gy - cy)) != ring)
+					{
+						continue;
+					}
+					for (const GridEntry& e : cells[static_cast<size_t>(gy) * columns + gx])
+					{
+						long long dx = e.x - x;
+						long long dy = e.y - y;
+						if (dx * dx + dy * dy < bestDist2)
+						{
+							bestDist2 = dx * dx + dy * dy;
+							best = e.id;
+						}
+					}
+				}
+			}
+		}
+		return best;
+	}
+
+private:
+	size_t cellOf(const Point2d& p) const
+	{
+		return static_cast<size_t>(min(p.getY() / cellSize, rows - 1)) * columns + min(p.getX() / cellSize, columns - 1);
+	}
+};
+
+struct Result
+{
+	double queries;
+	double moves;
+	bool answered;
+};
+
+// Сколько запросов и перемещений в секунду успели сделать читатели и писатель за duration
+template <class Query, class Move>
+static Result measure(unsigned readers, size_t pointCount, double duration, Query query, Move move)
+{
+	atomic<bool> running(true);
+	atomic<long long> queries(0);
+	atomic<long long> found(0);
+	long long moves = 0;
+
+	vector<thread> threads;
+	for (unsigned r = 0; r < readers; r++)
+	{
+		threads.emplace_back([&, r]()
+		{
+			unsigned state = 1000u + r;
+			long long local = 0;
+			// ответы считаются, иначе компилятор выбросит сам поиск и останется только блокировка
+			long long localFound = 0;
+			while (running.load(memory_order_relaxed))
+			{
+				for (int k = 0; k < 64; k++)
+				{
+					localFound += query(static_cast<int>(nextRandom(state) % screenWidth), static_cast<int>(nextRandom(state) % screenHeight)) >= 0;
+				}
+				local += 64;
+			}
+			queries += local;
+			found += localFound;
+		});
+	}
+
+	thread writer([&]()
+	{
+		unsigned state = 7u;
+		while (running.load(memory_order_relaxed))
+		{
+			uint32_t id = nextRandom(state) % pointCount;
+			move(id, Point2d(nextRandom(state) % screenWidth, nextRandom(state) % screenHeight, screenWidth, screenHeight));
+			moves++;
+		}
+	});
+
+	auto start = chrono::steady_clock::now();
+	this_thread::sleep_for(chrono::duration<double>(duration));
+	running.store(false);
+	for (thread& t : threads)
+	{
+		t.join();
+	}
+	writer.join();
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	// в непустой сетке ближайшая точка есть всегда
+	return { queries.load() / seconds, moves / seconds, found.load() == queries.load() };
+}
+
+int main(int argc, char** argv)
+{
+	const size_t pointCount = argc > 1 ? stoul(argv[1]) : 100000;
+	const unsigned maxReaders = argc > 2 ? static_cast<unsigned>(stoul(argv[2])) : workerCount();
+	const double duration = argc > 3 ? stod(argv[3]) : 1.0;
+	cout << "Точек: " << pointCount << ", читателей до " << maxReaders << ", один писатель" << endl;
+
+	vector<Point2d> points;
+	unsigned state = 1;
+	for (size_t i = 0; i < pointCount; i++)
+	{
+		points.push_back(Point2d(nextRandom(state) % screenWidth, nextRandom(state) % screenHeight, screenWidth, screenHeight));
+	}
+
+	ConcurrentGrid concurrent(8);
+	concurrent.insert(points);
+	LockedGrid locked(8);
+	locked.insert(points);
+
+	cout << "Столбцы: читатели; запросов/с и перемещений/с для ConcurrentGrid; то же для сетки под shared_mutex" << endl;
+	for (unsigned readers = 1; readers <= maxReaders; readers = readers < maxReaders ? min(readers * 2, maxReaders) : readers + 1)
+	{
+		Result rcu = measure(readers, pointCount, duration, [&concurrent](int x, int y)
+		{
+			ConcurrentGrid::Reader reader = concurrent.read();
+			return reader.nearest(x, y);
+		}, [&concurrent](uint32_t id, const Point2d& p) { concurrent.move(id, p); });
+
+		Result lock = measure(readers, pointCount, duration, [&locked](int x, int y)
+		{
+			return locked.nearest(x, y);
+		}, [&locked](uint32_t id, const Point2d& p) { locked.move(id, p); });
+
+		cout << fixed << setprecision(0) << setw(4) << readers << setw(14) << rcu.queries << setw(12) << rcu.moves
+			<< setw(14) << lock.queries << setw(12) << lock.moves << endl;
+		if (!rcu.answered || !lock.answered)
+		{
+			cout << "Часть запросов не нашла ближайшую точку" << endl;
+			return 1;
+		}
+	}
+	return 0;
+}
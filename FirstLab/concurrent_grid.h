@@ -0,0 +1,442 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include "geometry.h"
+#include "versioned_store.h"
+
+// Равномерная сетка над окном, в которой писатель двигает точки, а читатели не берут блокировок.
+// Каждая ячейка - неизменяемый массив, опубликованный через атомарный указатель (RCU):
+// писатель собирает новый массив и заменяет указатель, старый освобождается по эпохам.
+// Перенос между ячейками меняет два указателя: запрос, который за время обхода застал перенос
+// между двумя просмотренными им ячейками, повторяется. Читатели не ждут писателя, но при частых
+// переносах рядом с запросом он может повториться несколько раз.
+
+struct GridEntry
+{
+	std::uint32_t id;
+	std::int32_t x;
+	std::int32_t y;
+};
+
+class ConcurrentGrid
+{
+private:
+	struct CellArray
+	{
+		std::vector<GridEntry> entries;
+	};
+
+	int cellSize;
+	int columns;
+	int rows;
+	std::unique_ptr<std::atomic<const CellArray*>[]> cells;
+	mutable EpochReclaimer reclaimer;
+	// счетчик переносов между ячейками как в seqlock: нечетный, пока перенос не опубликован целиком
+	std::atomic<std::uint64_t> moveSequence{ 0 };
+
+	// Журнал последних переносов: перенос с нечетным номером s лежит в слоте (s / 2) % moveLogSize,
+	// sequence слота равен s, пока слот не начали перезаписывать
+	struct MoveRecord
+	{
+		std::atomic<std::uint64_t> sequence{ 0 };
+		std::atomic<std::uint32_t> from{ 0 };
+		std::atomic<std::uint32_t> to{ 0 };
+	};
+
+	static constexpr std::uint64_t moveLogSize = 64;
+	MoveRecord moveLog[moveLogSize];
+
+	// Прямоугольник ячеек [x0, x1] x [y0, y1], просмотренных запросом
+	struct CellBox
+	{
+		int x0;
+		int y0;
+		int x1;
+		int y1;
+
+		bool contains(std::size_t cell, int columns) const
+		{
+			const int gx = static_cast<int>(cell % columns);
+			const int gy = static_cast<int>(cell / columns);
+			return gx >= x0 && gx <= x1 && gy >= y0 && gy <= y1;
+		}
+	};
+
+	// состояние писателя
+	std::mutex writerMutex;
+	std::vector<Point2d> positions;
+	std::vector<std::uint8_t> alive;
+	std::size_t retiredSinceCollect = 0;
+
+public:
+	// Запросы одного читателя видят ячейки не старше момента создания Reader;
+	// пока Reader жив, прочитанные им массивы не освобождаются, поэтому держать его долго не стоит
+	class Reader
+	{
+	private:
+		const ConcurrentGrid& grid;
+		EpochReclaimer::Guard guard;
+
+		// Запрос повторяется, если за время обхода писатель переносил точку между двумя ячейками,
+		// которые запрос просмотрел: иначе читатель мог увидеть новую ячейку до переноса, а старую -
+		// после, и потерять точку. Переносы, задевшие не больше одной из просмотренных ячеек, не мешают
+		template <class Query>
+		auto consistent(Query query) const
+		{
+			for (;;)
+			{
+				const std::uint64_t before = grid.moveSequence.load(std::memory_order_acquire);
+				CellBox visited = { 0, 0, -1, -1 };
+				auto result = query(visited);
+				const std::uint64_t after = grid.moveSequence.load(std::memory_order_acquire);
+				if ((after == before && !(before & 1)) || !grid.movedAcross(before, after, visited))
+				{
+					return result;
+				}
+			}
+		}
+
+		long long nearestOnce(double x, double y, double maxDistance, double* distance2, CellBox& visited) const
+		{
+			long long best = -1;
+			double bestDist2 = maxDistance * maxDistance;
+			const int cx = std::clamp(static_cast<int>(std::floor(x / grid.cellSize)), 0, grid.columns - 1);
+			const int cy = std::clamp(static_cast<int>(std::floor(y / grid.cellSize)), 0, grid.rows - 1);
+			const int maxRing = std::max(grid.columns, grid.rows);
+
+			for (int ring = 0; ring <= maxRing; ring++)
+			{
+				double ringGap = grid.ringDistance(x, y, cx, cy, ring);
+				if (ringGap * ringGap > bestDist2)
+				{
+					break;
+				}
+				visited = { cx - ring, cy - ring, cx + ring, cy + ring };
+				for (int gy = cy - ring; gy <= cy + ring; gy++)
+				{
+					if (gy < 0 || gy >= grid.rows)
+					{
+						continue;
+					}
+					bool edgeRow = gy == cy - ring || gy == cy + ring;
+					int step = edgeRow ? 1 : 2 * ring;
+					for (int gx = cx - ring; gx <= cx + ring; gx += std::max(step, 1))
+					{
+						if (gx < 0 || gx >= grid.columns)
+						{
+							continue;
+						}
+						const CellArray* cell = grid.cells[static_cast<std::size_t>(gy) * grid.columns + gx].load(std::memory_order_acquire);
+						if (!cell)
+						{
+							continue;
+						}
+						for (const GridEntry& entry : cell->entries)
+						{
+							double dx = entry.x - x;
+							double dy = entry.y - y;
+							double d2 = dx * dx + dy * dy;
+							if (d2 < bestDist2)
+							{
+								bestDist2 = d2;
+								best = entry.id;
+							}
+						}
+					}
+				}
+			}
+
+			if (distance2 && best >= 0)
+			{
+				*distance2 = bestDist2;
+			}
+			return best;
+		}
+
+		std::vector<GridEntry> rangeOnce(int x0, int y0, int x1, int y1, CellBox& visited) const
+		{
+			std::vector<GridEntry> result;
+			if (x1 < x0 || y1 < y0)
+			{
+				return result;
+			}
+			const int gx0 = std::clamp(x0 / grid.cellSize, 0, grid.columns - 1);
+			const int gx1 = std::clamp(x1 / grid.cellSize, 0, grid.columns - 1);
+			const int gy0 = std::clamp(y0 / grid.cellSize, 0, grid.rows - 1);
+			const int gy1 = std::clamp(y1 / grid.cellSize, 0, grid.rows - 1);
+			visited = { gx0, gy0, gx1, gy1 };
+			for (int gy = gy0; gy <= gy1; gy++)
+			{
+				for (int gx = gx0; gx <= gx1; gx++)
+				{
+					const CellArray* cell = grid.cells[static_cast<std::size_t>(gy) * grid.columns + gx].load(std::memory_order_acquire);
+					if (!cell)
+					{
+						continue;
+					}
+					for (const GridEntry& entry : cell->entries)
+					{
+						if (entry.x >= x0 && entry.x <= x1 && entry.y >= y0 && entry.y <= y1)
+						{
+							result.push_back(entry);
+						}
+					}
+				}
+			}
+			return result;
+		}
+
+	public:
+		Reader(const ConcurrentGrid& grid, EpochReclaimer::Guard guard) : grid(grid), guard(std::move(guard)) {}
+
+		// id ближайшей точки не дальше maxDistance или -1
+		long long nearest(double x, double y, double maxDistance = std::numeric_limits<double>::infinity(), double* distance2 = nullptr) const
+		{
+			double found = 0;
+			const long long best = consistent([&](CellBox& visited) { return nearestOnce(x, y, maxDistance, &found, visited); });
+			if (distance2 && best >= 0)
+			{
+				*distance2 = found;
+			}
+			return best;
+		}
+
+		// Точки в прямоугольнике [x0, x1] x [y0, y1]. Переносимая точка попадает в ответ ровно один раз:
+		// в старой ячейке или в новой
+		std::vector<GridEntry> range(int x0, int y0, int x1, int y1) const
+		{
+			return consistent([&](CellBox& visited) { return rangeOnce(x0, y0, x1, y1, visited); });
+		}
+	};
+
+	ConcurrentGrid(int cellSize = 16, int width = screenWidth, int height = screenHeight) : cellSize(cellSize)
+	{
+		if (cellSize <= 0 || width <= 0 || height <= 0)
+		{
+			throw std::invalid_argument("Размер ячейки и окна должен быть положительным");
+		}
+		columns = (width + cellSize - 1) / cellSize;
+		rows = (height + cellSize - 1) / cellSize;
+		cells.reset(new std::atomic<const CellArray*>[static_cast<std::size_t>(columns) * rows]);
+		for (std::size_t i = 0; i < static_cast<std::size_t>(columns) * rows; i++)
+		{
+			cells[i].store(nullptr, std::memory_order_relaxed);
+		}
+	}
+
+	ConcurrentGrid(const ConcurrentGrid&) = delete;
+	ConcurrentGrid& operator=(const ConcurrentGrid&) = delete;
+
+	~ConcurrentGrid()
+	{
+		for (std::size_t i = 0; i < static_cast<std::size_t>(columns) * rows; i++)
+		{
+			delete cells[i].load(std::memory_order_relaxed);
+		}
+	}
+
+	Reader read() const
+	{
+		return Reader(*this, reclaimer.pin());
+	}
+
+	// Добавляет точку и возвращает ее id
+	std::uint32_t insert(const Point2d& p)
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		const std::uint32_t id = static_cast<std::uint32_t>(positions.size());
+		positions.push_back(p);
+		alive.push_back(1);
+		const GridEntry entry = { id, p.getX(), p.getY() };
+		publish(cellOf(p), nullptr, &entry);
+		return id;
+	}
+
+	// Несколько точек за раз: каждая ячейка публикуется один раз
+	void insert(const std::vector<Point2d>& points)
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		std::vector<std::vector<GridEntry>> added(static_cast<std::size_t>(columns) * rows);
+		for (const Point2d& p : points)
+		{
+			const std::uint32_t id = static_cast<std::uint32_t>(positions.size());
+			positions.push_back(p);
+			alive.push_back(1);
+			added[cellOf(p)].push_back({ id, p.getX(), p.getY() });
+		}
+		for (std::size_t cell = 0; cell < added.size(); cell++)
+		{
+			if (added[cell].empty())
+			{
+				continue;
+			}
+			const CellArray* old = cells[cell].load(std::memory_order_relaxed);
+			CellArray* next = new CellArray();
+			if (old)
+			{
+				next->entries = old->entries;
+			}
+			next->entries.insert(next->entries.end(), added[cell].begin(), added[cell].end());
+			replace(cell, next);
+		}
+	}
+
+	// Переносит точку. Перенос между ячейками - две публикации: он записывается в журнал, на время
+	// публикации счетчик переносов нечетный, и запросы, просмотревшие обе ячейки, повторяются
+	void move(std::uint32_t id, const Point2d& p)
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		checkId(id);
+		const std::size_t from = cellOf(positions[id]);
+		const std::size_t to = cellOf(p);
+		positions[id] = p;
+		const GridEntry entry = { id, p.getX(), p.getY() };
+		if (from == to)
+		{
+			publish(to, &id, &entry);
+		}
+		else
+		{
+			const std::uint64_t sequence = moveSequence.load(std::memory_order_relaxed) + 1;
+			MoveRecord& record = moveLog[(sequence / 2) % moveLogSize];
+			record.sequence.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			record.from.store(static_cast<std::uint32_t>(from), std::memory_order_relaxed);
+			record.to.store(static_cast<std::uint32_t>(to), std::memory_order_relaxed);
+			record.sequence.store(sequence, std::memory_order_release);
+			moveSequence.store(sequence, std::memory_order_release);
+			publish(to, nullptr, &entry);
+			publish(from, &id, nullptr);
+			moveSequence.store(sequence + 1, std::memory_order_release);
+		}
+	}
+
+	void remove(std::uint32_t id)
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		checkId(id);
+		alive[id] = 0;
+		publish(cellOf(positions[id]), &id, nullptr);
+	}
+
+	std::size_t size()
+	{
+		std::lock_guard<std::mutex> lock(writerMutex);
+		return static_cast<std::size_t>(std::count(alive.begin(), alive.end(), 1));
+	}
+
+	int getCellSize() const { return cellSize; }
+
+private:
+	// Был ли среди переносов с номерами от before до after перенос между двумя ячейками box.
+	// Перенос, шедший во время чтения before, тоже учитывается; перезаписанный журнал считается переносом
+	bool movedAcross(std::uint64_t before, std::uint64_t after, const CellBox& box) const
+	{
+		const std::uint64_t first = before | 1;
+		if (after < first)
+		{
+			return false;
+		}
+		if ((after - first) / 2 >= moveLogSize)
+		{
+			return true;
+		}
+		for (std::uint64_t sequence = first; sequence <= after; sequence += 2)
+		{
+			const MoveRecord& record = moveLog[(sequence / 2) % moveLogSize];
+			const std::uint64_t stamp = record.sequence.load(std::memory_order_acquire);
+			const std::uint32_t from = record.from.load(std::memory_order_relaxed);
+			const std::uint32_t to = record.to.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (stamp != sequence || record.sequence.load(std::memory_order_relaxed) != sequence)
+			{
+				return true;
+			}
+			if (box.contains(from, columns) && box.contains(to, columns))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void checkId(std::uint32_t id) const
+	{
+		if (id >= positions.size() || !alive[id])
+		{
+			throw std::out_of_range("Нет точки с таким id");
+		}
+	}
+
+	std::size_t cellOf(const Point2d& p) const
+	{
+		const int gx = std::min(p.getX() / cellSize, columns - 1);
+		const int gy = std::min(p.getY() / cellSize, rows - 1);
+		return static_cast<std::size_t>(gy) * columns + gx;
+	}
+
+	// Новая копия ячейки: без записи removeId (если задан) и с добавленной add (если задана)
+	void publish(std::size_t cell, const std::uint32_t* removeId, const GridEntry* add)
+	{
+		const CellArray* old = cells[cell].load(std::memory_order_relaxed);
+		CellArray* next = new CellArray();
+		if (old)
+		{
+			next->entries.reserve(old->entries.size() + 1);
+			for (const GridEntry& entry : old->entries)
+			{
+				if (!removeId || entry.id != *removeId)
+				{
+					next->entries.push_back(entry);
+				}
+			}
+		}
+		if (add)
+		{
+			next->entries.push_back(*add);
+		}
+		if (next->entries.empty())
+		{
+			delete next;
+			next = nullptr;
+		}
+		replace(cell, next);
+	}
+
+	void replace(std::size_t cell, const CellArray* next)
+	{
+		const CellArray* old = cells[cell].exchange(next, std::memory_order_seq_cst);
+		if (old)
+		{
+			reclaimer.retire(old);
+			// сборка пачками: один проход по слотам читателей на много замен
+			if (++retiredSinceCollect >= 256)
+			{
+				reclaimer.collect();
+				retiredSinceCollect = 0;
+			}
+		}
+	}
+
+	double ringDistance(double x, double y, int cx, int cy, int ring) const
+	{
+		if (ring == 0)
+		{
+			return 0;
+		}
+		double left = (cx - ring + 1) * static_cast<double>(cellSize);
+		double right = (cx + ring) * static_cast<double>(cellSize);
+		double bottom = (cy - ring + 1) * static_cast<double>(cellSize);
+		double top = (cy + ring) * static_cast<double>(cellSize);
+		return std::max(0.0, std::min({ x - left, right - x, y - bottom, top - y }));
+	}
+};
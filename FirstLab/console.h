@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// Вывод в консоль с позиционированием курсора и цветом.
+// В Windows - через консольный API, как в псевдографическом тексте, в остальных системах - ANSI-последовательности.
+
+enum class Color { Black, Blue, Green, Cyan, Red, Magenta, Yellow, White,
+	BrightBlack, BrightBlue, BrightGreen, BrightCyan, BrightRed, BrightMagenta, BrightYellow, BrightWhite };
+
+const int colorCount = 16;
+
+class Console
+{
+public:
+	static void setCursor(int line, int column)
+	{
+#ifdef _WIN32
+		std::cout.flush();
+		COORD coord;
+		coord.X = static_cast<SHORT>(column);
+		coord.Y = static_cast<SHORT>(line);
+		SetConsoleCursorPosition(GetStdHandle(STD_OUTPUT_HANDLE), coord);
+#else
+		std::cout << "\x1b[" << line + 1 << ';' << column + 1 << 'H';
+#endif
+	}
+
+	static void setColor(Color text, Color background = Color::Black)
+	{
+#ifdef _WIN32
+		std::cout.flush();
+		SetConsoleTextAttribute(GetStdHandle(STD_OUTPUT_HANDLE), static_cast<int>(background) * 16 + static_cast<int>(text));
+#else
+		std::cout << "\x1b[" << ansiCode(text, 30) << ';' << ansiCode(background, 40) << 'm';
+#endif
+	}
+
+	static void resetColor()
+	{
+#ifdef _WIN32
+		setColor(Color::BrightWhite, Color::Black);
+#else
+		std::cout << "\x1b[0m";
+#endif
+	}
+
+	static void write(const std::string& text)
+	{
+		std::cout << text;
+	}
+
+	static void flush()
+	{
+		std::cout.flush();
+	}
+
+	// Псевдографике за пределами ASCII (шрифт Брайля, блоки) нужна кодовая страница UTF-8
+	static void enableUtf8()
+	{
+#ifdef _WIN32
+		static const bool enabled = SetConsoleOutputCP(CP_UTF8) != 0;
+		(void)enabled;
+#endif
+	}
+
+private:
+	// Порядок цветов консоли Windows: бит 0 - синий, 1 - зеленый, 2 - красный; в ANSI наоборот
+	static int ansiCode(Color color, int base)
+	{
+		static const int order[8] = { 0, 4, 2, 6, 1, 5, 3, 7 };
+		const int index = static_cast<int>(color);
+		return (index >= 8 ? base + 60 : base) + order[index & 7];
+	}
+};
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include "geometry.h"
+
+// > 0 если поворот a -> b -> c против часовой стрелки
+inline long long orientation(const Point2d& a, const Point2d& b, const Point2d& c)
+{
+	Vector2d ab(b, a);
+	Vector2d ac(c, a);
+	return ab.crossProduct(ac);
+}
+
+// Выпуклая оболочка (алгоритм Эндрю), вершины против часовой стрелки без коллинеарных
+inline std::vector<Point2d> convexHull(std::vector<Point2d> points)
+{
+	std::sort(points.begin(), points.end(), [](const Point2d& a, const Point2d& b)
+	{
+		return a.getX() < b.getX() || (a.getX() == b.getX() && a.getY() < b.getY());
+	});
+	points.erase(std::unique(points.begin(), points.end(), [](const Point2d& a, const Point2d& b)
+	{
+		return a.getX() == b.getX() && a.getY() == b.getY();
+	}), points.end());
+
+	if (points.size() < 3)
+	{
+		return points;
+	}
+
+	std::vector<Point2d> hull(2 * points.size());
+	std::size_t k = 0;
+	for (std::size_t i = 0; i < points.size(); i++)
+	{
+		while (k >= 2 && orientation(hull[k - 2], hull[k - 1], points[i]) <= 0)
+		{
+			k--;
+		}
+		hull[k++] = points[i];
+	}
+	for (std::size_t i = points.size() - 1, lower = k + 1; i > 0; i--)
+	{
+		while (k >= lower && orientation(hull[k - 2], hull[k - 1], points[i - 1]) <= 0)
+		{
+			k--;
+		}
+		hull[k++] = points[i - 1];
+	}
+
+	hull.resize(k - 1);
+	return hull;
+}
@@ -0,0 +1,483 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "geometry.h"
+#include "convex_hull.h"
+
+// Динамическая выпуклая оболочка (Овермарс - ван Леувен) со вставкой и удалением точек.
+// Координаты Point2d ограничены окном, поэтому дерево строится над столбцами окна, а не над точками:
+// форма дерева постоянна и балансировать его не нужно. Узел хранит мост между оболочками своих детей,
+// после изменения столбца мосты пересчитываются на пути к корню, каждый за один спуск - O(log^2 W).
+
+class DynamicHull
+{
+private:
+	// Верхняя цепь над столбцами. Нижняя цепь - та же структура с отраженной осью y.
+	class Chain
+	{
+	private:
+		int leaves = 1;
+		std::vector<int> value;      // y вершины столбца или INT_MIN
+		std::vector<int> filled;     // число непустых столбцов в поддереве
+		std::vector<int> bridgeLeft; // столбцы концов моста
+		std::vector<int> bridgeRight;
+		std::vector<int> split;      // последний столбец левого поддерева
+
+	public:
+		explicit Chain(int width)
+		{
+			while (leaves < width)
+			{
+				leaves *= 2;
+			}
+			value.assign(leaves, INT_MIN);
+			filled.assign(2 * leaves, 0);
+			bridgeLeft.assign(leaves, -1);
+			bridgeRight.assign(leaves, -1);
+			split.assign(leaves, 0);
+			for (int node = leaves - 1; node >= 1; node--)
+			{
+				int leftmost = node;
+				while (leftmost < leaves)
+				{
+					leftmost *= 2;
+				}
+				int span = leaves;
+				for (int n = node; n > 1; n /= 2)
+				{
+					span /= 2;
+				}
+				split[node] = leftmost - leaves + span / 2 - 1;
+			}
+		}
+
+		// Новое значение столбца x (INT_MIN - столбец пуст)
+		void update(int x, int y)
+		{
+			value[x] = y;
+			int node = leaves + x;
+			filled[node] = y != INT_MIN;
+			for (node /= 2; node >= 1; node /= 2)
+			{
+				filled[node] = filled[2 * node] + filled[2 * node + 1];
+				if (filled[2 * node] && filled[2 * node + 1])
+				{
+					findBridge(node);
+				}
+			}
+		}
+
+		bool empty() const { return filled[1] == 0; }
+
+		// Вершины цепи слева направо
+		void collect(std::vector<Point2d>& out) const
+		{
+			if (!empty())
+			{
+				collect(1, 0, leaves - 1, out);
+			}
+		}
+
+		// Вершина, максимизирующая dx * x + dy * y при dy >= 0
+		Point2d extreme(long long dx, long long dy) const
+		{
+			int node = normalize(1);
+			while (node < leaves)
+			{
+				const Point2d a = point(bridgeLeft[node]);
+				const Point2d b = point(bridgeRight[node]);
+				const long long fa = dx * a.getX() + dy * a.getY();
+				const long long fb = dx * b.getX() + dy * b.getY();
+				node = normalize(fb >= fa ? 2 * node + 1 : 2 * node);
+			}
+			return point(node - leaves);
+		}
+
+		// Самая дальняя против часовой (или по часовой) стрелки вершина цепи среди столбцов [from, to],
+		// если смотреть из q. По одну сторону от столбца q угол вдоль цепи унимодален, поэтому
+		// достаточно сравнивать концы моста. false, если в диапазоне нет вершин цепи
+		bool turn(const Point2d& q, bool counterClockwise, int from, int to, Point2d& best) const
+		{
+			if (empty())
+			{
+				return false;
+			}
+			int node = normalize(1);
+			while (node < leaves)
+			{
+				const int left = bridgeLeft[node];
+				const int right = bridgeRight[node];
+				bool goRight;
+				if (to <= left)
+				{
+					goRight = false;
+				}
+				else if (from >= right)
+				{
+					goRight = true;
+				}
+				else if (to < right || from > left)
+				{
+					// диапазон целиком внутри моста
+					if (from > left && to < right)
+					{
+						return false;
+					}
+					goRight = from > left;
+				}
+				else
+				{
+					const long long turn = orientation(q, point(left), point(right));
+					goRight = counterClockwise ? turn > 0 : turn < 0;
+				}
+				if (goRight)
+				{
+					from = std::max(from, right);
+				}
+				else
+				{
+					to = std::min(to, left);
+				}
+				node = normalize(goRight ? 2 * node + 1 : 2 * node);
+			}
+			best = point(node - leaves);
+			return best.getX() >= from && best.getX() <= to;
+		}
+
+	private:
+		Point2d point(int x) const
+		{
+			return Point2d(x, value[x], INT_MAX, INT_MAX);
+		}
+
+		// Узел с одним пустым ребенком ничего не добавляет: его оболочка - оболочка другого ребенка
+		int normalize(int node) const
+		{
+			while (node < leaves && (!filled[2 * node] || !filled[2 * node + 1]))
+			{
+				node = filled[2 * node] ? 2 * node : 2 * node + 1;
+			}
+			return node;
+		}
+
+		Point2d edgeLeft(int node) const { return node >= leaves ? point(node - leaves) : point(bridgeLeft[node]); }
+		Point2d edgeRight(int node) const { return node >= leaves ? point(node - leaves) : point(bridgeRight[node]); }
+
+		// Одновременный спуск по оболочкам левого и правого поддерева: на каждом шаге ребро ab слева
+		// и ребро cd справа позволяют отбросить половину одной из оболочек
+		void findBridge(int node)
+		{
+			int l = normalize(2 * node);
+			int r = normalize(2 * node + 1);
+			const long long doubledSplit = 2LL * split[node] + 1;
+			while (l < leaves || r < leaves)
+			{
+				const Point2d a = edgeLeft(l);
+				const Point2d b = edgeRight(l);
+				const Point2d c = edgeLeft(r);
+				const Point2d d = edgeRight(r);
+				const bool leftLeaf = l >= leaves;
+				const bool rightLeaf = r >= leaves;
+
+				if (!leftLeaf && orientation(a, b, c) > 0)
+				{
+					// c выше прямой ab: мост уходит с левой оболочки не правее a
+					l = normalize(2 * l);
+				}
+				else if (!rightLeaf && orientation(c, d, b) > 0)
+				{
+					// b выше прямой cd: мост приходит на правую оболочку не левее d
+					r = normalize(2 * r + 1);
+				}
+				else if (leftLeaf)
+				{
+					r = normalize(2 * r);
+				}
+				else if (rightLeaf)
+				{
+					l = normalize(2 * l + 1);
+				}
+				else
+				{
+					// обе точки ниже чужих ребер: решает, по какую сторону разделяющей вертикали
+					// пересекаются прямые ab и cd
+					const long long abx = b.getX() - a.getX();
+					const long long aby = b.getY() - a.getY();
+					const long long cdx = d.getX() - c.getX();
+					const long long cdy = d.getY() - c.getY();
+					const long long numerator = (c.getX() - a.getX()) * cdy - (c.getY() - a.getY()) * cdx;
+					long long denominator = abx * cdy - aby * cdx;
+					long long side = 2 * (a.getX() * denominator + abx * numerator) - doubledSplit * denominator;
+					if (denominator < 0)
+					{
+						side = -side;
+					}
+					if (denominator == 0 || side < 0)
+					{
+						l = normalize(2 * l + 1);
+					}
+					else
+					{
+						r = normalize(2 * r);
+					}
+				}
+			}
+			bridgeLeft[node] = l - leaves;
+			bridgeRight[node] = r - leaves;
+		}
+
+		void collect(int node, int from, int to, std::vector<Point2d>& out) const
+		{
+			node = normalize(node);
+			if (node >= leaves)
+			{
+				const int x = node - leaves;
+				if (x >= from && x <= to)
+				{
+					out.push_back(point(x));
+				}
+				return;
+			}
+			collect(2 * node, from, std::min(to, bridgeLeft[node]), out);
+			collect(2 * node + 1, std::max(from, bridgeRight[node]), to, out);
+		}
+	};
+
+	int width;
+	int height;
+	std::vector<std::multiset<int>> columns;
+	std::size_t count = 0;
+	Chain upper;
+	Chain lower;
+
+public:
+	DynamicHull(int width = screenWidth, int height = screenHeight) : width(width), height(height),
+		columns(width > 0 ? width : 0), upper(width > 0 ? width : 1), lower(width > 0 ? width : 1)
+	{
+		if (width <= 0 || height <= 0)
+		{
+			throw std::invalid_argument("Размеры окна должны быть положительными");
+		}
+	}
+
+	std::size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+
+	void insert(const Point2d& p)
+	{
+		check(p);
+		std::multiset<int>& column = columns[p.getX()];
+		column.insert(p.getY());
+		count++;
+		refresh(p.getX());
+	}
+
+	// Удаляет одну копию точки; false, если такой нет
+	bool erase(const Point2d& p)
+	{
+		check(p);
+		std::multiset<int>& column = columns[p.getX()];
+		auto found = column.find(p.getY());
+		if (found == column.end())
+		{
+			return false;
+		}
+		column.erase(found);
+		count--;
+		refresh(p.getX());
+		return true;
+	}
+
+	bool contains(const Point2d& p) const
+	{
+		return p.getX() >= 0 && p.getX() < width && columns[p.getX()].count(p.getY()) != 0;
+	}
+
+	// Вершины против часовой стрелки без коллинеарных, как у convexHull
+	std::vector<Point2d> hull() const
+	{
+		std::vector<Point2d> lowerChain;
+		std::vector<Point2d> upperChain;
+		lower.collect(lowerChain);
+		upper.collect(upperChain);
+
+		std::vector<Point2d> ring;
+		for (const Point2d& p : lowerChain)
+		{
+			ring.push_back(unmirror(p));
+		}
+		for (auto it = upperChain.rbegin(); it != upperChain.rend(); ++it)
+		{
+			ring.push_back(*it);
+		}
+
+		// общие концы цепей и точки на ребрах убираются одним проходом со стеком
+		std::vector<Point2d> result;
+		for (const Point2d& p : ring)
+		{
+			if (!result.empty() && same(result.back(), p))
+			{
+				continue;
+			}
+			while (result.size() >= 2 && orientation(result[result.size() - 2], result.back(), p) <= 0)
+			{
+				result.pop_back();
+			}
+			result.push_back(p);
+		}
+		while (result.size() >= 2 && same(result.front(), result.back()))
+		{
+			result.pop_back();
+		}
+		while (result.size() >= 3 && orientation(result[result.size() - 2], result.back(), result.front()) <= 0)
+		{
+			result.pop_back();
+		}
+		if (result.size() < 3 && !ring.empty())
+		{
+			// все точки на одной прямой: стек теряет дальний конец, когда кольцо идет по отрезку назад.
+			// Как и convexHull, возвращаются два крайних конца или одна точка
+			auto less = [](const Point2d& a, const Point2d& b) { return a.getX() < b.getX() || (a.getX() == b.getX() && a.getY() < b.getY()); };
+			const auto [first, last] = std::minmax_element(ring.begin(), ring.end(), less);
+			result.assign(1, *first);
+			if (!same(*first, *last))
+			{
+				result.push_back(*last);
+			}
+		}
+		return result;
+	}
+
+	// Крайняя точка множества в направлении direction
+	Point2d extreme(const Vector2d& direction) const
+	{
+		if (empty())
+		{
+			throw std::logic_error("Оболочка пуста");
+		}
+		return extreme(direction.getCoordX(), direction.getCoordY());
+	}
+
+	// Касательные из точки q: ccw - самая дальняя вершина против часовой стрелки, cw - по часовой.
+	// false, если q внутри оболочки или на ее границе. Если оболочка - точка или отрезок на одной прямой
+	// с q, обе касательные совпадают и идут в ближайшую к q вершину
+	bool tangents(const Point2d& q, Point2d& ccw, Point2d& cw) const
+	{
+		if (empty() || contains(q))
+		{
+			return false;
+		}
+		const Point2d mirroredQ = mirror(q);
+		bool foundCcw = false;
+		bool foundCw = false;
+		const int ranges[2][2] = { { 0, q.getX() }, { q.getX(), width - 1 } };
+		for (const auto& range : ranges)
+		{
+			Point2d candidate;
+			if (upper.turn(q, true, range[0], range[1], candidate))
+			{
+				keepTurn(q, candidate, true, foundCcw, ccw);
+			}
+			if (upper.turn(q, false, range[0], range[1], candidate))
+			{
+				keepTurn(q, candidate, false, foundCw, cw);
+			}
+			// отражение меняет направление обхода
+			if (lower.turn(mirroredQ, false, range[0], range[1], candidate))
+			{
+				keepTurn(q, unmirror(candidate), true, foundCcw, ccw);
+			}
+			if (lower.turn(mirroredQ, true, range[0], range[1], candidate))
+			{
+				keepTurn(q, unmirror(candidate), false, foundCw, cw);
+			}
+		}
+
+		if (!foundCcw || !foundCw)
+		{
+			return false;
+		}
+
+		// q снаружи, только если по другую сторону от прямой q-ccw нет ни одной точки
+		const long long alongX = static_cast<long long>(ccw.getX()) - q.getX();
+		const long long alongY = static_cast<long long>(ccw.getY()) - q.getY();
+		const Point2d farthest = extreme(-alongY, alongX);
+		if (orientation(q, ccw, farthest) > 0)
+		{
+			return false;
+		}
+		if (orientation(q, cw, ccw) > 0)
+		{
+			return true;
+		}
+
+		// вырожденная оболочка: все точки на прямой q-ccw; q снаружи, если и ближайшая вершина лежит впереди q
+		if (orientation(q, ccw, farthest) == 0 && orientation(q, ccw, extreme(alongY, -alongX)) == 0)
+		{
+			const Point2d nearest = extreme(-alongX, -alongY);
+			if ((nearest.getX() - q.getX()) * alongX + (nearest.getY() - q.getY()) * alongY > 0)
+			{
+				ccw = nearest;
+				cw = nearest;
+				return true;
+			}
+		}
+		return false;
+	}
+
+private:
+	void check(const Point2d& p) const
+	{
+		if (p.getX() < 0 || p.getX() >= width || p.getY() < 0 || p.getY() >= height)
+		{
+			throw std::invalid_argument("Точка вне окна оболочки");
+		}
+	}
+
+	void keepTurn(const Point2d& q, const Point2d& candidate, bool counterClockwise, bool& found, Point2d& best) const
+	{
+		const long long turn = orientation(q, best, candidate);
+		if (!found || (counterClockwise ? turn > 0 : turn < 0))
+		{
+			best = candidate;
+		}
+		found = true;
+	}
+
+	// Направление задается числами: Vector2d(x, y) не допускает отрицательных координат
+	Point2d extreme(long long dx, long long dy) const
+	{
+		if (dy >= 0)
+		{
+			return upper.extreme(dx, dy);
+		}
+		return unmirror(lower.extreme(dx, -dy));
+	}
+
+	void refresh(int x)
+	{
+		const std::multiset<int>& column = columns[x];
+		upper.update(x, column.empty() ? INT_MIN : *column.rbegin());
+		lower.update(x, column.empty() ? INT_MIN : height - 1 - *column.begin());
+	}
+
+	Point2d mirror(const Point2d& p) const
+	{
+		return Point2d(p.getX(), height - 1 - p.getY(), INT_MAX, INT_MAX);
+	}
+
+	Point2d unmirror(const Point2d& p) const
+	{
+		return Point2d(p.getX(), height - 1 - p.getY(), width, height);
+	}
+
+	static bool same(const Point2d& a, const Point2d& b)
+	{
+		return a.getX() == b.getX() && a.getY() == b.getY();
+	}
+};
@@ -2,124 +2,765 @@
 #include <string>
 #include <stdexcept>
 #include <cmath>
+#include <vector>
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+
+#include "geometry.h"
+#include "hough.h"
+#include "icp.h"
+#include "batch.h"
+#include "shm_transport.h"
+#include "convex_hull.h"
+#include "index_snapshot.h"
+#include "trace.h"
+#include "terminal_canvas.h"
+#include "scatter_plot.h"
+#include "versioned_store.h"
+#include "dynamic_hull.h"
+#include "polygon_fill.h"
+#include "trajectory_store.h"
+#include "visibility.h"
+#include "polygon_offset.h"
+#include "polyline_match.h"
+#include "grid_ray.h"
+#include "point_pyramid.h"
+
+#ifdef __linux__
+#include <sys/wait.h>
+#endif
 
 using namespace std;
 
-const int screenWidth = 800;
-const int screenHeight = 600;
+void houghDemo()
+{
+	// два штриха и шум
+	vector<Point2d> points;
+	for (int i = 0; i < 400; i++)
+	{
+		points.push_back(Point2d(100 + i, 100 + i / 2, screenWidth, screenHeight));
+		points.push_back(Point2d(600, 50 + i, screenWidth, screenHeight));
+		points.push_back(Point2d((i * 7919) % screenWidth, (i * 104729) % screenHeight, screenWidth, screenHeight));
+	}
+
+	HoughTransform hough;
+	for (const HoughLine& line : hough.detect(points, 100, 4))
+	{
+		cout << "Прямая theta=" << line.theta << " rho=" << line.rho << " голосов=" << line.votes << endl;
+		for (const HoughSegment& segment : line.segments)
+		{
+			cout << "  отрезок " << segment.from.pointToString() << " - " << segment.to.pointToString()
+				<< " точек=" << segment.points << endl;
+		}
+	}
+
+	// шаг rho, не делящий rhoMax: прямая x = 300 должна найтись с rho около 300 и с отрезком
+	vector<Point2d> vertical;
+	for (int i = 0; i < 300; i++)
+	{
+		vertical.push_back(Point2d(300, 100 + i, screenWidth, screenHeight));
+	}
+	HoughTransform coarse(180, 3.0);
+	for (const HoughLine& line : coarse.detect(vertical, 100, 1))
+	{
+		cout << "Шаг rho 3: theta=" << line.theta << " rho=" << line.rho << " отрезков=" << line.segments.size() << endl;
+	}
+}
 
-class Point2d
+void icpDemo()
 {
-private: 
-	int x;
-	int y;
+	// вторая съемка сдвинута на (6, -4) и повернута на 2 градуса
+	vector<Point2d> target;
+	vector<Point2d> source;
+	const double angle = 2.0 * acos(-1.0) / 180.0;
+	for (int i = 0; i < 720; i++)
+	{
+		// окружность и синусоида
+		double t = i * acos(-1.0) / 180.0;
+		int x = i % 2 ? static_cast<int>(400 + 150 * cos(t)) : 150 + i * 500 / 720;
+		int y = i % 2 ? static_cast<int>(300 + 150 * sin(t)) : static_cast<int>(120 + 40 * sin(t * 3));
+		target.push_back(Point2d(x, y, screenWidth, screenHeight));
+		int sx = static_cast<int>(lround(cos(angle) * (x - 400) - sin(angle) * (y - 300) + 400 + 6));
+		int sy = static_cast<int>(lround(sin(angle) * (x - 400) + cos(angle) * (y - 300) + 300 - 4));
+		source.push_back(Point2d(sx, sy, screenWidth, screenHeight));
+	}
 
-public:
-	Point2d() : x(0), y(0) {}
+	IcpRegistration icp(target);
+	IcpResult result = icp.align(source);
+	cout << "ICP: итераций=" << result.iterations << " время=" << result.seconds * 1000 << " мс"
+		<< " угол=" << result.transform.angle * 180.0 / acos(-1.0) << " сдвиг=(" << result.transform.tx << ", " << result.transform.ty << ")"
+		<< " rms=" << result.rmsError << " сошелся=" << result.converged << endl;
+}
 
-	Point2d(int x, int y, int screenWidth, int screenHeight)
+void shmTransportDemo()
+{
+#ifdef __linux__
+	// производитель в дочернем процессе пишет векторы прямо в разделяемые слоты
+	const int batches = 64;
+	ShmBatchRing ring = ShmBatchRing::create(8, 4096);
+	pid_t child = fork();
+	if (child == 0)
 	{
-		if (x < 0 || y < 0 || x >= screenWidth || y >= screenHeight)
+		ShmBatchRing producer = ShmBatchRing::attach(ring.fd());
+		for (int b = 0; b < batches; b++)
 		{
-			throw invalid_argument("Координаты должны быть внутри окна (начало координат левый нижний угол)");
+			ShmBatchSlot slot = producer.acquireWrite();
+			for (std::uint32_t i = 0; i < slot.capacity; i++)
+			{
+				slot.x[i] = 3 * (b + 1);
+				slot.y[i] = 4 * (b + 1);
+			}
+			*slot.count = slot.capacity;
+			producer.publish();
 		}
+		producer.close();
+		_exit(0);
+	}
 
-		this->x = x;
-		this->y = y;
+	double total = 0;
+	int received = 0;
+	for (ShmBatchSlot slot = ring.acquireRead(); slot.count; slot = ring.acquireRead())
+	{
+		total += batchLengthSum(slot.x, slot.y, *slot.count);
+		ring.release();
+		received++;
 	}
+	waitpid(child, nullptr, 0);
+	cout << "Разделяемая память: пакетов=" << received << " сумма длин=" << total << endl;
+#endif
+}
 
-	int getX() const { return x; }
+void snapshotDemo()
+{
+#ifdef __unix__
+	vector<Point2d> points;
+	for (int i = 0; i < 5000; i++)
+	{
+		points.push_back(Point2d((i * 7919) % screenWidth, (i * 6271) % screenHeight, screenWidth, screenHeight));
+	}
+	SpatialGrid grid(points);
+	saveGridSnapshot(grid, convexHull(points), "grid.snapshot");
 
-	int getY() const { return y; }
+	GridSnapshot snapshot("grid.snapshot");
+	SpatialGridView mapped = snapshot.view();
+	long long fromGrid = grid.nearest(401, 299);
+	long long fromSnapshot = mapped.nearest(401, 299);
+	cout << "Снимок сетки: точек=" << mapped.size() << " проверка=" << snapshot.verify()
+		<< " ближайшая " << mapped.point(fromSnapshot).pointToString() << " совпадает=" << (fromGrid == fromSnapshot) << endl;
+#endif
+}
 
-	string pointToString()const
+void vectorNDemo()
+{
+	Vector3d i(1, 0, 0);
+	Vector3d j(0, 1, 0);
+	Vector4f a(1.0f, 2.0f, 3.0f, 4.0f);
+	Vector4f b(0.5f, 0.5f, 0.5f, 0.5f);
+	cout << "Векторное произведение в 3D: " << i.cross(j).toString() << endl;
+	cout << "4D: сумма " << (a + b).toString() << ", скалярное произведение " << a.dot(b) << ", длина " << a.norm() << endl;
+}
+
+void canvasDemo()
+{
+	TerminalCanvas canvas(40, 12);
+	vector<Point2d> square = {
+		Point2d(100, 100, screenWidth, screenHeight), Point2d(700, 100, screenWidth, screenHeight),
+		Point2d(700, 500, screenWidth, screenHeight), Point2d(100, 500, screenWidth, screenHeight) };
+	Point2d center(400, 300, screenWidth, screenHeight);
+
+	for (int frame = 0; frame < 2; frame++)
 	{
-		return "point(x=" + to_string(x) + ", y=" + to_string(y) + ")";
+		canvas.clear();
+		canvas.polyline(square, Color::BrightBlue, true);
+		for (int i = 0; i < 8; i++)
+		{
+			double angle = i * 3.14159265 / 4 + frame * 0.1;
+			Point2d tip(400 + static_cast<int>(180 * cos(angle)), 300 + static_cast<int>(180 * sin(angle)), screenWidth, screenHeight);
+			canvas.arrow(center, Vector2d(tip, center), Color::BrightGreen);
+		}
+		if (frame == 0)
+		{
+			cout << canvas.toString();
+		}
+		else
+		{
+			cout << "Клеток к перерисовке после поворота: " << canvas.changedCells() << " из " << canvas.getColumns() * canvas.getRows() << endl;
+		}
+		// в живом режиме здесь был бы canvas.present(), который выводит только изменения
+		canvas.markPresented();
 	}
-};
+}
 
+void scatterDemo()
+{
+	// облако вокруг центра: сумма трех равномерных величин дает колокол
+	auto cloud = [](unsigned seed, size_t n)
+	{
+		vector<Point2d> points;
+		points.reserve(n);
+		unsigned state = seed;
+		auto next = [&state](int range)
+		{
+			state = state * 1664525u + 1013904223u;
+			return static_cast<int>((state >> 8) % range);
+		};
+		for (size_t i = 0; i < n; i++)
+		{
+			int x = (next(screenWidth) + next(screenWidth) + next(screenWidth)) / 3;
+			int y = (next(screenHeight) + next(screenHeight) + next(screenHeight)) / 3;
+			points.push_back(Point2d(x, y, screenWidth, screenHeight));
+		}
+		return points;
+	};
+
+	ScatterPlot plot(40, 12);
+	plot.add(cloud(1, 1000000));
+	cout << plot.toString();
+	plot.markPresented();
+
+	plot.add(cloud(2, 5000));
+	cout << "Точек: " << plot.size() << ", клеток к перерисовке после добавления 5000: " << plot.changedCells() << endl;
+}
 
-class Vector2d
+void versionedStoreDemo()
 {
-private:
-	Point2d head;
-	Point2d end;
-	int x;
-	int y;
+	VersionedGeometryStore store;
+	{
+		auto writer = store.write();
+		for (int i = 0; i < 20000; i++)
+		{
+			Point2d p(i % screenWidth, i % screenHeight, screenWidth, screenHeight);
+			writer.points.push(p);
+			writer.vectors.push(Vector2d(p, Point2d()));
+		}
+		writer.commit();
+	}
 
-public:
-	Vector2d() : x(0), y(0) {};
+	// писатель меняет точку и ее вектор вместе; читатель не должен увидеть одно без другого
+	atomic<bool> running(true);
+	atomic<long long> checked(0), mismatched(0);
+	vector<thread> readers;
+	for (int r = 0; r < 3; r++)
+	{
+		readers.emplace_back([&store, &running, &checked, &mismatched, r]()
+		{
+			unsigned state = 17u + r;
+			while (running.load())
+			{
+				auto snapshot = store.snapshot();
+				for (int k = 0; k < 256; k++)
+				{
+					state = state * 1664525u + 1013904223u;
+					size_t i = (state >> 8) % snapshot.points().size();
+					const Point2d& p = snapshot.points()[i];
+					const Vector2d& v = snapshot.vectors()[i];
+					mismatched += p.getX() != v.getCoordX() || p.getY() != v.getCoordY();
+				}
+				checked += 256;
+			}
+		});
+	}
 
-	Vector2d(Point2d headPoint, Point2d endPoint)
+	unsigned state = 99;
+	size_t copied = 0;
+	for (int version = 0; version < 500; version++)
 	{
-		x = headPoint.getX() - endPoint.getX();
-		y = headPoint.getY() - endPoint.getY();
+		auto before = store.snapshot();
+		auto writer = store.write();
+		for (int k = 0; k < 16; k++)
+		{
+			state = state * 1664525u + 1013904223u;
+			size_t i = (state >> 8) % writer.points.size();
+			Point2d p((state >> 4) % screenWidth, (state >> 12) % screenHeight, screenWidth, screenHeight);
+			writer.points.set(i, p);
+			writer.vectors.set(i, Vector2d(p, Point2d()));
+		}
+		writer.commit();
+		auto after = store.snapshot();
+		for (size_t c = 0; c < after.points().chunkCount(); c++)
+		{
+			copied += !after.points().sharesChunk(before.points(), c);
+		}
+	}
+	running.store(false);
+	for (thread& t : readers)
+	{
+		t.join();
 	}
 
-	Vector2d(int x, int y)
+	cout << "Версионное хранилище: версия=" << store.version() << " проверок=" << checked.load()
+		<< " несогласованных=" << mismatched.load() << " скопировано кусков за версию=" << copied / 500.0
+		<< " ждут освобождения=" << store.pendingVersions() << endl;
+}
+
+void dynamicHullDemo()
+{
+	// облако точек, в котором за кадр меняются несколько точек
+	DynamicHull dynamic;
+	vector<Point2d> points;
+	unsigned state = 7;
+	auto next = [&state](unsigned range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return static_cast<int>((state >> 8) % range);
+	};
+	for (int i = 0; i < 20000; i++)
 	{
+		Point2d p(next(screenWidth), next(screenHeight), screenWidth, screenHeight);
+		points.push_back(p);
+		dynamic.insert(p);
+	}
 
-		if (x <= 0 || y <= 0 || x >= screenWidth || y >= screenHeight)
+	int mismatched = 0;
+	size_t hullSize = 0;
+	double dynamicTime = 0, rebuildTime = 0;
+	for (int frame = 0; frame < 200; frame++)
+	{
+		auto start = chrono::steady_clock::now();
+		for (int k = 0; k < 4; k++)
 		{
-			throw invalid_argument("Координаты должны быть внутри окна (начало координат левый нижний угол)");
+			size_t i = next(static_cast<unsigned>(points.size()));
+			dynamic.erase(points[i]);
+			points[i] = Point2d(next(screenWidth), next(screenHeight), screenWidth, screenHeight);
+			dynamic.insert(points[i]);
 		}
-		
-		this->x = x;
-		this->y = y;
-		
+		Point2d top = dynamic.extreme(Vector2d(Point2d(0, 1, screenWidth, screenHeight), Point2d()));
+		auto middle = chrono::steady_clock::now();
+		vector<Point2d> rebuilt = convexHull(points);
+		auto end = chrono::steady_clock::now();
+		dynamicTime += chrono::duration<double, micro>(middle - start).count();
+		rebuildTime += chrono::duration<double, micro>(end - middle).count();
+
+		vector<Point2d> hull = dynamic.hull();
+		mismatched += hull.size() != rebuilt.size() || !equal(hull.begin(), hull.end(), rebuilt.begin(),
+			[](const Point2d& a, const Point2d& b) { return a.getX() == b.getX() && a.getY() == b.getY(); });
+		mismatched += top.getY() != max_element(points.begin(), points.end(),
+			[](const Point2d& a, const Point2d& b) { return a.getY() < b.getY(); })->getY();
+		hullSize = hull.size();
 	}
 
-	void setCoordX(int coordX) { x = coordX; }
-	void setCoordY(int coordY) { y = coordY; }
-	
-	int getCoordX() { return x; }
-	int getCoordY() { return y; }
+	// вырожденный случай: точки на одной прямой дают отрезок из двух концов
+	vector<Point2d> line = { Point2d(10, 10, screenWidth, screenHeight), Point2d(20, 30, screenWidth, screenHeight), Point2d(30, 50, screenWidth, screenHeight) };
+	DynamicHull collinear;
+	for (const Point2d& p : line)
+	{
+		collinear.insert(p);
+	}
+	vector<Point2d> segment = collinear.hull(), expected = convexHull(line);
+	mismatched += segment.size() != expected.size() || !equal(segment.begin(), segment.end(), expected.begin(),
+		[](const Point2d& a, const Point2d& b) { return a.getX() == b.getX() && a.getY() == b.getY(); });
 
-	double lenght() const 
+	// из одной точки обе касательные идут в нее саму
+	DynamicHull single;
+	single.insert(Point2d(40, 40, screenWidth, screenHeight));
+	Point2d toCcw, toCw;
+	mismatched += !single.tangents(Point2d(5, 70, screenWidth, screenHeight), toCcw, toCw)
+		|| toCcw.getX() != 40 || toCcw.getY() != 40 || toCw.getX() != 40 || toCw.getY() != 40;
+
+	// касательные из точки за пределами облака
+	DynamicHull small;
+	small.insert(Point2d(300, 200, screenWidth, screenHeight));
+	small.insert(Point2d(400, 150, screenWidth, screenHeight));
+	small.insert(Point2d(450, 300, screenWidth, screenHeight));
+	small.insert(Point2d(350, 350, screenWidth, screenHeight));
+	Point2d ccw, cw;
+	if (small.tangents(Point2d(100, 250, screenWidth, screenHeight), ccw, cw))
 	{
-		return sqrt(pow(2, x) + pow(2, y));
+		cout << "Касательные из (100, 250): " << ccw.pointToString() << " и " << cw.pointToString() << endl;
 	}
-	
-	int dotProduct(Vector2d& other) const
+
+	cout << "Динамическая оболочка: вершин=" << hullSize << " расхождений=" << mismatched
+		<< " мкс за кадр: обновление=" << dynamicTime / 200 << " пересчет=" << rebuildTime / 200 << endl;
+}
+
+void polygonFillDemo()
+{
+	// звезда с самопересечениями: по правилу четности центр пустой, по ненулевому - закрашен
+	const double pi = acos(-1.0);
+	vector<Point2d> star;
+	for (int i = 0; i < 5; i++)
 	{
-		return x * other.x + y * other.y;
+		double angle = pi / 2 + i * 4 * pi / 5;
+		star.push_back(Point2d(static_cast<int>(std::lround(30 + 28 * cos(angle))), static_cast<int>(std::lround(12 + 11 * sin(angle))), 61, 24));
 	}
+	CoverageImage evenOdd(61, 24), nonZero(61, 24);
+	fillPolygon(evenOdd, FilledPolygon{ { star }, FillRule::EvenOdd }, 4);
+	fillPolygon(nonZero, FilledPolygon{ { star }, FillRule::NonZero }, 4);
+	cout << "Четность:\n" << evenOdd.toString() << "Ненулевое:\n" << nonZero.toString();
 
-	int crossProduct(Vector2d& other) const
+	// много случайных треугольников на весь экран: последовательно и по плиткам
+	vector<FilledPolygon> polygons;
+	unsigned state = 5;
+	auto next = [&state](unsigned range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return static_cast<int>((state >> 8) % range);
+	};
+	for (int i = 0; i < 5000; i++)
 	{
-		return x * other.y - other.x * y;
+		int x = next(screenWidth - 60), y = next(screenHeight - 60);
+		FilledPolygon triangle;
+		triangle.contours = { { Point2d(x + next(60), y + next(60), screenWidth, screenHeight),
+			Point2d(x + next(60), y + next(60), screenWidth, screenHeight), Point2d(x + next(60), y + next(60), screenWidth, screenHeight) } };
+		triangle.ink = static_cast<uint8_t>(next(256));
+		polygons.push_back(triangle);
+	}
+	for (int samples : { 1, 4 })
+	{
+		CoverageImage serial, tiled;
+		auto start = chrono::steady_clock::now();
+		for (const FilledPolygon& polygon : polygons)
+		{
+			fillPolygon(serial, polygon, samples);
+		}
+		auto middle = chrono::steady_clock::now();
+		fillPolygons(tiled, polygons, samples);
+		auto end = chrono::steady_clock::now();
+
+		int differ = 0;
+		for (int y = 0; y < screenHeight; y++)
+		{
+			for (int x = 0; x < screenWidth; x++)
+			{
+				differ += abs(serial.get(x, y) - tiled.get(x, y)) > 1;
+			}
+		}
+		cout << "Заливка " << polygons.size() << " треугольников, подстрок=" << samples << ": последовательно="
+			<< chrono::duration<double, milli>(middle - start).count() << " мс, по плиткам="
+			<< chrono::duration<double, milli>(end - middle).count() << " мс, расхождений=" << differ << endl;
 	}
+}
 
-	int mixedProduct(Vector2d& firVec, Vector2d& secVec, Vector2d& thirVec) const
+void trajectoryDemo()
+{
+	// 1000 объектов, кадр раз в 16 мс с небольшим дрожанием, точки блуждают по экрану
+	TrajectoryStore store;
+	unsigned state = 11;
+	auto next = [&state](unsigned range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return static_cast<int>((state >> 8) % range);
+	};
+	const int objects = 1000, frames = 1000;
+	vector<int> xs(objects), ys(objects);
+	for (int o = 0; o < objects; o++)
+	{
+		xs[o] = next(screenWidth);
+		ys[o] = next(screenHeight);
+	}
+	auto start = chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; frame++)
 	{
-		//voprosiki
-		return 0;
+		const int64_t time = 1700000000000LL + frame * 16LL;
+		for (int o = 0; o < objects; o++)
+		{
+			xs[o] = clamp(xs[o] + next(5) - 2, 0, screenWidth - 1);
+			ys[o] = clamp(ys[o] + next(5) - 2, 0, screenHeight - 1);
+			store.append(o, time + next(3), Point2d(xs[o], ys[o], screenWidth, screenHeight));
+		}
 	}
+	auto appended = chrono::steady_clock::now();
+	vector<TrajectoryHit> hits = store.inBox(350, 250, 450, 350, 1700000004000LL, 1700000008000LL);
+	auto queried = chrono::steady_clock::now();
+	vector<Point2d> path = store.resample(7, 1700000000000LL, 1000, 16);
 
-	Vector2d operator+(const Vector2d& other) const
+	const size_t raw = static_cast<size_t>(objects) * frames * (sizeof(int64_t) + sizeof(Point2d));
+	cout << "Траектории: отсчетов=" << static_cast<size_t>(objects) * frames << " байт=" << store.memoryBytes()
+		<< " (без сжатия " << raw << ") добавление=" << chrono::duration<double, milli>(appended - start).count()
+		<< " мс, в прямоугольнике " << hits.size() << " отсчетов за " << chrono::duration<double, milli>(queried - appended).count() << " мс" << endl;
+	cout << "Объект 7 раз в секунду:";
+	for (const Point2d& p : path)
 	{
-		return Vector2d(x + other.x, y + other.y);
+		cout << " (" << p.getX() << ", " << p.getY() << ")";
 	}
+	cout << endl;
+}
 
-	Vector2d operator-(const Vector2d& other) const
+void visibilityDemo()
+{
+	// короткие непересекающиеся отрезки по всему окну
+	vector<Obstacle> obstacles;
+	unsigned state = 3;
+	auto next = [&state](unsigned range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return static_cast<int>((state >> 8) % range);
+	};
+	auto crosses = [](const Obstacle& a, const Obstacle& b)
 	{
-		return Vector2d(x - other.x, y - other.y);
+		long long d1 = orientation(b.from, b.to, a.from), d2 = orientation(b.from, b.to, a.to);
+		long long d3 = orientation(a.from, a.to, b.from), d4 = orientation(a.from, a.to, b.to);
+		return ((d1 >= 0 && d2 <= 0) || (d1 <= 0 && d2 >= 0)) && ((d3 >= 0 && d4 <= 0) || (d3 <= 0 && d4 >= 0));
+	};
+	while (obstacles.size() < 2000)
+	{
+		Point2d a(10 + next(screenWidth - 20), 10 + next(screenHeight - 20), screenWidth, screenHeight);
+		Point2d b(a.getX() + next(19) - 9, a.getY() + next(19) - 9, screenWidth, screenHeight);
+		Obstacle candidate{ a, b };
+		if (!any_of(obstacles.begin(), obstacles.end(), [&](const Obstacle& o) { return crosses(candidate, o); }))
+		{
+			obstacles.push_back(candidate);
+		}
 	}
+	VisibilityScene scene(obstacles);
 
-	string vectorToString() const
+	vector<Point2d> viewpoints;
+	for (int i = 0; i < 400; i++)
 	{
-		return "vector(x= "+ to_string(x) + ", y= " + to_string(y) + ")";
+		viewpoints.push_back(Point2d(1 + next(screenWidth - 2), 1 + next(screenHeight - 2), screenWidth, screenHeight));
 	}
-	
-	Vector2d operator*(int k) const
+	auto start = chrono::steady_clock::now();
+	size_t single = 0;
+	for (const Point2d& p : viewpoints)
+	{
+		single += scene.visibility(p).size();
+	}
+	auto middle = chrono::steady_clock::now();
+	vector<vector<VisiblePoint>> polygons = scene.visibilityBatch(viewpoints);
+	auto end = chrono::steady_clock::now();
+	size_t batched = 0;
+	for (const auto& polygon : polygons)
+	{
+		batched += polygon.size();
+	}
+	cout << "Видимость среди " << obstacles.size() << " отрезков, " << viewpoints.size() << " точек: по одной="
+		<< chrono::duration<double, milli>(middle - start).count() << " мс, пакетом=" << chrono::duration<double, milli>(end - middle).count()
+		<< " мс, вершин " << single << " / " << batched << endl;
+}
+
+void polygonOffsetDemo()
+{
+	// звезда с дырой: раздувание и сжатие с разными стыками
+	vector<Point2d> star;
+	for (int i = 0; i < 10; i++)
+	{
+		double angle = i * 3.14159265358979 / 5;
+		int radius = i % 2 == 0 ? 60 : 25;
+		star.push_back(Point2d(200 + static_cast<int>(lround(radius * cos(angle))), 150 + static_cast<int>(lround(radius * sin(angle))), screenWidth, screenHeight));
+	}
+	vector<Point2d> hole = { Point2d(195, 145, screenWidth, screenHeight), Point2d(195, 155, screenWidth, screenHeight),
+		Point2d(205, 155, screenWidth, screenHeight), Point2d(205, 145, screenWidth, screenHeight) };
+	vector<vector<Point2d>> shape = { star, hole };
+	const char* names[] = { "острый", "скругленный", "срезанный" };
+	const JoinType joins[] = { JoinType::Miter, JoinType::Round, JoinType::Square };
+	for (int j = 0; j < 3; j++)
+	{
+		for (double delta : { 8.0, -4.0 })
+		{
+			vector<vector<Point2d>> result = offsetPolygon(shape, delta, joins[j]);
+			size_t vertices = 0;
+			for (const auto& contour : result)
+			{
+				vertices += contour.size();
+			}
+			cout << "Смещение на " << delta << ", стык " << names[j] << ": контуров " << result.size() << ", вершин " << vertices << endl;
+		}
+	}
+
+	// пакет случайных многоугольников
+	unsigned state = 5;
+	auto next = [&state](unsigned range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return static_cast<int>((state >> 8) % range);
+	};
+	vector<vector<vector<Point2d>>> polygons;
+	for (int i = 0; i < 500; i++)
+	{
+		int cx = 40 + next(screenWidth - 80), cy = 40 + next(screenHeight - 80);
+		vector<double> angles;
+		for (int k = 3 + next(10); k > 0; k--)
+		{
+			angles.push_back(next(6283) / 1000.0);
+		}
+		sort(angles.begin(), angles.end());
+		vector<Point2d> contour;
+		for (double angle : angles)
+		{
+			int radius = 5 + next(30);
+			contour.push_back(Point2d(cx + static_cast<int>(lround(radius * cos(angle))), cy + static_cast<int>(lround(radius * sin(angle))), screenWidth, screenHeight));
+		}
+		polygons.push_back({ contour });
+	}
+	auto start = chrono::steady_clock::now();
+	size_t single = 0;
+	for (const auto& polygon : polygons)
+	{
+		single += offsetPolygon(polygon, 6, JoinType::Round).size();
+	}
+	auto middle = chrono::steady_clock::now();
+	vector<vector<vector<Point2d>>> batch = offsetPolygons(polygons, 6, JoinType::Round);
+	auto end = chrono::steady_clock::now();
+	size_t batched = 0;
+	for (const auto& result : batch)
+	{
+		batched += result.size();
+	}
+	cout << "Смещение " << polygons.size() << " многоугольников: по одному=" << chrono::duration<double, milli>(middle - start).count()
+		<< " мс, пакетом=" << chrono::duration<double, milli>(end - middle).count() << " мс, контуров " << single << " / " << batched << endl;
+}
+
+void polylineMatchDemo()
+{
+	// библиотека жестов - случайные блуждания, запросы - зашумленные копии шаблонов
+	unsigned state = 11;
+	auto next = [&state](unsigned range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return static_cast<int>((state >> 8) % range);
+	};
+	vector<vector<Point2d>> templates;
+	for (int i = 0; i < 4000; i++)
 	{
-		return Vector2d(x * k, y * k);
+		int x = 50 + next(screenWidth - 100), y = 50 + next(screenHeight - 100);
+		vector<Point2d> gesture;
+		for (int k = 16 + next(32); k > 0; k--)
+		{
+			x = clamp(x + next(17) - 8, 0, screenWidth - 1);
+			y = clamp(y + next(17) - 8, 0, screenHeight - 1);
+			gesture.push_back(Point2d(x, y, screenWidth, screenHeight));
+		}
+		templates.push_back(gesture);
+	}
+	PolylineIndex index(templates);
+
+	vector<vector<Point2d>> queries;
+	for (int i = 0; i < 50; i++)
+	{
+		vector<Point2d> query;
+		for (const Point2d& p : templates[next(static_cast<unsigned>(templates.size()))])
+		{
+			query.push_back(Point2d(clamp(p.getX() + next(7) - 3, 0, screenWidth - 1), clamp(p.getY() + next(7) - 3, 0, screenHeight - 1), screenWidth, screenHeight));
+		}
+		queries.push_back(query);
+	}
+
+	const char* names[] = { "Фреше", "Хаусдорф" };
+	const PolylineMetric metrics[] = { PolylineMetric::Frechet, PolylineMetric::Hausdorff };
+	for (int m = 0; m < 2; m++)
+	{
+		auto start = chrono::steady_clock::now();
+		double exhaustive = 0;
+		for (const auto& query : queries)
+		{
+			exhaustive += index.nearestExhaustive(query, 5, metrics[m]).back().distance;
+		}
+		auto middle = chrono::steady_clock::now();
+		double indexed = 0;
+		size_t evaluated = 0, abandoned = 0;
+		for (const auto& query : queries)
+		{
+			PolylineSearchStats stats;
+			indexed += index.nearest(query, 5, metrics[m], numeric_limits<double>::infinity(), &stats).back().distance;
+			evaluated += stats.evaluated;
+			abandoned += stats.abandoned;
+		}
+		auto end = chrono::steady_clock::now();
+		cout << "Поиск 5 ближайших (" << names[m] << ") среди " << index.size() << " шаблонов, " << queries.size() << " запросов: перебор="
+			<< chrono::duration<double, milli>(middle - start).count() << " мс, индекс=" << chrono::duration<double, milli>(end - middle).count()
+			<< " мс, досчитано " << evaluated << " (брошено " << abandoned << "), сумма 5-х расстояний " << exhaustive << " / " << indexed << endl;
+	}
+}
+
+void gridRayDemo()
+{
+	// редкие препятствия на экране и лучи из случайных точек
+	unsigned state = 13;
+	auto next = [&state](unsigned range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return static_cast<int>((state >> 8) % range);
+	};
+	OccupancyGrid grid(screenWidth, screenHeight);
+	for (int i = 0; i < 60; i++)
+	{
+		int x = next(screenWidth), y = next(screenHeight);
+		grid.fillRect(x, y, x + 2 + next(20), y + 2 + next(20));
+	}
+	vector<GridRay> rays;
+	for (int i = 0; i < 100000; i++)
+	{
+		rays.push_back(GridRay::between(next(screenWidth) + 0.5, next(screenHeight) + 0.5, next(screenWidth) + 0.5, next(screenHeight) + 0.5));
+	}
+
+	auto start = chrono::steady_clock::now();
+	vector<GridHit> flat = grid.traceBatch(rays, false, 1);
+	auto middle = chrono::steady_clock::now();
+	vector<GridHit> single = grid.traceBatch(rays, true, 1);
+	auto threaded = chrono::steady_clock::now();
+	vector<GridHit> batch = grid.traceBatch(rays);
+	auto end = chrono::steady_clock::now();
+	size_t blocked = 0, same = 0;
+	for (size_t i = 0; i < rays.size(); i++)
+	{
+		blocked += batch[i].hit;
+		same += flat[i].hit == batch[i].hit && flat[i].x == batch[i].x && flat[i].y == batch[i].y && single[i].x == batch[i].x;
 	}
-};
+	cout << "Лучи по сетке: " << rays.size() << " лучей, перекрыто " << blocked << ", совпало " << same << "; по клеткам="
+		<< chrono::duration<double, milli>(middle - start).count() << " мс, с пропуском пустых блоков=" << chrono::duration<double, milli>(threaded - middle).count()
+		<< " мс, в потоках=" << chrono::duration<double, milli>(end - threaded).count() << " мс" << endl;
+}
+
+void pointPyramidDemo()
+{
+	// миллион точек, сгущающихся к нескольким центрам
+	unsigned state = 17;
+	auto next = [&state](unsigned range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return static_cast<int>((state >> 8) % range);
+	};
+	vector<Point2d> points;
+	for (int i = 0; i < 1000000; i++)
+	{
+		int cx = 100 + (i % 5) * 150, cy = 150 + (i % 3) * 150;
+		int r = next(60) * next(60) / 60;
+		points.push_back(Point2d(clamp(cx + next(2 * r + 1) - r, 0, screenWidth - 1), clamp(cy + next(2 * r + 1) - r, 0, screenHeight - 1), screenWidth, screenHeight));
+	}
+
+	auto start = chrono::steady_clock::now();
+	PointPyramid single(points, screenWidth, screenHeight, 1);
+	auto middle = chrono::steady_clock::now();
+	PointPyramid pyramid(points);
+	auto end = chrono::steady_clock::now();
+	cout << "Пирамида из " << pyramid.size() << " точек, уровней " << pyramid.levelCount() << ": один поток="
+		<< chrono::duration<double, milli>(middle - start).count() << " мс, все потоки=" << chrono::duration<double, milli>(end - middle).count() << " мс" << endl;
+
+	// приближение к центру: список клеток уточняется с прошлого вида, а не строится заново
+	vector<PyramidCell> cells;
+	for (double zoom = 1; zoom <= 16; zoom *= 2)
+	{
+		// экран 80x24 показывает часть окна вокруг (250, 300)
+		const double worldPerPixel = 20 / zoom;
+		PyramidView view{ 250 - 40 * worldPerPixel, 300 - 12 * worldPerPixel, 250 + 40 * worldPerPixel, 300 + 12 * worldPerPixel, worldPerPixel };
+		if (cells.empty())
+		{
+			cells = pyramid.coarsest(view);
+		}
+		int steps = 0;
+		while (pyramid.refine(cells, view, 0.5))
+		{
+			steps++;
+		}
+		size_t covered = 0;
+		for (const PyramidCell& c : cells)
+		{
+			covered += c.count;
+		}
+		cout << "Приближение x" << zoom << ": уровень " << pyramid.levelFor(worldPerPixel, 0.5) << ", шагов уточнения " << steps
+			<< ", клеток " << cells.size() << " вместо " << covered << " точек" << endl;
+	}
+}
 
 int main()
 {
 	setlocale(LC_ALL, "Russian");
+	// TRACE_FILE=trace.json - записать этапы для chrome://tracing
+	TraceSession trace(getenv("TRACE_FILE"));
 
 	try{
 		Point2d point(300, 200, screenWidth, screenHeight);
@@ -157,4 +798,20 @@ int main()
 	cout << "Вектор суммы: " << summ.vectorToString() << endl;
 	cout << "Вектор разности: " << remainder.vectorToString() << endl;
 
+	houghDemo();
+	icpDemo();
+	shmTransportDemo();
+	snapshotDemo();
+	vectorNDemo();
+	canvasDemo();
+	scatterDemo();
+	versionedStoreDemo();
+	dynamicHullDemo();
+	polygonFillDemo();
+	trajectoryDemo();
+	visibilityDemo();
+	polygonOffsetDemo();
+	polylineMatchDemo();
+	gridRayDemo();
+	pointPyramidDemo();
 }
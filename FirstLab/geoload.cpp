@@ -0,0 +1,177 @@
+﻿#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <atomic>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "geometry.h"
+#include "query_protocol.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+// Нагрузочный клиент: connections соединений, в каждом окно из depth запросов без ожидания ответа
+static int connectTo(const string& path)
+{
+	int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+	if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+	{
+		throw runtime_error("Не удалось подключиться к " + path + ": " + strerror(errno));
+	}
+	return fd;
+}
+
+static void readExactly(int fd, void* data, size_t size)
+{
+	char* out = static_cast<char*>(data);
+	while (size > 0)
+	{
+		ssize_t got = read(fd, out, size);
+		if (got <= 0)
+		{
+			throw runtime_error("Сервер закрыл соединение");
+		}
+		out += got;
+		size -= got;
+	}
+}
+
+static void writeAll(int fd, const void* data, size_t size)
+{
+	const char* in = static_cast<const char*>(data);
+	while (size > 0)
+	{
+		ssize_t written = write(fd, in, size);
+		if (written <= 0)
+		{
+			throw runtime_error("Ошибка записи в сокет");
+		}
+		in += written;
+		size -= written;
+	}
+}
+
+static void client(const string& path, int requests, int depth, uint32_t seed, vector<double>& latencies)
+{
+	int fd = connectTo(path);
+	vector<QueryRequest> window(depth);
+	vector<Clock::time_point> sentAt(depth);
+	vector<int32_t> payload;
+
+	for (int done = 0; done < requests; done += depth)
+	{
+		int count = min(depth, requests - done);
+		for (int i = 0; i < count; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			QueryRequest& request = window[i];
+			memset(&request, 0, sizeof(request));
+			request.id = static_cast<uint32_t>(done + i);
+			int x = static_cast<int>((seed >> 8) % screenWidth);
+			int y = static_cast<int>((seed >> 16) % screenHeight);
+			// в основном ближайшие точки, немного прямоугольников и оболочек
+			if (seed % 100 < 90)
+			{
+				request.op = QueryOp::Nearest;
+				request.args[0] = x;
+				request.args[1] = y;
+			}
+			else if (seed % 100 < 99)
+			{
+				request.op = QueryOp::Range;
+				request.args[0] = x;
+				request.args[1] = y;
+				request.args[2] = x + 8;
+				request.args[3] = y + 8;
+			}
+			else
+			{
+				request.op = QueryOp::Hull;
+			}
+		}
+
+		Clock::time_point now = Clock::now();
+		fill(sentAt.begin(), sentAt.begin() + count, now);
+		writeAll(fd, window.data(), sizeof(QueryRequest) * count);
+
+		for (int i = 0; i < count; i++)
+		{
+			QueryResponseHeader header;
+			readExactly(fd, &header, sizeof(header));
+			payload.resize(header.count * 2);
+			readExactly(fd, payload.data(), payload.size() * sizeof(int32_t));
+			if (header.id != static_cast<uint32_t>(done + i))
+			{
+				throw runtime_error("Ответы пришли не по порядку");
+			}
+			latencies.push_back(chrono::duration<double, micro>(Clock::now() - sentAt[i]).count());
+		}
+	}
+	close(fd);
+}
+
+int main(int argc, char** argv)
+{
+	string path = argc > 1 ? argv[1] : "/tmp/geometry.sock";
+	int connections = argc > 2 ? stoi(argv[2]) : 8;
+	int requests = argc > 3 ? stoi(argv[3]) : 100000;
+	int depth = argc > 4 ? stoi(argv[4]) : 32;
+	if (connections < 1 || requests < 0 || depth < 1)
+	{
+		cerr << "Использование: geoload [сокет] [соединений >= 1] [запросов >= 0] [глубина >= 1]" << endl;
+		return 2;
+	}
+
+	vector<vector<double>> latencies(connections);
+	vector<thread> threads;
+	std::atomic<bool> failed{ false };
+
+	Clock::time_point start = Clock::now();
+	for (int c = 0; c < connections; c++)
+	{
+		threads.emplace_back([&, c]()
+		{
+			try {
+				client(path, requests, depth, 7919u * (c + 1), latencies[c]);
+			}
+			catch (const exception& e) {
+				cerr << e.what() << endl;
+				failed = true;
+			}
+		});
+	}
+	for (thread& t : threads)
+	{
+		t.join();
+	}
+	double seconds = chrono::duration<double>(Clock::now() - start).count();
+
+	vector<double> all;
+	for (const vector<double>& part : latencies)
+	{
+		all.insert(all.end(), part.begin(), part.end());
+	}
+	if (all.empty())
+	{
+		return 1;
+	}
+	sort(all.begin(), all.end());
+
+	auto percentile = [&all](double p) { return all[min(all.size() - 1, static_cast<size_t>(p * all.size()))]; };
+	cout << "Запросов: " << all.size() << ", пропускная способность: " << all.size() / seconds << " запросов/с" << endl;
+	cout << "Задержка, мкс: p50=" << percentile(0.50) << " p90=" << percentile(0.90) << " p99=" << percentile(0.99)
+		<< " p99.9=" << percentile(0.999) << " max=" << all.back() << endl;
+	return failed ? 1 : 0;
+}
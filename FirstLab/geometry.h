@@ -0,0 +1,42 @@
+﻿#pragma once
+
+#include <string>
+#include <stdexcept>
+#include <cmath>
+
+const int screenWidth = 800;
+const int screenHeight = 600;
+
+class Point2d
+{
+private:
+	int x;
+	int y;
+
+public:
+	Point2d() : x(0), y(0) {}
+
+	Point2d(int x, int y, int screenWidth, int screenHeight)
+	{
+		if (x < 0 || y < 0 || x >= screenWidth || y >= screenHeight)
+		{
+			throw std::invalid_argument("Координаты должны быть внутри окна (начало координат левый нижний угол)");
+		}
+
+		this->x = x;
+		this->y = y;
+	}
+
+	int getX() const { return x; }
+
+	int getY() const { return y; }
+
+	std::string pointToString()const
+	{
+		return "point(x=" + std::to_string(x) + ", y=" + std::to_string(y) + ")";
+	}
+};
+
+
+// Vector2d - псевдоним VectorN<int, 2>
+#include "vector_n.h"
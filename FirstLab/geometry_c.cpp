@@ -0,0 +1,102 @@
+﻿#define GEOMETRY_C_BUILD
+#include "geometry_c.h"
+
+#include <climits>
+
+#include "batch.h"
+#include "parallel.h"
+
+static_assert(sizeof(int) == sizeof(int32_t) && sizeof(long long) == sizeof(int64_t), "C ABI relies on 32-bit int and 64-bit long long");
+
+namespace
+{
+	// Меньшие пакеты быстрее посчитать в вызывающем потоке, чем запускать рабочие
+	const size_t parallelThreshold = 1 << 16;
+
+	template <class Body>
+	void run(size_t n, Body body)
+	{
+		if (n < parallelThreshold)
+		{
+			body(0, n);
+			return;
+		}
+		parallelFor(n, [&body](unsigned, size_t begin, size_t end) { body(begin, end); });
+	}
+
+	const int* in(const int32_t* p) { return reinterpret_cast<const int*>(p); }
+	long long* out64(int64_t* p) { return reinterpret_cast<long long*>(p); }
+}
+
+extern "C" {
+
+int32_t geometry_api_version(void)
+{
+	return GEOMETRY_API_VERSION;
+}
+
+int32_t geometry_dot(const int32_t* ax, const int32_t* ay, const int32_t* bx, const int32_t* by, int64_t* out, size_t n)
+{
+	if (n && (!ax || !ay || !bx || !by || !out))
+	{
+		return GEOMETRY_ERROR_NULL_POINTER;
+	}
+	run(n, [=](size_t begin, size_t end)
+	{
+		batchDot(in(ax) + begin, in(ay) + begin, in(bx) + begin, in(by) + begin, out64(out) + begin, end - begin);
+	});
+	return GEOMETRY_OK;
+}
+
+int32_t geometry_cross(const int32_t* ax, const int32_t* ay, const int32_t* bx, const int32_t* by, int64_t* out, size_t n)
+{
+	if (n && (!ax || !ay || !bx || !by || !out))
+	{
+		return GEOMETRY_ERROR_NULL_POINTER;
+	}
+	run(n, [=](size_t begin, size_t end)
+	{
+		batchCross(in(ax) + begin, in(ay) + begin, in(bx) + begin, in(by) + begin, out64(out) + begin, end - begin);
+	});
+	return GEOMETRY_OK;
+}
+
+int32_t geometry_length(const int32_t* x, const int32_t* y, double* out, size_t n)
+{
+	if (n && (!x || !y || !out))
+	{
+		return GEOMETRY_ERROR_NULL_POINTER;
+	}
+	run(n, [=](size_t begin, size_t end)
+	{
+		batchLength(in(x) + begin, in(y) + begin, out + begin, end - begin);
+	});
+	return GEOMETRY_OK;
+}
+
+int32_t geometry_clip(const int32_t* x, const int32_t* y, size_t n, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+	int32_t* out_x, int32_t* out_y, size_t* kept)
+{
+	if (!kept || (n && (!x || !y || !out_x || !out_y)))
+	{
+		return GEOMETRY_ERROR_NULL_POINTER;
+	}
+	// сжатие последовательное: позиция каждой точки зависит от всех предыдущих
+	*kept = batchClip(in(x), in(y), n, x0, y0, x1, y1, reinterpret_cast<int*>(out_x), reinterpret_cast<int*>(out_y));
+	return GEOMETRY_OK;
+}
+
+int32_t geometry_transform(const int32_t* x, const int32_t* y, const double* m, double* out_x, double* out_y, size_t n)
+{
+	if (!m || (n && (!x || !y || !out_x || !out_y)))
+	{
+		return GEOMETRY_ERROR_NULL_POINTER;
+	}
+	run(n, [=](size_t begin, size_t end)
+	{
+		batchTransform(in(x) + begin, in(y) + begin, m, out_x + begin, out_y + begin, end - begin);
+	});
+	return GEOMETRY_OK;
+}
+
+}
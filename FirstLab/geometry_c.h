@@ -0,0 +1,52 @@
+﻿#pragma once
+
+/* Стабильный C ABI пакетных операций над точками и векторами.
+   Все массивы принадлежат вызывающему и передаются без копирования (SoA: отдельно x и y).
+   Функции возвращают GEOMETRY_OK или код ошибки. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(GEOMETRY_C_BUILD)
+#    define GEOMETRY_API __declspec(dllexport)
+#  else
+#    define GEOMETRY_API __declspec(dllimport)
+#  endif
+#else
+#  define GEOMETRY_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GEOMETRY_API_VERSION 1
+
+enum
+{
+	GEOMETRY_OK = 0,
+	GEOMETRY_ERROR_NULL_POINTER = -1
+};
+
+GEOMETRY_API int32_t geometry_api_version(void);
+
+/* out[i] = a[i] . b[i] */
+GEOMETRY_API int32_t geometry_dot(const int32_t* ax, const int32_t* ay, const int32_t* bx, const int32_t* by, int64_t* out, size_t n);
+
+/* out[i] = a[i] x b[i] (z-компонента) */
+GEOMETRY_API int32_t geometry_cross(const int32_t* ax, const int32_t* ay, const int32_t* bx, const int32_t* by, int64_t* out, size_t n);
+
+/* out[i] = |v[i]| */
+GEOMETRY_API int32_t geometry_length(const int32_t* x, const int32_t* y, double* out, size_t n);
+
+/* Копирует в out_x/out_y (размером не меньше n) точки внутри [x0, x1] x [y0, y1], их число пишет в kept */
+GEOMETRY_API int32_t geometry_clip(const int32_t* x, const int32_t* y, size_t n, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+	int32_t* out_x, int32_t* out_y, size_t* kept);
+
+/* Аффинное преобразование матрицей 2x3 по строкам: m = {a, b, tx, c, d, ty} */
+GEOMETRY_API int32_t geometry_transform(const int32_t* x, const int32_t* y, const double* m, double* out_x, double* out_y, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,101 @@
+﻿#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+
+#include "geometry.h"
+#include "convex_hull.h"
+#include "spatial_grid.h"
+#include "index_snapshot.h"
+#include "query_server.h"
+
+using namespace std;
+
+static GeometryQueryServer* runningServer = nullptr;
+
+static void onSignal(int)
+{
+	if (runningServer)
+	{
+		runningServer->stop();
+	}
+}
+
+static vector<Point2d> generatePoints(size_t count)
+{
+	vector<Point2d> points;
+	points.reserve(count);
+	uint32_t seed = 12345;
+	for (size_t i = 0; i < count; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		int x = static_cast<int>((seed >> 8) % screenWidth);
+		seed = seed * 1664525u + 1013904223u;
+		int y = static_cast<int>((seed >> 8) % screenHeight);
+		points.push_back(Point2d(x, y, screenWidth, screenHeight));
+	}
+	return points;
+}
+
+// geoserver [сокет] [число точек] [файл снимка]
+// Если снимок есть, он отображается в память вместо построения сетки; иначе сетка строится и сохраняется.
+int main(int argc, char** argv)
+{
+	string path = argc > 1 ? argv[1] : "/tmp/geometry.sock";
+	size_t count = argc > 2 ? stoul(argv[2]) : 1000000;
+	string snapshotPath = argc > 3 ? argv[3] : "";
+
+	try {
+		auto start = chrono::steady_clock::now();
+		SpatialGrid grid;
+		GridSnapshot snapshot;
+		SpatialGridView index;
+		vector<Point2d> hull;
+
+		if (!snapshotPath.empty())
+		{
+			try {
+				snapshot.open(snapshotPath);
+				index = snapshot.view();
+				hull = snapshot.hull();
+				cout << "Снимок " << snapshotPath << " отображен в память" << endl;
+			}
+			catch (const runtime_error& e) {
+				cerr << e.what() << endl;
+			}
+		}
+
+		if (!snapshot.isOpen())
+		{
+			vector<Point2d> points = generatePoints(count);
+			grid.build(points, SpatialGrid::suggestedCellSize(points.size()));
+			hull = convexHull(points);
+			index = grid.view();
+			if (!snapshotPath.empty())
+			{
+				saveGridSnapshot(grid, hull, snapshotPath);
+				cout << "Снимок сохранен в " << snapshotPath << endl;
+			}
+		}
+		cout << "Индекс готов за " << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " мс" << endl;
+
+		GeometryQueryServer server(path, index, hull);
+		runningServer = &server;
+		signal(SIGINT, onSignal);
+		signal(SIGTERM, onSignal);
+
+		cout << "Сервер слушает " << path << ", точек: " << index.size() << endl;
+		server.run();
+		runningServer = nullptr;
+
+		cout << "Запросов: " << server.getQueries() << ", пакетов ближайших: " << server.getBatches()
+			<< ", наибольший пакет: " << server.getLargestBatch() << endl;
+	}
+	catch (const exception& e) {
+		cerr << e.what() << endl;
+		return 1;
+	}
+	return 0;
+}
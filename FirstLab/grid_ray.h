@@ -0,0 +1,307 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "parallel.h"
+#include "trace.h"
+
+// Прохождение лучей по сетке занятости (Amanatides - Woo). Клетка (x, y) занимает [x, x + 1) x [y, y + 1).
+// Занятость хранится плитками 8x8 по одному слову на плитку, а плитки собраны в блоки 64x64
+// с маской непустых плиток: луч перескакивает пустой блок или пустую плитку за один шаг.
+
+// Луч из (x, y) в направлении (dx, dy) длиной не больше maxDistance клеток
+struct GridRay
+{
+	double x;
+	double y;
+	double dx;
+	double dy;
+	double maxDistance = std::numeric_limits<double>::infinity();
+
+	// Отрезок между двумя точками - для проверки видимости
+	static GridRay between(double x0, double y0, double x1, double y1)
+	{
+		return { x0, y0, x1 - x0, y1 - y0, std::hypot(x1 - x0, y1 - y0) };
+	}
+};
+
+// Первая занятая клетка на луче и расстояние от начала луча до входа в нее
+struct GridHit
+{
+	bool hit = false;
+	int x = -1;
+	int y = -1;
+	double distance = std::numeric_limits<double>::infinity();
+};
+
+class OccupancyGrid
+{
+private:
+	int width;
+	int height;
+	int tilesX;
+	int tilesY;
+	int blocksX;
+	std::vector<std::uint64_t> tiles;
+	std::vector<std::uint64_t> blocks;
+
+	static std::uint64_t cellBit(int x, int y) { return std::uint64_t{ 1 } << (((y & 7) << 3) | (x & 7)); }
+	static std::uint64_t tileBit(int x, int y) { return std::uint64_t{ 1 } << ((((y >> 3) & 7) << 3) | ((x >> 3) & 7)); }
+	std::size_t tileIndex(int x, int y) const { return static_cast<std::size_t>(y >> 3) * tilesX + (x >> 3); }
+	std::size_t blockIndex(int x, int y) const { return static_cast<std::size_t>(y >> 6) * blocksX + (x >> 6); }
+
+	struct Walk
+	{
+		double ox;
+		double oy;
+		double ux;
+		double uy;
+		double inverseX;
+		double inverseY;
+		int stepX;
+		int stepY;
+		int cx;
+		int cy;
+		double t;
+		double tMaxX;
+		double tMaxY;
+		double tDeltaX;
+		double tDeltaY;
+		double tExit;
+
+		// t выхода луча из столбца или строки; шаг по клеткам и перескок блоков сравнивают одни и те же значения
+		double boundaryX(int column) const { return stepX != 0 ? (column + (stepX > 0 ? 1 : 0) - ox) * inverseX : std::numeric_limits<double>::infinity(); }
+		double boundaryY(int row) const { return stepY != 0 ? (row + (stepY > 0 ? 1 : 0) - oy) * inverseY : std::numeric_limits<double>::infinity(); }
+	};
+
+	// Выход из квадрата size x size, где лежит клетка: выходящая ось делает точный переход через границу,
+	// вторая - столько шагов, сколько ее границ луч пересек до этого, но не дальше края квадрата.
+	// false, если луч кончился раньше
+	static bool leaveSquare(Walk& w, int size)
+	{
+		const int bx = w.cx & ~(size - 1);
+		const int by = w.cy & ~(size - 1);
+		const double tx = w.boundaryX(w.stepX > 0 ? bx + size - 1 : bx);
+		const double ty = w.boundaryY(w.stepY > 0 ? by + size - 1 : by);
+		const double tNext = std::min(tx, ty);
+		if (tNext > w.tExit)
+		{
+			return false;
+		}
+
+		// Вторая ось: число пересеченных границ оценивается делением и уточняется точным сравнением
+		// с теми же границами, что в обычном шаге. При равенстве, как и там, первой шагает y
+		auto advance = [tNext](int c, int step, int first, int last, double tMax, double tDelta, bool inclusive, auto boundary)
+		{
+			auto crossed = [&](int cell) { return inclusive ? boundary(cell) <= tNext : boundary(cell) < tNext; };
+			if (step == 0 || !(tMax <= tNext))
+			{
+				return c;
+			}
+			const int low = std::min(first, last), high = std::max(first, last);
+			c = std::clamp(c + step * static_cast<int>((tNext - tMax) / tDelta), low, high);
+			while (c != last && crossed(c))
+			{
+				c += step;
+			}
+			while (c != first && !crossed(c - step))
+			{
+				c -= step;
+			}
+			return c;
+		};
+		int cx = w.cx, cy = w.cy;
+		if (tx < ty)
+		{
+			cx = w.stepX > 0 ? bx + size : bx - 1;
+			cy = advance(w.cy, w.stepY, w.cy, w.stepY > 0 ? by + size - 1 : by, w.tMaxY, w.tDeltaY, true, [&w](int row) { return w.boundaryY(row); });
+		}
+		else
+		{
+			cy = w.stepY > 0 ? by + size : by - 1;
+			cx = advance(w.cx, w.stepX, w.cx, w.stepX > 0 ? bx + size - 1 : bx, w.tMaxX, w.tDeltaX, false, [&w](int column) { return w.boundaryX(column); });
+		}
+		w.cx = cx;
+		w.cy = cy;
+		w.t = tNext;
+		w.tMaxX = w.boundaryX(cx);
+		w.tMaxY = w.boundaryY(cy);
+		return true;
+	}
+
+public:
+	OccupancyGrid(int width, int height) : width(width), height(height)
+	{
+		if (width <= 0 || height <= 0)
+		{
+			throw std::invalid_argument("Размеры сетки должны быть положительными");
+		}
+		tilesX = (width + 7) / 8;
+		tilesY = (height + 7) / 8;
+		blocksX = (width + 63) / 64;
+		tiles.assign(static_cast<std::size_t>(tilesX) * tilesY, 0);
+		blocks.assign(static_cast<std::size_t>(blocksX) * ((height + 63) / 64), 0);
+	}
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	bool get(int x, int y) const
+	{
+		return x >= 0 && y >= 0 && x < width && y < height && (tiles[tileIndex(x, y)] & cellBit(x, y)) != 0;
+	}
+
+	void set(int x, int y, bool occupied = true)
+	{
+		if (x < 0 || y < 0 || x >= width || y >= height)
+		{
+			throw std::out_of_range("Клетка вне сетки");
+		}
+		std::uint64_t& tile = tiles[tileIndex(x, y)];
+		if (occupied)
+		{
+			tile |= cellBit(x, y);
+			blocks[blockIndex(x, y)] |= tileBit(x, y);
+		}
+		else
+		{
+			tile &= ~cellBit(x, y);
+			if (tile == 0)
+			{
+				blocks[blockIndex(x, y)] &= ~tileBit(x, y);
+			}
+		}
+	}
+
+	// Занимает прямоугольник [x0, x1] x [y0, y1] с отсечением по краям
+	void fillRect(int x0, int y0, int x1, int y1)
+	{
+		for (int y = std::max(y0, 0); y <= std::min(y1, height - 1); y++)
+		{
+			for (int x = std::max(x0, 0); x <= std::min(x1, width - 1); x++)
+			{
+				set(x, y);
+			}
+		}
+	}
+
+	// hierarchy = false - обычный шаг по клеткам, для сверки
+	GridHit trace(const GridRay& ray, bool hierarchy = true) const
+	{
+		GridHit miss;
+		const double length = std::hypot(ray.dx, ray.dy);
+		if (length == 0)
+		{
+			const int x = static_cast<int>(std::floor(ray.x)), y = static_cast<int>(std::floor(ray.y));
+			return get(x, y) && ray.maxDistance >= 0 ? GridHit{ true, x, y, 0 } : miss;
+		}
+
+		Walk w;
+		w.ox = ray.x;
+		w.oy = ray.y;
+		w.ux = ray.dx / length;
+		w.uy = ray.dy / length;
+
+		// отсечение по рамке сетки
+		double tEnter = 0;
+		w.tExit = ray.maxDistance;
+		const double origin[2] = { w.ox, w.oy };
+		const double direction[2] = { w.ux, w.uy };
+		const double extent[2] = { static_cast<double>(width), static_cast<double>(height) };
+		for (int axis = 0; axis < 2; axis++)
+		{
+			if (direction[axis] == 0)
+			{
+				if (origin[axis] < 0 || origin[axis] >= extent[axis])
+				{
+					return miss;
+				}
+				continue;
+			}
+			double t0 = -origin[axis] / direction[axis];
+			double t1 = (extent[axis] - origin[axis]) / direction[axis];
+			if (t0 > t1)
+			{
+				std::swap(t0, t1);
+			}
+			tEnter = std::max(tEnter, t0);
+			w.tExit = std::min(w.tExit, t1);
+		}
+		if (tEnter > w.tExit)
+		{
+			return miss;
+		}
+
+		w.stepX = w.ux > 0 ? 1 : (w.ux < 0 ? -1 : 0);
+		w.stepY = w.uy > 0 ? 1 : (w.uy < 0 ? -1 : 0);
+		w.inverseX = w.ux != 0 ? 1 / w.ux : 0;
+		w.inverseY = w.uy != 0 ? 1 / w.uy : 0;
+		w.cx = std::clamp(static_cast<int>(std::floor(w.ox + w.ux * tEnter)), 0, width - 1);
+		w.cy = std::clamp(static_cast<int>(std::floor(w.oy + w.uy * tEnter)), 0, height - 1);
+		w.t = tEnter;
+		w.tMaxX = w.boundaryX(w.cx);
+		w.tMaxY = w.boundaryY(w.cy);
+		w.tDeltaX = w.ux != 0 ? std::abs(w.inverseX) : std::numeric_limits<double>::infinity();
+		w.tDeltaY = w.uy != 0 ? std::abs(w.inverseY) : std::numeric_limits<double>::infinity();
+
+		while (w.cx >= 0 && w.cy >= 0 && w.cx < width && w.cy < height)
+		{
+			const std::uint64_t tile = tiles[tileIndex(w.cx, w.cy)];
+			if (hierarchy && tile == 0)
+			{
+				const int size = blocks[blockIndex(w.cx, w.cy)] == 0 ? 64 : 8;
+				if (!leaveSquare(w, size))
+				{
+					return miss;
+				}
+				continue;
+			}
+			if (tile & cellBit(w.cx, w.cy))
+			{
+				return { true, w.cx, w.cy, w.t };
+			}
+			if (w.tMaxX < w.tMaxY)
+			{
+				w.t = w.tMaxX;
+				w.cx += w.stepX;
+				w.tMaxX = w.boundaryX(w.cx);
+			}
+			else
+			{
+				w.t = w.tMaxY;
+				w.cy += w.stepY;
+				w.tMaxY = w.boundaryY(w.cy);
+			}
+			if (w.t > w.tExit)
+			{
+				return miss;
+			}
+		}
+		return miss;
+	}
+
+	// Пакет лучей: куски пакета делятся между потоками, каждый луч обрывается на первом попадании
+	void traceBatch(const GridRay* rays, GridHit* hits, std::size_t count, bool hierarchy = true, unsigned workers = workerCount()) const
+	{
+		TRACE_SCOPE("OccupancyGrid::traceBatch", "geometry");
+		parallelFor(count, [&](unsigned, std::size_t begin, std::size_t end)
+		{
+			for (std::size_t i = begin; i < end; i++)
+			{
+				hits[i] = trace(rays[i], hierarchy);
+			}
+		}, workers);
+	}
+
+	std::vector<GridHit> traceBatch(const std::vector<GridRay>& rays, bool hierarchy = true, unsigned workers = workerCount()) const
+	{
+		std::vector<GridHit> hits(rays.size());
+		traceBatch(rays.data(), hits.data(), rays.size(), hierarchy, workers);
+		return hits;
+	}
+};
@@ -0,0 +1,219 @@
+﻿#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include "geometry.h"
+#include "parallel.h"
+#include "trace.h"
+
+struct HoughSegment
+{
+	Point2d from;
+	Point2d to;
+	int points;
+};
+
+// Прямая x*cos(theta) + y*sin(theta) = rho
+struct HoughLine
+{
+	double theta;
+	double rho;
+	int votes;
+	std::vector<HoughSegment> segments;
+};
+
+class HoughTransform
+{
+private:
+	int thetaBins;
+	int rhoBins;
+	double rhoStep;
+	double rhoMax;
+	std::vector<float> cosTable;
+	std::vector<float> sinTable;
+
+public:
+	HoughTransform(int thetaBins = 180, double rhoStep = 1.0, int width = screenWidth, int height = screenHeight)
+		: thetaBins(thetaBins), rhoStep(rhoStep)
+	{
+		if (thetaBins <= 0 || rhoStep <= 0)
+		{
+			throw std::invalid_argument("Число углов и шаг rho должны быть положительными");
+		}
+
+		rhoMax = std::hypot(width, height);
+		rhoBins = 2 * static_cast<int>(std::ceil(rhoMax / rhoStep)) + 1;
+
+		const double pi = std::acos(-1.0);
+		cosTable.resize(thetaBins);
+		sinTable.resize(thetaBins);
+		for (int t = 0; t < thetaBins; t++)
+		{
+			double theta = pi * t / thetaBins;
+			cosTable[t] = static_cast<float>(std::cos(theta));
+			sinTable[t] = static_cast<float>(std::sin(theta));
+		}
+	}
+
+	int getThetaBins() const { return thetaBins; }
+	int getRhoBins() const { return rhoBins; }
+
+	// Каждый поток голосует в свою плитку, затем плитки складываются по строкам theta
+	std::vector<std::uint32_t> accumulate(const std::vector<Point2d>& points) const
+	{
+		const std::size_t cells = static_cast<std::size_t>(thetaBins) * rhoBins;
+		const unsigned workers = workerCount();
+		std::vector<std::vector<std::uint32_t>> tiles(workers);
+
+		parallelFor(points.size(), [&](unsigned worker, std::size_t begin, std::size_t end)
+		{
+			std::vector<std::uint32_t>& tile = tiles[worker];
+			tile.assign(cells, 0);
+			const float offset = static_cast<float>(rhoMax / rhoStep) + 0.5f;
+			const float inv = static_cast<float>(1.0 / rhoStep);
+			for (std::size_t i = begin; i < end; i++)
+			{
+				const float x = static_cast<float>(points[i].getX());
+				const float y = static_cast<float>(points[i].getY());
+				std::uint32_t* row = tile.data();
+				for (int t = 0; t < thetaBins; t++, row += rhoBins)
+				{
+					int r = static_cast<int>((x * cosTable[t] + y * sinTable[t]) * inv + offset);
+					row[r]++;
+				}
+			}
+		}, workers);
+
+		std::vector<std::uint32_t> acc(cells, 0);
+		parallelFor(static_cast<std::size_t>(thetaBins), [&](unsigned, std::size_t begin, std::size_t end)
+		{
+			for (const std::vector<std::uint32_t>& tile : tiles)
+			{
+				if (tile.empty())
+				{
+					continue;
+				}
+				for (std::size_t i = begin * rhoBins; i < end * rhoBins; i++)
+				{
+					acc[i] += tile[i];
+				}
+			}
+		}, workers);
+
+		return acc;
+	}
+
+	// Пики: не меньше minVotes и максимум в окне (2*radius+1)^2
+	std::vector<HoughLine> findPeaks(const std::vector<std::uint32_t>& acc, int minVotes, int maxLines, int radius = 3) const
+	{
+		struct Peak { int votes; int t; int r; };
+		std::vector<Peak> peaks;
+
+		for (int t = 0; t < thetaBins; t++)
+		{
+			for (int r = 0; r < rhoBins; r++)
+			{
+				int votes = static_cast<int>(acc[static_cast<std::size_t>(t) * rhoBins + r]);
+				if (votes < minVotes || !isLocalMax(acc, t, r, votes, radius))
+				{
+					continue;
+				}
+				peaks.push_back({ votes, t, r });
+			}
+		}
+
+		std::sort(peaks.begin(), peaks.end(), [](const Peak& a, const Peak& b) { return a.votes > b.votes; });
+		if (maxLines >= 0 && static_cast<int>(peaks.size()) > maxLines)
+		{
+			peaks.resize(maxLines);
+		}
+
+		const double pi = std::acos(-1.0);
+		std::vector<HoughLine> lines;
+		for (const Peak& p : peaks)
+		{
+			// центр ячейки с тем же смещением rhoMax, что при голосовании
+			lines.push_back({ pi * p.t / thetaBins, p.r * rhoStep - rhoMax, p.votes, {} });
+		}
+		return lines;
+	}
+
+	// Разбивает точки рядом с прямой на отрезки по разрывам больше maxGap
+	void findSegments(HoughLine& line, const std::vector<Point2d>& points, double tolerance, double maxGap, int minPoints) const
+	{
+		const double c = std::cos(line.theta);
+		const double s = std::sin(line.theta);
+
+		std::vector<std::pair<double, const Point2d*>> onLine;
+		for (const Point2d& p : points)
+		{
+			if (std::abs(p.getX() * c + p.getY() * s - line.rho) <= tolerance)
+			{
+				onLine.push_back({ -p.getX() * s + p.getY() * c, &p });
+			}
+		}
+		std::sort(onLine.begin(), onLine.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+		line.segments.clear();
+		std::size_t start = 0;
+		for (std::size_t i = 1; i <= onLine.size(); i++)
+		{
+			if (i < onLine.size() && onLine[i].first - onLine[i - 1].first <= maxGap)
+			{
+				continue;
+			}
+			if (static_cast<int>(i - start) >= minPoints)
+			{
+				line.segments.push_back({ *onLine[start].second, *onLine[i - 1].second, static_cast<int>(i - start) });
+			}
+			start = i;
+		}
+	}
+
+	std::vector<HoughLine> detect(const std::vector<Point2d>& points, int minVotes, int maxLines = 16,
+		double tolerance = 1.5, double maxGap = 10.0, int minSegmentPoints = 10) const
+	{
+		TRACE_SCOPE("HoughTransform::detect", "geometry");
+		std::vector<HoughLine> lines = findPeaks(accumulate(points), minVotes, maxLines);
+		parallelFor(lines.size(), [&](unsigned, std::size_t begin, std::size_t end)
+		{
+			for (std::size_t i = begin; i < end; i++)
+			{
+				findSegments(lines[i], points, tolerance, maxGap, minSegmentPoints);
+			}
+		});
+		return lines;
+	}
+
+private:
+	bool isLocalMax(const std::vector<std::uint32_t>& acc, int t, int r, int votes, int radius) const
+	{
+		for (int dt = -radius; dt <= radius; dt++)
+		{
+			int tt = t + dt;
+			if (tt < 0 || tt >= thetaBins)
+			{
+				continue;
+			}
+			for (int dr = -radius; dr <= radius; dr++)
+			{
+				int rr = r + dr;
+				if (rr < 0 || rr >= rhoBins || (dt == 0 && dr == 0))
+				{
+					continue;
+				}
+				int other = static_cast<int>(acc[static_cast<std::size_t>(tt) * rhoBins + rr]);
+				// при равенстве оставляем первую по порядку обхода ячейку
+				if (other > votes || (other == votes && (dt < 0 || (dt == 0 && dr < 0))))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+};
@@ -0,0 +1,175 @@
+﻿#pragma once
+
+#include <vector>
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+#include "geometry.h"
+#include "parallel.h"
+#include "spatial_grid.h"
+#include "trace.h"
+
+// Поворот на angle вокруг начала координат, затем сдвиг на (tx, ty)
+struct RigidTransform2d
+{
+	double angle = 0;
+	double tx = 0;
+	double ty = 0;
+
+	void apply(double x, double y, double& outX, double& outY) const
+	{
+		double c = std::cos(angle);
+		double s = std::sin(angle);
+		outX = c * x - s * y + tx;
+		outY = s * x + c * y + ty;
+	}
+};
+
+struct IcpOptions
+{
+	int maxIterations = 50;
+	double tolerance = 1e-4;
+	// пары дальше rejectFactor * медианы расстояний отбрасываются
+	double rejectFactor = 2.5;
+	double minRejectDistance = 2.0;
+	double maxCorrespondenceDistance = 64.0;
+};
+
+struct IcpResult
+{
+	RigidTransform2d transform;
+	int iterations = 0;
+	int inliers = 0;
+	double rmsError = 0;
+	double seconds = 0;
+	bool converged = false;
+};
+
+class IcpRegistration
+{
+private:
+	SpatialGrid target;
+
+public:
+	IcpRegistration(const std::vector<Point2d>& target, int cellSize = 16) : target(target, cellSize) {}
+
+	IcpResult align(const std::vector<Point2d>& source, const IcpOptions& options = IcpOptions(),
+		const RigidTransform2d& initial = RigidTransform2d()) const
+	{
+		TRACE_SCOPE("IcpRegistration::align", "geometry");
+		const auto start = std::chrono::steady_clock::now();
+		IcpResult result;
+		result.transform = initial;
+
+		const std::size_t n = source.size();
+		std::vector<long long> match(n);
+		std::vector<double> dist2(n);
+		double previousRms = std::numeric_limits<double>::infinity();
+
+		for (int iteration = 1; iteration <= options.maxIterations; iteration++)
+		{
+			result.iterations = iteration;
+			const RigidTransform2d current = result.transform;
+
+			parallelFor(n, [&](unsigned, std::size_t begin, std::size_t end)
+			{
+				for (std::size_t i = begin; i < end; i++)
+				{
+					double x, y;
+					current.apply(source[i].getX(), source[i].getY(), x, y);
+					match[i] = target.nearest(x, y, options.maxCorrespondenceDistance, &dist2[i]);
+				}
+			});
+
+			double threshold2 = rejectThreshold2(match, dist2, options);
+
+			std::vector<std::size_t> inliers;
+			double sum2 = 0;
+			for (std::size_t i = 0; i < n; i++)
+			{
+				if (match[i] >= 0 && dist2[i] <= threshold2)
+				{
+					inliers.push_back(i);
+					sum2 += dist2[i];
+				}
+			}
+			if (inliers.size() < 2)
+			{
+				break;
+			}
+
+			result.inliers = static_cast<int>(inliers.size());
+			result.rmsError = std::sqrt(sum2 / inliers.size());
+			result.transform = solveRigid(source, match, inliers);
+
+			if (std::abs(previousRms - result.rmsError) < options.tolerance)
+			{
+				result.converged = true;
+				break;
+			}
+			previousRms = result.rmsError;
+		}
+
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return result;
+	}
+
+private:
+	static double rejectThreshold2(const std::vector<long long>& match, const std::vector<double>& dist2, const IcpOptions& options)
+	{
+		std::vector<double> found;
+		for (std::size_t i = 0; i < match.size(); i++)
+		{
+			if (match[i] >= 0)
+			{
+				found.push_back(dist2[i]);
+			}
+		}
+		if (found.empty())
+		{
+			return 0;
+		}
+
+		std::nth_element(found.begin(), found.begin() + found.size() / 2, found.end());
+		double threshold = std::max(options.rejectFactor * std::sqrt(found[found.size() / 2]), options.minRejectDistance);
+		return threshold * threshold;
+	}
+
+	// Решение в замкнутом виде: центры масс и угол из ковариации пар
+	RigidTransform2d solveRigid(const std::vector<Point2d>& source, const std::vector<long long>& match,
+		const std::vector<std::size_t>& inliers) const
+	{
+		const std::vector<Point2d>& points = target.getPoints();
+		double sx = 0, sy = 0, qx = 0, qy = 0;
+		for (std::size_t i : inliers)
+		{
+			sx += source[i].getX();
+			sy += source[i].getY();
+			qx += points[match[i]].getX();
+			qy += points[match[i]].getY();
+		}
+		const double count = static_cast<double>(inliers.size());
+		sx /= count; sy /= count; qx /= count; qy /= count;
+
+		double dot = 0, cross = 0;
+		for (std::size_t i : inliers)
+		{
+			double ax = source[i].getX() - sx;
+			double ay = source[i].getY() - sy;
+			double bx = points[match[i]].getX() - qx;
+			double by = points[match[i]].getY() - qy;
+			dot += ax * bx + ay * by;
+			cross += ax * by - ay * bx;
+		}
+
+		RigidTransform2d t;
+		t.angle = std::atan2(cross, dot);
+		double c = std::cos(t.angle);
+		double s = std::sin(t.angle);
+		t.tx = qx - (c * sx - s * sy);
+		t.ty = qy - (s * sx + c * sy);
+		return t;
+	}
+};
@@ -0,0 +1,324 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "geometry.h"
+#include "spatial_grid.h"
+
+#ifdef __unix__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Снимок построенной сетки на диске. Вместо указателей хранятся смещения от начала файла,
+// каждая секция выровнена на страницу, поэтому файл можно отобразить в память и сразу отвечать на запросы.
+
+static_assert(std::is_trivially_copyable_v<Point2d> && sizeof(Point2d) == 2 * sizeof(std::int32_t), "Point2d layout");
+
+struct GridSnapshotSection
+{
+	std::uint64_t offset;
+	std::uint64_t bytes;
+	std::uint64_t checksum;
+};
+
+enum GridSnapshotPart { CellStartPart, OrderPart, PointsPart, HullPart, PartCount };
+
+struct GridSnapshotHeader
+{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t pageSize;
+	std::int32_t cellSize;
+	std::int32_t columns;
+	std::int32_t rows;
+	std::int32_t reserved;
+	std::uint64_t pointCount;
+	std::uint64_t hullCount;
+	GridSnapshotSection sections[PartCount];
+	std::uint64_t headerChecksum;
+};
+
+const char gridSnapshotMagic[8] = { 'G', 'R', 'I', 'D', 'S', 'N', 'A', 'P' };
+const std::uint32_t gridSnapshotVersion = 1;
+const std::uint64_t gridSnapshotPage = 4096;
+
+// Контрольная сумма по 8-байтовым словам
+inline std::uint64_t snapshotChecksum(const void* data, std::size_t bytes)
+{
+	const unsigned char* in = static_cast<const unsigned char*>(data);
+	std::uint64_t hash = 0x9E3779B97F4A7C15ull ^ bytes;
+	std::size_t i = 0;
+	for (; i + 8 <= bytes; i += 8)
+	{
+		std::uint64_t word;
+		std::memcpy(&word, in + i, 8);
+		hash = (hash ^ word) * 0x100000001B3ull;
+		hash ^= hash >> 29;
+	}
+	for (; i < bytes; i++)
+	{
+		hash = (hash ^ in[i]) * 0x100000001B3ull;
+	}
+	return hash ^ (hash >> 32);
+}
+
+// Пишет во временный файл и переименовывает, чтобы читатель не увидел недописанный снимок
+inline void saveGridSnapshot(const SpatialGrid& grid, const std::vector<Point2d>& hull, const std::string& path)
+{
+	const void* data[PartCount] = { grid.getCellStart().data(), grid.getOrder().data(), grid.getPoints().data(), hull.data() };
+	std::uint64_t bytes[PartCount] = {
+		grid.getCellStart().size() * sizeof(std::uint32_t),
+		grid.getOrder().size() * sizeof(std::uint32_t),
+		grid.getPoints().size() * sizeof(Point2d),
+		hull.size() * sizeof(Point2d)
+	};
+
+	GridSnapshotHeader header{};
+	std::memcpy(header.magic, gridSnapshotMagic, sizeof(header.magic));
+	header.version = gridSnapshotVersion;
+	header.pageSize = static_cast<std::uint32_t>(gridSnapshotPage);
+	header.cellSize = grid.getCellSize();
+	header.columns = grid.getColumns();
+	header.rows = grid.getRows();
+	header.pointCount = grid.size();
+	header.hullCount = hull.size();
+
+	std::uint64_t offset = gridSnapshotPage;
+	for (int part = 0; part < PartCount; part++)
+	{
+		header.sections[part] = { offset, bytes[part], snapshotChecksum(data[part], bytes[part]) };
+		offset += (bytes[part] + gridSnapshotPage - 1) / gridSnapshotPage * gridSnapshotPage;
+	}
+	header.headerChecksum = snapshotChecksum(&header, offsetof(GridSnapshotHeader, headerChecksum));
+
+	const std::string temporary = path + ".tmp";
+	{
+		std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+		std::vector<char> padding(gridSnapshotPage, 0);
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		out.write(padding.data(), gridSnapshotPage - sizeof(header));
+		for (int part = 0; part < PartCount; part++)
+		{
+			out.write(static_cast<const char*>(data[part]), bytes[part]);
+			out.write(padding.data(), (gridSnapshotPage - bytes[part] % gridSnapshotPage) % gridSnapshotPage);
+		}
+		out.close();
+		if (!out)
+		{
+			throw std::runtime_error("Не удалось записать снимок " + temporary);
+		}
+	}
+#ifdef __unix__
+	// данные должны лечь на диск раньше, чем переименование: иначе после сбоя под именем снимка окажется пустой файл
+	const int fd = ::open(temporary.c_str(), O_RDONLY | O_CLOEXEC);
+	const bool synced = fd >= 0 && fsync(fd) == 0;
+	if (fd >= 0)
+	{
+		::close(fd);
+	}
+	if (!synced)
+	{
+		throw std::runtime_error("Не удалось сбросить снимок на диск " + temporary);
+	}
+#endif
+	if (std::rename(temporary.c_str(), path.c_str()) != 0)
+	{
+		throw std::runtime_error("Не удалось переименовать снимок в " + path);
+	}
+}
+
+#ifdef __unix__
+
+// Отображение снимка в память. Страницы подгружаются при первом обращении, поэтому при открытии
+// проверяются заголовок и индексы (cellStart не убывает и кончается на pointCount, order меньше pointCount),
+// чтобы запросы не вышли за секции; контрольные суммы секций - по вызову verify().
+class GridSnapshot
+{
+private:
+	int fd = -1;
+	void* memory = nullptr;
+	std::size_t mappedBytes = 0;
+	const GridSnapshotHeader* header = nullptr;
+
+public:
+	GridSnapshot() {}
+
+	explicit GridSnapshot(const std::string& path, bool verifySections = false)
+	{
+		open(path, verifySections);
+	}
+
+	GridSnapshot(const GridSnapshot&) = delete;
+	GridSnapshot& operator=(const GridSnapshot&) = delete;
+
+	~GridSnapshot()
+	{
+		close();
+	}
+
+	void open(const std::string& path, bool verifySections = false)
+	{
+		close();
+		fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat info;
+		if (fd < 0 || fstat(fd, &info) != 0 || static_cast<std::uint64_t>(info.st_size) < gridSnapshotPage)
+		{
+			close();
+			throw std::runtime_error("Не удалось открыть снимок " + path);
+		}
+
+		mappedBytes = static_cast<std::size_t>(info.st_size);
+		memory = mmap(nullptr, mappedBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (memory == MAP_FAILED)
+		{
+			memory = nullptr;
+			close();
+			throw std::runtime_error("Не удалось отобразить снимок " + path);
+		}
+		header = static_cast<const GridSnapshotHeader*>(memory);
+
+		if (!validHeader() || !validIndex())
+		{
+			close();
+			throw std::runtime_error("Поврежденный или несовместимый снимок " + path);
+		}
+		// доступ к order и points случайный, упреждающее чтение только мешает
+		madvise(memory, mappedBytes, MADV_RANDOM);
+
+		if (verifySections && !verify())
+		{
+			close();
+			throw std::runtime_error("Контрольная сумма секции снимка не совпала: " + path);
+		}
+	}
+
+	void close()
+	{
+		if (memory)
+		{
+			munmap(memory, mappedBytes);
+		}
+		if (fd >= 0)
+		{
+			::close(fd);
+		}
+		fd = -1;
+		memory = nullptr;
+		header = nullptr;
+		mappedBytes = 0;
+	}
+
+	bool isOpen() const { return header != nullptr; }
+
+	// Читает все секции целиком
+	bool verify() const
+	{
+		for (int part = 0; part < PartCount; part++)
+		{
+			const GridSnapshotSection& section = header->sections[part];
+			if (snapshotChecksum(sectionData(part), section.bytes) != section.checksum)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Подсказка ядру подгрузить весь файл заранее
+	void prefetch() const
+	{
+		madvise(memory, mappedBytes, MADV_WILLNEED);
+	}
+
+	SpatialGridView view() const
+	{
+		return SpatialGridView{ header->cellSize, header->columns, header->rows,
+			static_cast<const std::uint32_t*>(sectionData(CellStartPart)),
+			static_cast<const std::uint32_t*>(sectionData(OrderPart)),
+			static_cast<const Point2d*>(sectionData(PointsPart)),
+			static_cast<std::size_t>(header->pointCount) };
+	}
+
+	std::vector<Point2d> hull() const
+	{
+		const Point2d* begin = static_cast<const Point2d*>(sectionData(HullPart));
+		return std::vector<Point2d>(begin, begin + header->hullCount);
+	}
+
+private:
+	const void* sectionData(int part) const
+	{
+		return static_cast<const unsigned char*>(memory) + header->sections[part].offset;
+	}
+
+	bool validHeader() const
+	{
+		if (std::memcmp(header->magic, gridSnapshotMagic, sizeof(header->magic)) != 0
+			|| header->version != gridSnapshotVersion
+			|| header->headerChecksum != snapshotChecksum(header, offsetof(GridSnapshotHeader, headerChecksum))
+			|| header->cellSize <= 0 || header->columns <= 0 || header->rows <= 0
+			|| header->pointCount > std::numeric_limits<std::uint32_t>::max() || header->hullCount > mappedBytes / sizeof(Point2d))
+		{
+			return false;
+		}
+
+		const std::uint64_t expected[PartCount] = {
+			(static_cast<std::uint64_t>(header->columns) * header->rows + 1) * sizeof(std::uint32_t),
+			header->pointCount * sizeof(std::uint32_t),
+			header->pointCount * sizeof(Point2d),
+			header->hullCount * sizeof(Point2d)
+		};
+		for (int part = 0; part < PartCount; part++)
+		{
+			const GridSnapshotSection& section = header->sections[part];
+			if (section.bytes != expected[part] || section.offset % gridSnapshotPage != 0
+				|| section.offset > mappedBytes || section.bytes > mappedBytes - section.offset)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Линейный проход по cellStart и order без контрольных сумм
+	bool validIndex() const
+	{
+		const std::uint32_t* cellStart = static_cast<const std::uint32_t*>(sectionData(CellStartPart));
+		const std::size_t cells = static_cast<std::size_t>(header->columns) * header->rows;
+		if (cellStart[0] != 0 || cellStart[cells] != header->pointCount)
+		{
+			return false;
+		}
+		for (std::size_t cell = 0; cell < cells; cell++)
+		{
+			if (cellStart[cell] > cellStart[cell + 1])
+			{
+				return false;
+			}
+		}
+
+		const std::uint32_t* order = static_cast<const std::uint32_t*>(sectionData(OrderPart));
+		for (std::uint64_t i = 0; i < header->pointCount; i++)
+		{
+			if (order[i] >= header->pointCount)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+#endif
@@ -0,0 +1,127 @@
+﻿#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "geometry.h"
+#include "batch.h"
+#include "aosoa.h"
+
+using namespace std;
+
+// Сравнение раскладок AoS (vector<Vector2d>), SoA (PointBatch) и AoSoA (AosoaVectors)
+// на потоковом проходе, случайном доступе к x и y одного вектора и выборке по списку индексов.
+// Замеры имеют смысл только в оптимизированной сборке (-DCMAKE_BUILD_TYPE=Release).
+
+static volatile long long sink;
+
+template <class Body>
+static double bestMs(Body body, int repeats = 5)
+{
+	double best = 1e300;
+	for (int r = 0; r < repeats; r++)
+	{
+		auto start = chrono::steady_clock::now();
+		sink = body();
+		best = min(best, chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+static void report(const string& workload, double aos, double soa, double aosoa)
+{
+	cout << left << setw(16) << workload << right << fixed << setprecision(2)
+		<< setw(10) << aos << setw(10) << soa << setw(10) << aosoa << endl;
+}
+
+int main(int argc, char** argv)
+{
+	const size_t n = argc > 1 ? stoul(argv[1]) : 4000000;
+	const size_t lookups = n / 4;
+
+	vector<Vector2d> aosA, aosB;
+	PointBatch soaA, soaB;
+	AosoaVectors<int, 8> aosoaA, aosoaB;
+	aosA.reserve(n); aosB.reserve(n);
+	soaA.reserve(n); soaB.reserve(n);
+	aosoaA.reserve(n); aosoaB.reserve(n);
+
+	uint32_t seed = 1;
+	auto next = [&seed]() { seed = seed * 1664525u + 1013904223u; return static_cast<int>(seed >> 20); };
+	for (size_t i = 0; i < n; i++)
+	{
+		Vector2d a(Point2d(next() % screenWidth, next() % screenHeight, screenWidth, screenHeight), Point2d());
+		Vector2d b(Point2d(next() % screenWidth, next() % screenHeight, screenWidth, screenHeight), Point2d());
+		aosA.push_back(a); aosB.push_back(b);
+		soaA.push(a); soaB.push(b);
+		aosoaA.push(a); aosoaB.push(b);
+	}
+
+	vector<uint32_t> indices(lookups);
+	for (uint32_t& index : indices)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		index = static_cast<uint32_t>((static_cast<uint64_t>(seed) * n) >> 32);
+	}
+	vector<long long> out(n);
+
+	cout << "Векторов: " << n << ", время в мс (лучшее из 5)" << endl;
+	cout << left << setw(16) << "" << right << setw(10) << "AoS" << setw(10) << "SoA" << setw(10) << "AoSoA" << endl;
+
+	// поток: векторное произведение всех пар
+	report("streaming",
+		bestMs([&]() {
+			for (size_t i = 0; i < n; i++) out[i] = static_cast<long long>(aosA[i].crossProduct(aosB[i]));
+			return out[n / 2];
+		}),
+		bestMs([&]() {
+			batchCross(soaA.x(), soaA.y(), soaB.x(), soaB.y(), out.data(), n);
+			return out[n / 2];
+		}),
+		bestMs([&]() {
+			aosoaCross(aosoaA, aosoaB, out.data());
+			return out[n / 2];
+		}));
+
+	// случайный доступ: x и y одного вектора читаются вместе
+	report("random access",
+		bestMs([&]() {
+			long long sum = 0;
+			for (uint32_t i : indices) sum += static_cast<long long>(aosA[i][0]) * aosA[i][1];
+			return sum;
+		}),
+		bestMs([&]() {
+			long long sum = 0;
+			for (uint32_t i : indices) sum += static_cast<long long>(soaA.x()[i]) * soaA.y()[i];
+			return sum;
+		}),
+		bestMs([&]() {
+			long long sum = 0;
+			for (uint32_t i : indices) sum += static_cast<long long>(aosoaA.x(i)) * aosoaA.y(i);
+			return sum;
+		}));
+
+	// выборка: собрать векторы по индексам в плотный SoA-пакет и посчитать длины
+	vector<int> gx(lookups), gy(lookups);
+	vector<double> lengths(lookups);
+	report("gather",
+		bestMs([&]() {
+			for (size_t k = 0; k < lookups; k++) { gx[k] = aosA[indices[k]][0]; gy[k] = aosA[indices[k]][1]; }
+			batchLength(gx.data(), gy.data(), lengths.data(), lookups);
+			return static_cast<long long>(lengths[0]);
+		}),
+		bestMs([&]() {
+			for (size_t k = 0; k < lookups; k++) { gx[k] = soaA.x()[indices[k]]; gy[k] = soaA.y()[indices[k]]; }
+			batchLength(gx.data(), gy.data(), lengths.data(), lookups);
+			return static_cast<long long>(lengths[0]);
+		}),
+		bestMs([&]() {
+			for (size_t k = 0; k < lookups; k++) { gx[k] = aosoaA.x(indices[k]); gy[k] = aosoaA.y(indices[k]); }
+			batchLength(gx.data(), gy.data(), lengths.data(), lookups);
+			return static_cast<long long>(lengths[0]);
+		}));
+
+	return 0;
+}
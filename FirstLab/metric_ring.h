@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+// Кольцевой буфер метрик без блокировок: писать могут любые потоки, читает один.
+// Писатель никогда не ждет; если читатель отстал больше чем на емкость, старые значения теряются
+// и учитываются в lost(). Слот защищен номером записи, как в seqlock.
+template <class T>
+class MetricRing
+{
+	static_assert(std::is_trivially_copyable_v<T>, "MetricRing holds trivially copyable values only");
+
+private:
+	struct Slot
+	{
+		std::atomic<std::uint64_t> sequence{ 0 };
+		std::atomic<T> value{};
+	};
+
+	std::unique_ptr<Slot[]> slots;
+	std::size_t mask;
+	alignas(64) std::atomic<std::uint64_t> head{ 0 };
+	alignas(64) std::uint64_t tail = 0;
+	std::uint64_t dropped = 0;
+
+public:
+	explicit MetricRing(std::size_t capacity = 4096)
+	{
+		if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+		{
+			throw std::invalid_argument("Емкость кольца должна быть степенью двойки");
+		}
+		slots.reset(new Slot[capacity]);
+		mask = capacity - 1;
+	}
+
+	MetricRing(const MetricRing&) = delete;
+	MetricRing& operator=(const MetricRing&) = delete;
+
+	std::size_t capacity() const { return mask + 1; }
+
+	void push(T value)
+	{
+		const std::uint64_t index = head.fetch_add(1, std::memory_order_relaxed);
+		Slot& slot = slots[index & mask];
+		slot.sequence.store(0, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.value.store(value, std::memory_order_relaxed);
+		slot.sequence.store(index + 1, std::memory_order_release);
+	}
+
+	// Передает в sink(value) не больше limit новых значений, возвращает их число.
+	// Слот, который писатель занял, но еще не дописал, остается до следующего вызова.
+	template <class Sink>
+	std::size_t consume(Sink sink, std::size_t limit = SIZE_MAX)
+	{
+		const std::uint64_t end = head.load(std::memory_order_acquire);
+		if (end - tail > capacity())
+		{
+			dropped += end - tail - capacity();
+			tail = end - capacity();
+		}
+
+		std::size_t taken = 0;
+		while (tail < end && taken < limit)
+		{
+			const Slot& slot = slots[tail & mask];
+			const std::uint64_t before = slot.sequence.load(std::memory_order_acquire);
+			if (before != tail + 1)
+			{
+				if (before > tail + 1)
+				{
+					// слот уже перезаписан следующим кругом
+					dropped++;
+					tail++;
+					continue;
+				}
+				break;
+			}
+			const T value = slot.value.load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != before)
+			{
+				dropped++;
+				tail++;
+				continue;
+			}
+			sink(value);
+			tail++;
+			taken++;
+		}
+		return taken;
+	}
+
+	// Значения, еще не прочитанные читателем (оценка: писатели могут добавлять параллельно)
+	std::size_t pending() const
+	{
+		return static_cast<std::size_t>(head.load(std::memory_order_relaxed) - tail);
+	}
+
+	std::uint64_t lost() const { return dropped; }
+};
@@ -0,0 +1,247 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "parallel.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Большие массивы для пакетных контейнеров: страницы по 2 МБ и размещение по первому касанию.
+// Страница попадает на узел NUMA того ядра, которое первым в нее пишет, поэтому массив
+// заполняется тем же разбиением parallelFor, которым его потом обрабатывают.
+
+enum class HugePages
+{
+	None,
+	Transparent, // madvise(MADV_HUGEPAGE), ядро собирает большие страницы само
+	Explicit     // MAP_HUGETLB из заранее выделенного пула, при нехватке - Transparent
+};
+
+struct LargeArrayOptions
+{
+	HugePages hugePages = HugePages::Transparent;
+	unsigned workers = workerCount();
+	bool pinThreads = false;
+};
+
+const std::size_t hugePageSize = 2u << 20;
+
+class LargePageMemory
+{
+private:
+	void* memory = nullptr;
+	std::size_t bytes = 0;
+	bool mapped = false;
+	// режим, который удалось получить: Explicit может откатиться в Transparent, а тот - в None
+	HugePages granted = HugePages::None;
+
+public:
+	LargePageMemory() {}
+
+	LargePageMemory(std::size_t size, HugePages mode)
+	{
+		bytes = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+		if (bytes == 0)
+		{
+			return;
+		}
+#ifdef __linux__
+		if (mode == HugePages::Explicit)
+		{
+			void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if (p != MAP_FAILED)
+			{
+				memory = p;
+				mapped = true;
+				granted = HugePages::Explicit;
+				return;
+			}
+			mode = HugePages::Transparent;
+		}
+
+		// лишние 2 МБ, чтобы выровнять начало на границу большой страницы
+		std::size_t total = bytes + hugePageSize;
+		void* p = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (p == MAP_FAILED)
+		{
+			throw std::bad_alloc();
+		}
+		std::uintptr_t start = reinterpret_cast<std::uintptr_t>(p);
+		std::uintptr_t aligned = (start + hugePageSize - 1) / hugePageSize * hugePageSize;
+		if (aligned > start)
+		{
+			munmap(p, aligned - start);
+		}
+		std::size_t after = start + total - (aligned + bytes);
+		if (after)
+		{
+			munmap(reinterpret_cast<void*>(aligned + bytes), after);
+		}
+		memory = reinterpret_cast<void*>(aligned);
+		mapped = true;
+		if (mode == HugePages::Transparent && madvise(memory, bytes, MADV_HUGEPAGE) == 0)
+		{
+			granted = HugePages::Transparent;
+		}
+#else
+		(void)mode;
+		memory = ::operator new(bytes, std::align_val_t(64));
+#endif
+	}
+
+	LargePageMemory(const LargePageMemory&) = delete;
+	LargePageMemory& operator=(const LargePageMemory&) = delete;
+
+	LargePageMemory(LargePageMemory&& other) noexcept { swap(other); }
+
+	LargePageMemory& operator=(LargePageMemory&& other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+
+	~LargePageMemory()
+	{
+		if (!memory)
+		{
+			return;
+		}
+#ifdef __linux__
+		if (mapped)
+		{
+			munmap(memory, bytes);
+		}
+#else
+		::operator delete(memory, std::align_val_t(64));
+#endif
+	}
+
+	void* data() const { return memory; }
+	std::size_t size() const { return bytes; }
+	// Только то, что ядро приняло запрос; сколько памяти действительно в больших страницах - hugeBytes()
+	bool usesHugePages() const { return granted != HugePages::None; }
+	HugePages hugePageMode() const { return granted; }
+
+	// Байты диапазона в больших страницах по /proc/self/smaps (AnonHugePages и *_Hugetlb).
+	// Соседние отображения ядро может слить в одну область, тогда ее большие страницы делятся пропорционально
+	std::size_t hugeBytes() const
+	{
+#ifdef __linux__
+		if (!memory)
+		{
+			return 0;
+		}
+		const unsigned long long begin = reinterpret_cast<std::uintptr_t>(memory);
+		const unsigned long long end = begin + bytes;
+		unsigned long long from = 0, to = 0;
+		double total = 0;
+		std::ifstream smaps("/proc/self/smaps");
+		std::string line;
+		while (std::getline(smaps, line))
+		{
+			unsigned long long a, b, kb;
+			char name[64];
+			// строка области "начало-конец права ...", дальше ее поля "Имя: N kB"
+			if (std::sscanf(line.c_str(), "%llx-%llx ", &a, &b) == 2)
+			{
+				from = a;
+				to = b;
+			}
+			else if (std::sscanf(line.c_str(), "%63[^:]: %llu kB", name, &kb) == 2 && to > from
+				&& (std::strcmp(name, "AnonHugePages") == 0 || std::strcmp(name, "Private_Hugetlb") == 0 || std::strcmp(name, "Shared_Hugetlb") == 0))
+			{
+				const unsigned long long overlapFrom = std::max(from, begin), overlapTo = std::min(to, end);
+				if (overlapTo > overlapFrom)
+				{
+					total += kb * 1024.0 * (overlapTo - overlapFrom) / (to - from);
+				}
+			}
+		}
+		return static_cast<std::size_t>(total);
+#else
+		return 0;
+#endif
+	}
+
+private:
+	void swap(LargePageMemory& other) noexcept
+	{
+		std::swap(memory, other.memory);
+		std::swap(bytes, other.bytes);
+		std::swap(mapped, other.mapped);
+		std::swap(granted, other.granted);
+	}
+};
+
+// Массив без инициализации при выделении: нули пишут рабочие потоки, каждый в свой кусок
+template <class T>
+class NumaArray
+{
+	static_assert(std::is_trivially_copyable_v<T>, "NumaArray holds trivially copyable values only");
+
+private:
+	LargePageMemory memory;
+	std::size_t count = 0;
+
+public:
+	NumaArray() {}
+
+	NumaArray(std::size_t n, const LargeArrayOptions& options = LargeArrayOptions())
+		: memory(n * sizeof(T), options.hugePages), count(n)
+	{
+		T* items = data();
+		parallelFor(count, [items](unsigned, std::size_t begin, std::size_t end)
+		{
+			std::memset(static_cast<void*>(items + begin), 0, (end - begin) * sizeof(T));
+		}, options.workers, options.pinThreads);
+	}
+
+	T* data() { return static_cast<T*>(memory.data()); }
+	const T* data() const { return static_cast<const T*>(memory.data()); }
+	std::size_t size() const { return count; }
+	bool usesHugePages() const { return memory.usesHugePages(); }
+	HugePages hugePageMode() const { return memory.hugePageMode(); }
+	std::size_t hugeBytes() const { return memory.hugeBytes(); }
+
+	T& operator[](std::size_t i) { return data()[i]; }
+	const T& operator[](std::size_t i) const { return data()[i]; }
+
+	T* begin() { return data(); }
+	T* end() { return data() + count; }
+	const T* begin() const { return data(); }
+	const T* end() const { return data() + count; }
+};
+
+// SoA-пакет векторов фиксированного размера поверх NumaArray
+class NumaPointBatch
+{
+private:
+	NumaArray<int> xs;
+	NumaArray<int> ys;
+
+public:
+	NumaPointBatch() {}
+
+	NumaPointBatch(std::size_t n, const LargeArrayOptions& options = LargeArrayOptions()) : xs(n, options), ys(n, options) {}
+
+	std::size_t size() const { return xs.size(); }
+	int* x() { return xs.data(); }
+	int* y() { return ys.data(); }
+	const int* x() const { return xs.data(); }
+	const int* y() const { return ys.data(); }
+	bool usesHugePages() const { return xs.usesHugePages() && ys.usesHugePages(); }
+	// Режим хуже из двух массивов: None < Transparent < Explicit
+	HugePages hugePageMode() const { return std::min(xs.hugePageMode(), ys.hugePageMode()); }
+	std::size_t hugeBytes() const { return xs.hugeBytes() + ys.hugeBytes(); }
+};
@@ -0,0 +1,105 @@
+﻿#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <string>
+#include <algorithm>
+
+#include "batch.h"
+#include "parallel.h"
+#include "numa_alloc.h"
+
+using namespace std;
+
+// Пропускная способность пакетных dot/cross на больших массивах при разных способах размещения:
+// обычный vector, заполненный одним потоком, и NumaPointBatch с первым касанием из рабочих потоков,
+// большими страницами и привязкой потоков. Запускать в Release-сборке.
+
+struct Arrays
+{
+	int* ax;
+	int* ay;
+	int* bx;
+	int* by;
+	long long* out;
+};
+
+static double run(const Arrays& a, size_t n, unsigned workers, bool pin)
+{
+	double best = 1e300;
+	for (int r = 0; r < 5; r++)
+	{
+		auto start = chrono::steady_clock::now();
+		parallelFor(n, [&a](unsigned, size_t begin, size_t end)
+		{
+			batchDot(a.ax + begin, a.ay + begin, a.bx + begin, a.by + begin, a.out + begin, end - begin);
+			batchCross(a.ax + begin, a.ay + begin, a.bx + begin, a.by + begin, a.out + begin, end - begin);
+		}, workers, pin);
+		best = min(best, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+	}
+	return best;
+}
+
+// hugeShare - доля массивов в больших страницах по /proc/self/smaps
+static void report(const string& name, double seconds, size_t n, double hugeShare)
+{
+	cout << fixed << setprecision(2) << setw(10) << seconds * 1000 << " мс" << setw(8) << n / seconds / 1e9 << " млрд пар/с  " << name;
+	if (hugeShare > 0)
+	{
+		cout << " (большие страницы: " << setprecision(0) << hugeShare * 100 << "%)";
+	}
+	cout << endl;
+}
+
+int main(int argc, char** argv)
+{
+	const size_t n = argc > 1 ? stoul(argv[1]) : 32u << 20;
+	const unsigned workers = argc > 2 ? static_cast<unsigned>(stoul(argv[2])) : workerCount();
+	cout << "Пар векторов: " << n << ", потоков: " << workers << endl;
+
+	{
+		vector<int> ax(n, 1), ay(n, 2), bx(n, 3), by(n, 4);
+		vector<long long> out(n);
+		report("vector, заполнен одним потоком", run({ ax.data(), ay.data(), bx.data(), by.data(), out.data() }, n, workers, false), n, 0);
+	}
+
+	const HugePages modes[] = { HugePages::None, HugePages::Transparent, HugePages::Explicit };
+	// подпись по режиму, который массивы действительно получили
+	auto name = [](HugePages requested, HugePages granted)
+	{
+		const char* names[] = { "первое касание", "первое касание + THP", "первое касание + hugetlb" };
+		string text = names[static_cast<int>(granted)];
+		if (granted != requested)
+		{
+			text += requested == HugePages::Explicit ? " (пул hugetlb пуст)" : " (THP недоступны)";
+		}
+		return text;
+	};
+	for (int m = 0; m < 3; m++)
+	{
+		for (bool pin : { false, true })
+		{
+			LargeArrayOptions options;
+			options.hugePages = modes[m];
+			options.workers = workers;
+			options.pinThreads = pin;
+
+			NumaPointBatch a(n, options), b(n, options);
+			NumaArray<long long> out(n, options);
+			parallelFor(n, [&](unsigned, size_t begin, size_t end)
+			{
+				fill(a.x() + begin, a.x() + end, 1);
+				fill(a.y() + begin, a.y() + end, 2);
+				fill(b.x() + begin, b.x() + end, 3);
+				fill(b.y() + begin, b.y() + end, 4);
+			}, workers, pin);
+
+			double seconds = run({ a.x(), a.y(), b.x(), b.y(), out.data() }, n, workers, pin);
+			const HugePages granted = min({ a.hugePageMode(), b.hugePageMode(), out.hugePageMode() });
+			const double hugeShare = static_cast<double>(a.hugeBytes() + b.hugeBytes() + out.hugeBytes())
+				/ (4 * n * sizeof(int) + n * sizeof(long long));
+			report(name(modes[m], granted) + (pin ? ", привязка" : ""), seconds, n, min(hugeShare, 1.0));
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,104 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "console.h"
+
+// Квантование цветов в 16 цветов консоли и шкалы плотности для терминальных графиков
+
+struct Rgb
+{
+	std::uint8_t r;
+	std::uint8_t g;
+	std::uint8_t b;
+};
+
+// Стандартная палитра консоли Windows в порядке Color
+const Rgb consolePalette[colorCount] = {
+	{ 0, 0, 0 }, { 0, 55, 218 }, { 19, 161, 14 }, { 58, 150, 221 },
+	{ 197, 15, 31 }, { 136, 23, 152 }, { 193, 156, 0 }, { 204, 204, 204 },
+	{ 118, 118, 118 }, { 59, 120, 255 }, { 22, 198, 12 }, { 97, 214, 214 },
+	{ 231, 72, 86 }, { 180, 0, 158 }, { 249, 241, 165 }, { 242, 242, 242 }
+};
+
+// Ближайший цвет палитры; зеленый весит больше, как и в восприятии яркости
+inline Color nearestColor(Rgb color)
+{
+	int best = 0;
+	long bestDistance = -1;
+	for (int i = 0; i < colorCount; i++)
+	{
+		const long dr = color.r - consolePalette[i].r;
+		const long dg = color.g - consolePalette[i].g;
+		const long db = color.b - consolePalette[i].b;
+		const long distance = 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+		if (bestDistance < 0 || distance < bestDistance)
+		{
+			best = i;
+			bestDistance = distance;
+		}
+	}
+	return static_cast<Color>(best);
+}
+
+// Квантование через таблицу 32x32x32: для потоков пикселей быстрее полного перебора
+class PaletteQuantizer
+{
+private:
+	std::vector<std::uint8_t> table;
+
+public:
+	PaletteQuantizer() : table(32 * 32 * 32)
+	{
+		for (int r = 0; r < 32; r++)
+		{
+			for (int g = 0; g < 32; g++)
+			{
+				for (int b = 0; b < 32; b++)
+				{
+					const Rgb center = { static_cast<std::uint8_t>(r * 8 + 4), static_cast<std::uint8_t>(g * 8 + 4), static_cast<std::uint8_t>(b * 8 + 4) };
+					table[(r << 10) | (g << 5) | b] = static_cast<std::uint8_t>(nearestColor(center));
+				}
+			}
+		}
+	}
+
+	Color quantize(Rgb color) const
+	{
+		return static_cast<Color>(table[((color.r >> 3) << 10) | ((color.g >> 3) << 5) | (color.b >> 3)]);
+	}
+};
+
+// Ступень шкалы плотности: символ заливки и цвет
+struct ShadeLevel
+{
+	std::string glyph;
+	Color color;
+};
+
+// Тепловая шкала от синего к красному, квантованная в палитру; заливка растет от ░ к █
+inline std::vector<ShadeLevel> densityRamp(int levels = 8)
+{
+	static const Rgb heat[5] = { { 0, 0, 255 }, { 0, 255, 255 }, { 0, 255, 0 }, { 255, 255, 0 }, { 255, 0, 0 } };
+	// ░ ▒ ▓ █ байтами UTF-8, чтобы не зависеть от кодировки исполнения компилятора
+	static const char* const shades[4] = { "\xE2\x96\x91", "\xE2\x96\x92", "\xE2\x96\x93", "\xE2\x96\x88" };
+	const PaletteQuantizer quantizer;
+
+	std::vector<ShadeLevel> ramp;
+	for (int i = 0; i < levels; i++)
+	{
+		const double t = levels > 1 ? static_cast<double>(i) / (levels - 1) : 1.0;
+		const double position = t * 4;
+		const int k = position >= 4 ? 3 : static_cast<int>(position);
+		const double f = position - k;
+		const Rgb color = {
+			static_cast<std::uint8_t>(heat[k].r + (heat[k + 1].r - heat[k].r) * f),
+			static_cast<std::uint8_t>(heat[k].g + (heat[k + 1].g - heat[k].g) * f),
+			static_cast<std::uint8_t>(heat[k].b + (heat[k + 1].b - heat[k].b) * f)
+		};
+		ramp.push_back({ shades[i * 4 / levels], quantizer.quantize(color) });
+	}
+	return ramp;
+}
@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+inline unsigned workerCount()
+{
+	unsigned n = std::thread::hardware_concurrency();
+	return n ? n : 1;
+}
+
+// Границы куска worker из workers при равном разбиении [0, count)
+inline std::size_t chunkBegin(std::size_t count, unsigned workers, unsigned worker)
+{
+	return count * worker / workers;
+}
+
+// Привязывает текущий поток к ядру core; без поддержки ОС ничего не делает
+inline bool pinCurrentThread(unsigned core)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(core % workerCount(), &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	(void)core;
+	return false;
+#endif
+}
+
+// Возвращает вызывающему потоку прежнюю привязку после parallelFor с pinThreads
+class ThreadAffinityGuard
+{
+private:
+#ifdef __linux__
+	cpu_set_t saved;
+	bool valid = false;
+#endif
+
+public:
+	ThreadAffinityGuard()
+	{
+#ifdef __linux__
+		valid = pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) == 0;
+#endif
+	}
+
+	~ThreadAffinityGuard()
+	{
+#ifdef __linux__
+		if (valid)
+		{
+			pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+		}
+#endif
+	}
+
+	ThreadAffinityGuard(const ThreadAffinityGuard&) = delete;
+	ThreadAffinityGuard& operator=(const ThreadAffinityGuard&) = delete;
+};
+
+// body(worker, begin, end) вызывается для каждого куска, нулевой кусок - в вызывающем потоке.
+// С pinThreads поток worker работает на ядре worker, так что одинаковые разбиения попадают на одни ядра.
+template <class Body>
+void parallelFor(std::size_t count, Body body, unsigned workers = workerCount(), bool pinThreads = false)
+{
+	// workers приходит от вызывающего кода, 0 считается одним потоком
+	workers = std::max(1u, workers);
+	if (workers > count)
+	{
+		workers = count ? static_cast<unsigned>(count) : 1;
+	}
+
+	std::vector<std::thread> threads;
+	threads.reserve(workers - 1);
+	for (unsigned w = 1; w < workers; w++)
+	{
+		threads.emplace_back([&body, count, workers, w, pinThreads]()
+		{
+			if (pinThreads)
+			{
+				pinCurrentThread(w);
+			}
+			body(w, chunkBegin(count, workers, w), chunkBegin(count, workers, w + 1));
+		});
+	}
+
+	if (pinThreads)
+	{
+		ThreadAffinityGuard guard;
+		pinCurrentThread(0);
+		body(0u, chunkBegin(count, workers, 0), chunkBegin(count, workers, 1));
+	}
+	else
+	{
+		body(0u, chunkBegin(count, workers, 0), chunkBegin(count, workers, 1));
+	}
+
+	for (std::thread& t : threads)
+	{
+		t.join();
+	}
+}
@@ -0,0 +1,285 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "parallel.h"
+#include "trace.h"
+
+// Пирамида уровней детализации для больших наборов точек. На уровне L окно делится на клетки 2^L x 2^L,
+// у каждой непустой клетки хранится число точек и представитель - одна из ее точек. Клетки уровня
+// упорядочены по коду Мортона, поэтому дети клетки лежат на уровне ниже подряд, а уровень L + 1
+// получается слиянием соседей уровня L.
+
+// Видимая часть окна [minX, maxX] x [minY, maxY] и размер пикселя экрана в единицах окна
+struct PyramidView
+{
+	double minX;
+	double minY;
+	double maxX;
+	double maxY;
+	double worldPerPixel = 1;
+};
+
+// Клетка уровня level с номером index; point - ее представитель, count - сколько точек она заменяет
+struct PyramidCell
+{
+	int level;
+	std::uint32_t index;
+	std::uint32_t count;
+	Point2d point;
+};
+
+namespace pyramid_detail
+{
+	// Биты x на четных местах, y - на нечетных
+	inline std::uint64_t spread(std::uint32_t v)
+	{
+		std::uint64_t x = v;
+		x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+		x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+		x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+		x = (x | (x << 2)) & 0x3333333333333333ull;
+		x = (x | (x << 1)) & 0x5555555555555555ull;
+		return x;
+	}
+
+	inline std::uint32_t compact(std::uint64_t x)
+	{
+		x &= 0x5555555555555555ull;
+		x = (x | (x >> 1)) & 0x3333333333333333ull;
+		x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+		x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+		x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+		x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+		return static_cast<std::uint32_t>(x);
+	}
+
+	inline std::uint64_t morton(int x, int y)
+	{
+		return spread(static_cast<std::uint32_t>(x)) | (spread(static_cast<std::uint32_t>(y)) << 1);
+	}
+}
+
+class PointPyramid
+{
+private:
+	struct Level
+	{
+		std::vector<std::uint64_t> keys;
+		std::vector<std::uint32_t> counts;
+		std::vector<Point2d> points;
+		// дети клетки i на уровне ниже - [firstChild[i], firstChild[i + 1])
+		std::vector<std::uint32_t> firstChild;
+	};
+
+	int width;
+	int height;
+	std::size_t total;
+	std::vector<Level> levels;
+
+	bool intersects(int level, std::uint32_t index, const PyramidView& view) const
+	{
+		const std::uint64_t key = levels[level].keys[index];
+		const double size = static_cast<double>(1ull << level);
+		const double x = pyramid_detail::compact(key) * size;
+		const double y = pyramid_detail::compact(key >> 1) * size;
+		return x <= view.maxX && y <= view.maxY && x + size > view.minX && y + size > view.minY;
+	}
+
+	PyramidCell cell(int level, std::uint32_t index) const
+	{
+		return { level, index, levels[level].counts[index], levels[level].points[index] };
+	}
+
+public:
+	PointPyramid(const std::vector<Point2d>& points, int width = screenWidth, int height = screenHeight, unsigned workers = workerCount())
+		: width(width), height(height), total(points.size())
+	{
+		TRACE_SCOPE("PointPyramid::build", "geometry");
+		if (width <= 0 || height <= 0)
+		{
+			throw std::invalid_argument("Размеры окна должны быть положительными");
+		}
+		if (points.size() > std::numeric_limits<std::uint32_t>::max())
+		{
+			throw std::length_error("Слишком много точек для пирамиды");
+		}
+
+		// один параллельный проход: коды Мортона и сортировка своего куска, затем попарные слияния кусков
+		std::vector<std::pair<std::uint64_t, std::uint32_t>> order(points.size());
+		workers = std::max(1u, std::min<unsigned>(workers, static_cast<unsigned>(std::max<std::size_t>(points.size() / 4096, 1))));
+		std::vector<std::size_t> bounds(workers + 1);
+		for (unsigned w = 0; w <= workers; w++)
+		{
+			bounds[w] = chunkBegin(points.size(), workers, w);
+		}
+		std::atomic<bool> outside{ false };
+		parallelFor(workers, [&](unsigned, std::size_t begin, std::size_t end)
+		{
+			for (std::size_t w = begin; w < end; w++)
+			{
+				for (std::size_t i = bounds[w]; i < bounds[w + 1]; i++)
+				{
+					const Point2d& p = points[i];
+					if (p.getX() >= width || p.getY() >= height)
+					{
+						outside = true;
+					}
+					order[i] = { pyramid_detail::morton(p.getX(), p.getY()), static_cast<std::uint32_t>(i) };
+				}
+				std::sort(order.begin() + bounds[w], order.begin() + bounds[w + 1]);
+			}
+		}, workers);
+		if (outside)
+		{
+			throw std::invalid_argument("Точки должны быть внутри окна пирамиды");
+		}
+		for (std::size_t step = 1; step < workers; step *= 2)
+		{
+			const std::size_t pairs = (workers + 2 * step - 1) / (2 * step);
+			parallelFor(pairs, [&](unsigned, std::size_t begin, std::size_t end)
+			{
+				for (std::size_t pair = begin; pair < end; pair++)
+				{
+					const std::size_t first = pair * 2 * step;
+					const std::size_t middle = std::min<std::size_t>(first + step, workers);
+					const std::size_t last = std::min<std::size_t>(first + 2 * step, workers);
+					std::inplace_merge(order.begin() + bounds[first], order.begin() + bounds[middle], order.begin() + bounds[last]);
+				}
+			}, static_cast<unsigned>(pairs));
+		}
+
+		// нулевой уровень: точки одного пикселя совпадают, представитель любой из них
+		Level base;
+		for (std::size_t i = 0; i < order.size(); i++)
+		{
+			if (i == 0 || order[i].first != order[i - 1].first)
+			{
+				base.keys.push_back(order[i].first);
+				base.counts.push_back(0);
+				base.points.push_back(points[order[i].second]);
+			}
+			base.counts.back()++;
+		}
+		levels.push_back(std::move(base));
+
+		// уровень выше: клетки с общим префиксом кода сливаются, представитель берется у самого населенного ребенка
+		const int top = static_cast<int>(std::ceil(std::log2(std::max(width, height))));
+		for (int level = 1; level <= top; level++)
+		{
+			const Level& below = levels.back();
+			Level above;
+			std::size_t heaviest = 0;
+			for (std::size_t i = 0; i < below.keys.size(); i++)
+			{
+				const std::uint64_t key = below.keys[i] >> 2;
+				if (i == 0 || key != above.keys.back())
+				{
+					above.keys.push_back(key);
+					above.counts.push_back(0);
+					above.points.push_back(below.points[i]);
+					above.firstChild.push_back(static_cast<std::uint32_t>(i));
+					heaviest = i;
+				}
+				else if (below.counts[i] > below.counts[heaviest])
+				{
+					above.points.back() = below.points[i];
+					heaviest = i;
+				}
+				above.counts.back() += below.counts[i];
+			}
+			above.firstChild.push_back(static_cast<std::uint32_t>(below.keys.size()));
+			levels.push_back(std::move(above));
+		}
+	}
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	int levelCount() const { return static_cast<int>(levels.size()); }
+	std::size_t cellCount(int level) const { return levels.at(level).keys.size(); }
+	std::size_t size() const { return total; }
+
+	// Точка клетки уровня level отстоит от представителя не больше чем на (2^level - 1) * sqrt(2) единиц окна.
+	// Возвращает самый грубый уровень, у которого это отклонение на экране не больше maxPixelError пикселей
+	int levelFor(double worldPerPixel, double maxPixelError) const
+	{
+		if (!(worldPerPixel > 0) || maxPixelError < 0)
+		{
+			throw std::invalid_argument("Размер пикселя должен быть положительным, допуск - неотрицательным");
+		}
+		int level = 0;
+		while (level + 1 < levelCount() && ((1ull << (level + 1)) - 1) * std::sqrt(2.0) <= maxPixelError * worldPerPixel)
+		{
+			level++;
+		}
+		return level;
+	}
+
+	// Клетки самого грубого уровня, попавшие в вид - начало постепенного уточнения
+	std::vector<PyramidCell> coarsest(const PyramidView& view) const
+	{
+		std::vector<PyramidCell> cells;
+		const int top = levelCount() - 1;
+		for (std::uint32_t i = 0; i < cellCount(top); i++)
+		{
+			if (intersects(top, i, view))
+			{
+				cells.push_back(cell(top, i));
+			}
+		}
+		return cells;
+	}
+
+	// Один шаг уточнения: клетки грубее нужного для вида уровня заменяются детьми, попавшими в вид,
+	// клетки вне вида выбрасываются. false, если уточнять уже нечего. При приближении вида можно
+	// продолжать уточнять прежний список; при отдалении его нужно начинать заново с coarsest
+	bool refine(std::vector<PyramidCell>& cells, const PyramidView& view, double maxPixelError) const
+	{
+		const int target = levelFor(view.worldPerPixel, maxPixelError);
+		bool changed = false;
+		std::vector<PyramidCell> next;
+		next.reserve(cells.size());
+		for (const PyramidCell& c : cells)
+		{
+			if (!intersects(c.level, c.index, view))
+			{
+				changed = true;
+				continue;
+			}
+			if (c.level <= target)
+			{
+				next.push_back(c);
+				continue;
+			}
+			changed = true;
+			const Level& level = levels[c.level];
+			for (std::uint32_t child = level.firstChild[c.index]; child < level.firstChild[c.index + 1]; child++)
+			{
+				if (intersects(c.level - 1, child, view))
+				{
+					next.push_back(cell(c.level - 1, child));
+				}
+			}
+		}
+		cells.swap(next);
+		return changed;
+	}
+
+	// Клетки самого грубого уровня, укладывающегося в допуск, внутри вида
+	std::vector<PyramidCell> query(const PyramidView& view, double maxPixelError) const
+	{
+		std::vector<PyramidCell> cells = coarsest(view);
+		while (refine(cells, view, maxPixelError))
+		{
+		}
+		return cells;
+	}
+};
@@ -0,0 +1,448 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "geometry.h"
+#include "parallel.h"
+#include "trace.h"
+
+// Заливка многоугольников построчной разверткой с таблицей активных ребер.
+// Пиксель (x, y) - квадрат [x, x + 1) x [y, y + 1), начало координат, как у Point2d, в левом нижнем углу.
+
+enum class FillRule
+{
+	EvenOdd,
+	NonZero
+};
+
+// Интервал [x0, x1] строки y с одинаковым покрытием (255 - пиксель закрыт целиком)
+struct FillSpan
+{
+	int y;
+	int x0;
+	int x1;
+	std::uint8_t coverage;
+};
+
+// Многоугольник из одного или нескольких контуров; дыры задаются контурами внутри
+struct FilledPolygon
+{
+	std::vector<std::vector<Point2d>> contours;
+	FillRule rule = FillRule::NonZero;
+	std::uint8_t ink = 255;
+};
+
+// Полутоновая картинка: значение пикселя 0..255
+class CoverageImage
+{
+private:
+	int width;
+	int height;
+	std::vector<std::uint8_t> values;
+
+public:
+	CoverageImage(int width = screenWidth, int height = screenHeight) : width(width), height(height)
+	{
+		if (width < 0 || height < 0)
+		{
+			throw std::invalid_argument("Размеры картинки не могут быть отрицательными");
+		}
+		values.assign(static_cast<std::size_t>(width) * height, 0);
+	}
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	std::uint8_t get(int x, int y) const
+	{
+		return x >= 0 && y >= 0 && x < width && y < height ? values[static_cast<std::size_t>(y) * width + x] : 0;
+	}
+
+	void clear()
+	{
+		std::fill(values.begin(), values.end(), 0);
+	}
+
+	// Смешивает ink с текущими значениями пропорционально покрытию. Полностью закрытый интервал -
+	// это std::fill по непрерывной памяти, который компилятор разворачивает в векторные записи
+	void fillSpan(const FillSpan& span, std::uint8_t ink = 255)
+	{
+		if (span.y < 0 || span.y >= height)
+		{
+			return;
+		}
+		const int x0 = std::max(span.x0, 0);
+		const int x1 = std::min(span.x1, width - 1);
+		if (x0 > x1)
+		{
+			return;
+		}
+		std::uint8_t* row = values.data() + static_cast<std::size_t>(span.y) * width;
+		if (span.coverage == 255)
+		{
+			std::fill(row + x0, row + x1 + 1, ink);
+			return;
+		}
+		const int alpha = span.coverage;
+		for (int x = x0; x <= x1; x++)
+		{
+			row[x] = static_cast<std::uint8_t>(row[x] + ((ink - row[x]) * alpha + 127) / 255);
+		}
+	}
+
+	// Верхняя строка первой; ramp - символы от пустого к полному
+	std::string toString(const std::string& ramp = " .:-=+*#%@") const
+	{
+		std::string text;
+		for (int y = height - 1; y >= 0; y--)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				text += ramp[get(x, y) * (ramp.size() - 1) / 255];
+			}
+			text += '\n';
+		}
+		return text;
+	}
+};
+
+// Таблица ребер многоугольника: ребра без горизонтальных, отсортированные по нижнему концу.
+// Строится один раз и используется всеми плитками, в которые попал многоугольник
+class EdgeTable
+{
+public:
+	struct Edge
+	{
+		double yLow;
+		double yHigh;
+		double xAtLow;
+		double slope;   // dx / dy
+		int winding;    // +1 ребро идет вверх, -1 вниз
+	};
+
+private:
+	std::vector<Edge> edges;
+	FillRule rule = FillRule::NonZero;
+	int minX = 0;
+	int minY = 0;
+	int maxX = -1;
+	int maxY = -1;
+
+public:
+	EdgeTable() {}
+
+	explicit EdgeTable(const FilledPolygon& polygon) : rule(polygon.rule)
+	{
+		bool first = true;
+		for (const std::vector<Point2d>& contour : polygon.contours)
+		{
+			for (std::size_t i = 0; i < contour.size(); i++)
+			{
+				const Point2d& a = contour[i];
+				const Point2d& b = contour[(i + 1) % contour.size()];
+				if (first)
+				{
+					minX = maxX = a.getX();
+					minY = maxY = a.getY();
+					first = false;
+				}
+				minX = std::min(minX, a.getX());
+				maxX = std::max(maxX, a.getX());
+				minY = std::min(minY, a.getY());
+				maxY = std::max(maxY, a.getY());
+				if (a.getY() == b.getY())
+				{
+					continue;
+				}
+				const Point2d& low = a.getY() < b.getY() ? a : b;
+				const Point2d& high = a.getY() < b.getY() ? b : a;
+				edges.push_back({ static_cast<double>(low.getY()), static_cast<double>(high.getY()), static_cast<double>(low.getX()),
+					static_cast<double>(high.getX() - low.getX()) / (high.getY() - low.getY()), a.getY() < b.getY() ? 1 : -1 });
+			}
+		}
+		std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) { return a.yLow < b.yLow; });
+	}
+
+	const std::vector<Edge>& getEdges() const { return edges; }
+	FillRule getRule() const { return rule; }
+	bool empty() const { return edges.empty(); }
+
+	// Охватывающий прямоугольник в пикселях: [minX, maxX) x [minY, maxY)
+	int getMinX() const { return minX; }
+	int getMinY() const { return minY; }
+	int getMaxX() const { return maxX; }
+	int getMaxY() const { return maxY; }
+};
+
+// Развертка с рабочими буферами; один экземпляр на поток.
+// samples - число подстрок на пиксель: 1 - без сглаживания (пиксель закрашен, если закрыт его центр),
+// больше 1 - покрытие по разреженным подстрокам: по вертикали samples выборок, по горизонтали точная доля
+class ScanlineRasterizer
+{
+private:
+	struct Active
+	{
+		int edge;
+		double x;
+	};
+
+	int samples;
+	std::vector<Active> active;
+	std::vector<std::pair<double, double>> intervals;
+	std::vector<float> area;
+	std::vector<float> cover;
+
+public:
+	explicit ScanlineRasterizer(int samples = 1) : samples(samples)
+	{
+		if (samples < 1)
+		{
+			throw std::invalid_argument("Число подстрок должно быть положительным");
+		}
+	}
+
+	int getSamples() const { return samples; }
+
+	// Интервалы многоугольника в прямоугольнике [clipX0, clipX1] x [clipY0, clipY1] построчно снизу вверх;
+	// sink(const FillSpan&) получает их по одному
+	template <class Sink>
+	void rasterize(const EdgeTable& table, int clipX0, int clipY0, int clipX1, int clipY1, Sink sink)
+	{
+		const int rowFrom = std::max(clipY0, table.getMinY());
+		const int rowTo = std::min(clipY1, table.getMaxY() - 1);
+		const int columnFrom = std::max(clipX0, table.getMinX());
+		const int columnTo = std::min(clipX1, table.getMaxX() - 1);
+		if (table.empty() || rowFrom > rowTo || columnFrom > columnTo)
+		{
+			return;
+		}
+
+		const std::vector<EdgeTable::Edge>& edges = table.getEdges();
+		std::size_t next = 0;
+		active.clear();
+		if (samples > 1)
+		{
+			area.assign(columnTo - columnFrom + 2, 0.0f);
+			cover.assign(columnTo - columnFrom + 2, 0.0f);
+		}
+
+		for (int y = rowFrom; y <= rowTo; y++)
+		{
+			for (int s = 0; s < samples; s++)
+			{
+				const double sy = y + (s + 0.5) / samples;
+				scan(table, edges, next, sy);
+				for (const auto& interval : intervals)
+				{
+					const double from = std::max(interval.first, static_cast<double>(columnFrom));
+					const double to = std::min(interval.second, static_cast<double>(columnTo + 1));
+					if (samples == 1)
+					{
+						// пиксели, центры которых попали в [from, to)
+						const int x0 = static_cast<int>(std::ceil(from - 0.5));
+						const int x1 = static_cast<int>(std::ceil(to - 0.5)) - 1;
+						if (x0 <= x1)
+						{
+							sink(FillSpan{ y, x0, x1, 255 });
+						}
+					}
+					else if (from < to)
+					{
+						accumulate(from - columnFrom, to - columnFrom, 1.0f / samples);
+					}
+				}
+			}
+			if (samples > 1)
+			{
+				emitRow(y, columnFrom, sink);
+			}
+		}
+	}
+
+private:
+	// Обновляет активные ребра для подстроки sy и собирает закрашиваемые интервалы
+	void scan(const EdgeTable& table, const std::vector<EdgeTable::Edge>& edges, std::size_t& next, double sy)
+	{
+		while (next < edges.size() && edges[next].yLow <= sy)
+		{
+			active.push_back({ static_cast<int>(next), 0.0 });
+			next++;
+		}
+		std::size_t kept = 0;
+		for (const Active& item : active)
+		{
+			const EdgeTable::Edge& edge = edges[item.edge];
+			if (edge.yHigh > sy)
+			{
+				active[kept++] = { item.edge, edge.xAtLow + (sy - edge.yLow) * edge.slope };
+			}
+		}
+		active.resize(kept);
+
+		// порядок ребер от подстроки к подстроке почти не меняется, поэтому сортировка вставками
+		for (std::size_t i = 1; i < active.size(); i++)
+		{
+			const Active item = active[i];
+			std::size_t j = i;
+			while (j > 0 && active[j - 1].x > item.x)
+			{
+				active[j] = active[j - 1];
+				j--;
+			}
+			active[j] = item;
+		}
+
+		intervals.clear();
+		int winding = 0;
+		for (std::size_t i = 0; i + 1 < active.size(); i++)
+		{
+			if (table.getRule() == FillRule::EvenOdd)
+			{
+				winding ^= 1;
+			}
+			else
+			{
+				winding += edges[active[i].edge].winding;
+			}
+			if (winding != 0 && active[i].x < active[i + 1].x)
+			{
+				if (!intervals.empty() && intervals.back().second == active[i].x)
+				{
+					intervals.back().second = active[i + 1].x;
+				}
+				else
+				{
+					intervals.push_back({ active[i].x, active[i + 1].x });
+				}
+			}
+		}
+	}
+
+	// Добавляет weight * длину пересечения [from, to) с каждым пикселем: крайние пиксели - в area,
+	// внутренние - разностью в cover, поэтому длинный интервал стоит O(1)
+	void accumulate(double from, double to, float weight)
+	{
+		const int first = static_cast<int>(from);
+		const int last = static_cast<int>(to);
+		if (first == last)
+		{
+			area[first] += static_cast<float>(to - from) * weight;
+			return;
+		}
+		area[first] += static_cast<float>(first + 1 - from) * weight;
+		cover[first + 1] += weight;
+		cover[last] -= weight;
+		area[last] += static_cast<float>(to - last) * weight;
+	}
+
+	// Сворачивает накопленное покрытие строки в интервалы с одинаковым значением и обнуляет буферы
+	template <class Sink>
+	void emitRow(int y, int columnFrom, Sink& sink)
+	{
+		const int count = static_cast<int>(area.size()) - 1;
+		float running = 0;
+		int runStart = 0;
+		std::uint8_t runValue = 0;
+		for (int x = 0; x <= count; x++)
+		{
+			std::uint8_t value = 0;
+			if (x < count)
+			{
+				running += cover[x];
+				const float coverage = std::min(std::max(running + area[x], 0.0f), 1.0f);
+				value = static_cast<std::uint8_t>(coverage * 255 + 0.5f);
+				cover[x] = 0;
+				area[x] = 0;
+			}
+			if (value != runValue || x == count)
+			{
+				if (runValue != 0)
+				{
+					sink(FillSpan{ y, columnFrom + runStart, columnFrom + x - 1, runValue });
+				}
+				runStart = x;
+				runValue = value;
+			}
+		}
+		cover[count] = 0;
+		area[count] = 0;
+	}
+};
+
+// Заливает один многоугольник
+inline void fillPolygon(CoverageImage& image, const FilledPolygon& polygon, int samples = 1)
+{
+	ScanlineRasterizer rasterizer(samples);
+	rasterizer.rasterize(EdgeTable(polygon), 0, 0, image.getWidth() - 1, image.getHeight() - 1,
+		[&image, &polygon](const FillSpan& span) { image.fillSpan(span, polygon.ink); });
+}
+
+// Заливает многоугольники по порядку (следующий поверх предыдущего). Картинка делится на плитки
+// tileSize x tileSize, каждая плитка целиком у одного потока, поэтому записи не пересекаются,
+// а порядок наложения в каждом пикселе тот же, что при последовательной заливке
+inline void fillPolygons(CoverageImage& image, const std::vector<FilledPolygon>& polygons, int samples = 1, int tileSize = 64, unsigned workers = workerCount())
+{
+	TRACE_SCOPE("fillPolygons", "raster");
+	if (tileSize <= 0)
+	{
+		throw std::invalid_argument("Размер плитки должен быть положительным");
+	}
+
+	std::vector<EdgeTable> tables(polygons.size());
+	parallelFor(polygons.size(), [&tables, &polygons](unsigned, std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; i++)
+		{
+			tables[i] = EdgeTable(polygons[i]);
+		}
+	}, workers);
+
+	// многоугольники по плиткам в исходном порядке
+	const int columns = (image.getWidth() + tileSize - 1) / tileSize;
+	const int rows = (image.getHeight() + tileSize - 1) / tileSize;
+	std::vector<std::vector<std::uint32_t>> bins(static_cast<std::size_t>(columns) * rows);
+	for (std::size_t i = 0; i < tables.size(); i++)
+	{
+		const EdgeTable& table = tables[i];
+		if (table.empty() || table.getMaxX() <= 0 || table.getMaxY() <= 0)
+		{
+			continue;
+		}
+		const int tx0 = std::max(table.getMinX(), 0) / tileSize;
+		const int ty0 = std::max(table.getMinY(), 0) / tileSize;
+		const int tx1 = std::min((table.getMaxX() - 1) / tileSize, columns - 1);
+		const int ty1 = std::min((table.getMaxY() - 1) / tileSize, rows - 1);
+		for (int ty = ty0; ty <= ty1; ty++)
+		{
+			for (int tx = tx0; tx <= tx1; tx++)
+			{
+				bins[static_cast<std::size_t>(ty) * columns + tx].push_back(static_cast<std::uint32_t>(i));
+			}
+		}
+	}
+
+	// плитки разбираются по одной: в плотных местах их заливка дороже, чем по краям
+	std::atomic<std::size_t> nextTile(0);
+	parallelFor(workers, [&](unsigned, std::size_t, std::size_t)
+	{
+		ScanlineRasterizer rasterizer(samples);
+		for (std::size_t tile = nextTile++; tile < bins.size(); tile = nextTile++)
+		{
+			const int x0 = static_cast<int>(tile % columns) * tileSize;
+			const int y0 = static_cast<int>(tile / columns) * tileSize;
+			const int x1 = std::min(x0 + tileSize, image.getWidth()) - 1;
+			const int y1 = std::min(y0 + tileSize, image.getHeight()) - 1;
+			for (std::uint32_t i : bins[tile])
+			{
+				const std::uint8_t ink = polygons[i].ink;
+				rasterizer.rasterize(tables[i], x0, y0, x1, y1, [&image, ink](const FillSpan& span) { image.fillSpan(span, ink); });
+			}
+		}
+	}, workers);
+}
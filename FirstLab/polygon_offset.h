@@ -0,0 +1,543 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "geometry.h"
+#include "parallel.h"
+#include "trace.h"
+
+// Смещение многоугольника на delta (delta > 0 - раздуть, delta < 0 - сжать) со стыками
+// острым углом, скруглением или срезом. Контур считается ограничивающим область слева
+// (внешний против часовой стрелки, дыры по часовой). Сырой смещенный контур округляется до целых
+// и может сам себя пересекать; очистка оставляет из него область с положительным числом обхода,
+// обрезанную по окну, поэтому результат - снова целые Point2d. Округление вершин результата
+// может сдвинуть соседние ребра на долю пикселя так, что они коснутся или чуть пересекутся.
+
+enum class JoinType
+{
+	Miter,
+	Round,
+	Square
+};
+
+namespace offset_detail
+{
+	// Целая точка без проверки на окно: сырой контур может выходить за его пределы
+	struct IntPoint
+	{
+		long long x;
+		long long y;
+
+		bool operator==(const IntPoint& other) const { return x == other.x && y == other.y; }
+		bool operator<(const IntPoint& other) const { return x != other.x ? x < other.x : y < other.y; }
+	};
+
+	inline long long cross(const IntPoint& a, const IntPoint& b, const IntPoint& c)
+	{
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	inline void pushRounded(std::vector<IntPoint>& out, double x, double y)
+	{
+		const IntPoint p = { std::llround(x), std::llround(y) };
+		if (out.empty() || !(out.back() == p))
+		{
+			out.push_back(p);
+		}
+	}
+
+	// Сырое смещение одного контура
+	inline std::vector<IntPoint> offsetContour(const std::vector<Point2d>& input, double delta, JoinType join, double miterLimit, double arcTolerance)
+	{
+		std::vector<Point2d> contour;
+		for (const Point2d& p : input)
+		{
+			if (contour.empty() || contour.back().getX() != p.getX() || contour.back().getY() != p.getY())
+			{
+				contour.push_back(p);
+			}
+		}
+		while (contour.size() > 1 && contour.front().getX() == contour.back().getX() && contour.front().getY() == contour.back().getY())
+		{
+			contour.pop_back();
+		}
+
+		std::vector<IntPoint> out;
+		const std::size_t n = contour.size();
+		if (n < 2)
+		{
+			return out;
+		}
+
+		// единичные направления ребер и внешние нормали (справа от направления)
+		std::vector<double> dx(n), dy(n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			const Point2d& a = contour[i];
+			const Point2d& b = contour[(i + 1) % n];
+			const double length = std::hypot(b.getX() - a.getX(), b.getY() - a.getY());
+			dx[i] = (b.getX() - a.getX()) / length;
+			dy[i] = (b.getY() - a.getY()) / length;
+		}
+
+		const double radius = std::abs(delta);
+		const double stepAngle = 2 * std::acos(std::max(-1.0, 1 - std::min(arcTolerance, radius) / std::max(radius, 1e-9)));
+		for (std::size_t i = 0; i < n; i++)
+		{
+			const std::size_t prev = (i + n - 1) % n;
+			const double px = contour[i].getX();
+			const double py = contour[i].getY();
+			const double n1x = dy[prev], n1y = -dx[prev];
+			const double n2x = dy[i], n2y = -dx[i];
+			const double sinA = n1x * n2y - n1y * n2x;
+			const double cosA = n1x * n2x + n1y * n2y;
+
+			if (sinA * delta < 0 || (std::abs(sinA) < 1e-12 && cosA > 0))
+			{
+				// вогнутый для смещения угол или прямая: лишнее срежет очистка
+				pushRounded(out, px + n1x * delta, py + n1y * delta);
+				if (std::abs(sinA) >= 1e-12)
+				{
+					pushRounded(out, px, py);
+				}
+				pushRounded(out, px + n2x * delta, py + n2y * delta);
+				continue;
+			}
+
+			JoinType kind = join;
+			if (kind == JoinType::Miter && 1 + cosA < 2 / (miterLimit * miterLimit))
+			{
+				kind = JoinType::Square;
+			}
+
+			if (kind == JoinType::Miter)
+			{
+				const double scale = delta / (1 + cosA);
+				pushRounded(out, px + (n1x + n2x) * scale, py + (n1y + n2y) * scale);
+			}
+			else if (kind == JoinType::Square)
+			{
+				// срез перпендикулярно биссектрисе на расстоянии |delta| от вершины; m1, m2 - нормали в сторону смещения
+				const double sign = delta < 0 ? -1 : 1;
+				const double m1x = n1x * sign, m1y = n1y * sign;
+				const double m2x = n2x * sign, m2y = n2y * sign;
+				double bx = m1x + m2x, by = m1y + m2y;
+				const double length = std::hypot(bx, by);
+				if (length < 1e-12)
+				{
+					// разворот на месте: срез продолжает входящее ребро
+					bx = dx[prev];
+					by = dy[prev];
+				}
+				else
+				{
+					bx /= length;
+					by /= length;
+				}
+				const double along = radius * (1 - (m1x * bx + m1y * by)) / std::max(dx[prev] * bx + dy[prev] * by, 1e-12);
+				pushRounded(out, px + m1x * radius + dx[prev] * along, py + m1y * radius + dy[prev] * along);
+				pushRounded(out, px + m2x * radius - dx[i] * along, py + m2y * radius - dy[i] * along);
+			}
+			else
+			{
+				// дуга от нормали n1 к нормали n2; при развороте на месте знак sinA (даже -0.0) случаен,
+				// поэтому дуга явно идет на пол-оборота наружу, как срез в ветке Square
+				const double pi = std::acos(-1.0);
+				const double angle = std::abs(sinA) < 1e-12 && cosA < 0 ? (delta > 0 ? pi : -pi) : std::atan2(sinA, cosA);
+				const int steps = std::max(1, static_cast<int>(std::ceil(std::abs(angle) / std::max(stepAngle, 1e-3))));
+				for (int k = 0; k <= steps; k++)
+				{
+					const double a = angle * k / steps;
+					const double rx = n1x * std::cos(a) - n1y * std::sin(a);
+					const double ry = n1x * std::sin(a) + n1y * std::cos(a);
+					pushRounded(out, px + rx * delta, py + ry * delta);
+				}
+			}
+		}
+		while (out.size() > 1 && out.front() == out.back())
+		{
+			out.pop_back();
+		}
+		return out;
+	}
+
+	struct Edge
+	{
+		IntPoint a;
+		IntPoint b;
+	};
+
+	// Число обхода сырых контуров вокруг точки. Ребра разложены по полосам единичной высоты:
+	// горизонтальный луч из точки пересекают только ребра ее полосы, остальные не просматриваются
+	class WindingIndex
+	{
+	private:
+		const std::vector<Edge>& edges;
+		long long top = 0;
+		std::vector<std::vector<std::size_t>> rows;
+
+	public:
+		explicit WindingIndex(const std::vector<Edge>& edges) : edges(edges)
+		{
+			long long bottom = 0;
+			bool first = true;
+			for (const Edge& e : edges)
+			{
+				if (first)
+				{
+					top = std::min(e.a.y, e.b.y);
+					bottom = std::max(e.a.y, e.b.y);
+					first = false;
+				}
+				top = std::min({ top, e.a.y, e.b.y });
+				bottom = std::max({ bottom, e.a.y, e.b.y });
+			}
+			rows.resize(static_cast<std::size_t>(bottom - top));
+			for (std::size_t i = 0; i < edges.size(); i++)
+			{
+				// концы целые, поэтому ребро пересекает прямые y из [min, max) - полосы min .. max - 1
+				for (long long row = std::min(edges[i].a.y, edges[i].b.y); row < std::max(edges[i].a.y, edges[i].b.y); row++)
+				{
+					rows[static_cast<std::size_t>(row - top)].push_back(i);
+				}
+			}
+		}
+
+		int winding(double x, double y) const
+		{
+			const double band = std::floor(y) - static_cast<double>(top);
+			if (band < 0 || band >= static_cast<double>(rows.size()))
+			{
+				return 0;
+			}
+			int result = 0;
+			for (std::size_t index : rows[static_cast<std::size_t>(band)])
+			{
+				const Edge& e = edges[index];
+				const double ay = static_cast<double>(e.a.y), by = static_cast<double>(e.b.y);
+				if ((ay <= y) != (by <= y))
+				{
+					const double side = (e.b.x - e.a.x) * (y - ay) - (by - ay) * (x - e.a.x);
+					if (by > ay && side > 0)
+					{
+						result++;
+					}
+					else if (by < ay && side < 0)
+					{
+						result--;
+					}
+				}
+			}
+			return result;
+		}
+	};
+
+	// Оставляет границу области {число обхода > 0} внутри окна [0, width - 1] x [0, height - 1].
+	// Все ребра режутся в точках взаимных пересечений; кусок остается, если с одной его стороны область,
+	// а с другой нет. Решение принимается по точной геометрии, округляются только вершины результата
+	inline std::vector<std::vector<Point2d>> cleanup(const std::vector<std::vector<IntPoint>>& contours, int width, int height)
+	{
+		std::vector<Edge> raw;
+		for (const std::vector<IntPoint>& contour : contours)
+		{
+			for (std::size_t i = 0; i < contour.size(); i++)
+			{
+				if (!(contour[i] == contour[(i + 1) % contour.size()]))
+				{
+					raw.push_back({ contour[i], contour[(i + 1) % contour.size()] });
+				}
+			}
+		}
+		std::vector<Edge> edges = raw;
+		const IntPoint corners[4] = { { 0, 0 }, { width - 1, 0 }, { width - 1, height - 1 }, { 0, height - 1 } };
+		for (int i = 0; i < 4; i++)
+		{
+			edges.push_back({ corners[i], corners[(i + 1) % 4] });
+		}
+
+		// точки разреза: параметр вдоль ребра и точные координаты
+		struct Cut
+		{
+			double t;
+			double x;
+			double y;
+		};
+		std::vector<std::vector<Cut>> cuts(edges.size());
+		for (std::size_t e = 0; e < edges.size(); e++)
+		{
+			cuts[e].push_back({ 0, static_cast<double>(edges[e].a.x), static_cast<double>(edges[e].a.y) });
+			cuts[e].push_back({ 1, static_cast<double>(edges[e].b.x), static_cast<double>(edges[e].b.y) });
+		}
+
+		// пары ищутся только среди ребер, перекрывающихся по x
+		std::vector<std::size_t> byX(edges.size());
+		for (std::size_t i = 0; i < byX.size(); i++)
+		{
+			byX[i] = i;
+		}
+		auto minX = [&edges](std::size_t e) { return std::min(edges[e].a.x, edges[e].b.x); };
+		auto maxX = [&edges](std::size_t e) { return std::max(edges[e].a.x, edges[e].b.x); };
+		std::sort(byX.begin(), byX.end(), [&minX](std::size_t a, std::size_t b) { return minX(a) < minX(b); });
+		for (std::size_t i = 0; i < byX.size(); i++)
+		{
+			const Edge& e = edges[byX[i]];
+			const long long ex = e.b.x - e.a.x, ey = e.b.y - e.a.y;
+			for (std::size_t j = i + 1; j < byX.size() && minX(byX[j]) <= maxX(byX[i]); j++)
+			{
+				const Edge& f = edges[byX[j]];
+				if (std::max(e.a.y, e.b.y) < std::min(f.a.y, f.b.y) || std::max(f.a.y, f.b.y) < std::min(e.a.y, e.b.y))
+				{
+					continue;
+				}
+				const long long fx = f.b.x - f.a.x, fy = f.b.y - f.a.y;
+				const long long gx = f.a.x - e.a.x, gy = f.a.y - e.a.y;
+				const long long denominator = ex * fy - ey * fx;
+				if (denominator != 0)
+				{
+					long long tn = gx * fy - gy * fx;
+					long long un = gx * ey - gy * ex;
+					long long d = denominator;
+					if (d < 0)
+					{
+						tn = -tn;
+						un = -un;
+						d = -d;
+					}
+					if (tn >= 0 && tn <= d && un >= 0 && un <= d)
+					{
+						const double t = static_cast<double>(tn) / d;
+						const double u = static_cast<double>(un) / d;
+						const double x = e.a.x + ex * t;
+						const double y = e.a.y + ey * t;
+						cuts[byX[i]].push_back({ t, x, y });
+						cuts[byX[j]].push_back({ u, x, y });
+					}
+				}
+				else if (gx * ey - gy * ex == 0)
+				{
+					// на одной прямой: концы одного ребра режут другое
+					const double eLength = static_cast<double>(ex * ex + ey * ey);
+					const double fLength = static_cast<double>(fx * fx + fy * fy);
+					const IntPoint ends[4] = { f.a, f.b, e.a, e.b };
+					for (int k = 0; k < 4; k++)
+					{
+						const Edge& target = k < 2 ? e : f;
+						const double length = k < 2 ? eLength : fLength;
+						const double t = ((ends[k].x - target.a.x) * (target.b.x - target.a.x) + (ends[k].y - target.a.y) * (target.b.y - target.a.y)) / length;
+						if (t > 0 && t < 1)
+						{
+							cuts[k < 2 ? byX[i] : byX[j]].push_back({ t, static_cast<double>(ends[k].x), static_cast<double>(ends[k].y) });
+						}
+					}
+				}
+			}
+		}
+
+		// куски между соседними разрезами. Концы сводятся на мелкую сетку, чтобы одна точка пересечения,
+		// посчитанная для разных пар ребер, стала одной вершиной; совпавшие куски отбрасываются
+		const double snap = 1024;
+		struct Piece
+		{
+			IntPoint from;
+			IntPoint to;
+		};
+		struct Candidate
+		{
+			IntPoint low;
+			IntPoint high;
+			Cut from;
+			Cut to;
+		};
+		std::vector<Candidate> candidates;
+		for (std::size_t e = 0; e < edges.size(); e++)
+		{
+			std::vector<Cut>& list = cuts[e];
+			std::sort(list.begin(), list.end(), [](const Cut& a, const Cut& b) { return a.t < b.t; });
+			for (std::size_t k = 0; k + 1 < list.size(); k++)
+			{
+				const IntPoint from = { std::llround(list[k].x * snap), std::llround(list[k].y * snap) };
+				const IntPoint to = { std::llround(list[k + 1].x * snap), std::llround(list[k + 1].y * snap) };
+				if (!(from == to))
+				{
+					candidates.push_back(from < to ? Candidate{ from, to, list[k], list[k + 1] } : Candidate{ to, from, list[k + 1], list[k] });
+				}
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+		{
+			return a.low == b.low ? a.high < b.high : a.low < b.low;
+		});
+		candidates.erase(std::unique(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+		{
+			return a.low == b.low && a.high == b.high;
+		}), candidates.end());
+
+		// кусок остается, если с одной его стороны область, а с другой нет; область слева от куска
+		std::vector<Piece> pieces;
+		const WindingIndex windings(raw);
+		auto inside = [&windings, width, height](double x, double y)
+		{
+			return x > 0 && y > 0 && x < width - 1 && y < height - 1 && windings.winding(x, y) > 0;
+		};
+		for (const Candidate& c : candidates)
+		{
+			const double length = std::hypot(c.to.x - c.from.x, c.to.y - c.from.y);
+			const double mx = (c.from.x + c.to.x) / 2;
+			const double my = (c.from.y + c.to.y) / 2;
+			const double eps = std::min(1e-3, length / 4);
+			const double nx = -(c.to.y - c.from.y) / length * eps;
+			const double ny = (c.to.x - c.from.x) / length * eps;
+			const bool left = inside(mx + nx, my + ny);
+			const bool right = inside(mx - nx, my - ny);
+			if (left && !right)
+			{
+				pieces.push_back({ c.low, c.high });
+			}
+			else if (right && !left)
+			{
+				pieces.push_back({ c.high, c.low });
+			}
+		}
+
+		// сборка контуров: на развилке берется самый левый поворот, чтобы петли оставались простыми
+		std::sort(pieces.begin(), pieces.end(), [](const Piece& a, const Piece& b) { return a.from < b.from; });
+		std::vector<bool> used(pieces.size(), false);
+		std::vector<std::vector<Point2d>> result;
+		for (std::size_t first = 0; first < pieces.size(); first++)
+		{
+			if (used[first])
+			{
+				continue;
+			}
+			std::vector<IntPoint> loop;
+			std::size_t current = first;
+			while (!used[current])
+			{
+				used[current] = true;
+				loop.push_back(pieces[current].from);
+				const Piece& piece = pieces[current];
+				const double inX = static_cast<double>(piece.to.x - piece.from.x);
+				const double inY = static_cast<double>(piece.to.y - piece.from.y);
+				double bestTurn = -10;
+				std::size_t best = current;
+				const auto [begin, end] = std::equal_range(pieces.begin(), pieces.end(), Piece{ piece.to, piece.to },
+					[](const Piece& a, const Piece& b) { return a.from < b.from; });
+				for (std::size_t candidate = static_cast<std::size_t>(begin - pieces.begin()); candidate < static_cast<std::size_t>(end - pieces.begin()); candidate++)
+				{
+					if (used[candidate] && candidate != first)
+					{
+						continue;
+					}
+					const double outX = static_cast<double>(pieces[candidate].to.x - pieces[candidate].from.x);
+					const double outY = static_cast<double>(pieces[candidate].to.y - pieces[candidate].from.y);
+					const double turn = std::atan2(inX * outY - inY * outX, inX * outX + inY * outY);
+					if (turn > bestTurn)
+					{
+						bestTurn = turn;
+						best = candidate;
+					}
+				}
+				if (best == first || best == current)
+				{
+					break;
+				}
+				current = best;
+			}
+
+			// округление до целых: повторы подряд и точки на прямой между соседями не нужны
+			std::vector<IntPoint> simple;
+			for (const IntPoint& p : loop)
+			{
+				const IntPoint rounded = { std::llround(p.x / snap), std::llround(p.y / snap) };
+				if (simple.empty() || !(simple.back() == rounded))
+				{
+					simple.push_back(rounded);
+				}
+			}
+			while (simple.size() > 1 && simple.front() == simple.back())
+			{
+				simple.pop_back();
+			}
+			for (std::size_t i = 0; simple.size() >= 3 && i < simple.size();)
+			{
+				const IntPoint& prev = simple[(i + simple.size() - 1) % simple.size()];
+				const IntPoint& next = simple[(i + 1) % simple.size()];
+				if (cross(prev, simple[i], next) == 0)
+				{
+					simple.erase(simple.begin() + i);
+					i = i > 0 ? i - 1 : 0;
+				}
+				else
+				{
+					i++;
+				}
+			}
+			if (simple.size() < 3)
+			{
+				continue;
+			}
+			std::vector<Point2d> polygon;
+			for (const IntPoint& p : simple)
+			{
+				polygon.push_back(Point2d(static_cast<int>(p.x), static_cast<int>(p.y), width, height));
+			}
+			result.push_back(std::move(polygon));
+		}
+		return result;
+	}
+}
+
+// Смещение многоугольника из одного или нескольких контуров. Если суммарная ориентированная площадь
+// отрицательна (внешний контур по часовой стрелке), все контуры разворачиваются.
+// miterLimit - наибольшее удаление острия в долях delta, дальше угол срезается;
+// arcTolerance - наибольшее отклонение хорды скругления от дуги в пикселях
+inline std::vector<std::vector<Point2d>> offsetPolygon(const std::vector<std::vector<Point2d>>& contours, double delta, JoinType join = JoinType::Miter,
+	double miterLimit = 2.0, double arcTolerance = 0.25, int width = screenWidth, int height = screenHeight)
+{
+	if (miterLimit < 1 || arcTolerance <= 0)
+	{
+		throw std::invalid_argument("Предел острия должен быть не меньше 1, допуск дуги - положительным");
+	}
+	long long area = 0;
+	for (const std::vector<Point2d>& contour : contours)
+	{
+		for (std::size_t i = 0; i < contour.size(); i++)
+		{
+			const Point2d& a = contour[i];
+			const Point2d& b = contour[(i + 1) % contour.size()];
+			area += static_cast<long long>(a.getX()) * b.getY() - static_cast<long long>(b.getX()) * a.getY();
+		}
+	}
+
+	std::vector<std::vector<offset_detail::IntPoint>> raw;
+	for (const std::vector<Point2d>& contour : contours)
+	{
+		std::vector<Point2d> oriented = contour;
+		if (area < 0)
+		{
+			std::reverse(oriented.begin(), oriented.end());
+		}
+		raw.push_back(offset_detail::offsetContour(oriented, delta, join, miterLimit, arcTolerance));
+	}
+	return offset_detail::cleanup(raw, width, height);
+}
+
+// Много многоугольников сразу: каждый смещается независимо, многоугольники делятся между потоками
+inline std::vector<std::vector<std::vector<Point2d>>> offsetPolygons(const std::vector<std::vector<std::vector<Point2d>>>& polygons, double delta,
+	JoinType join = JoinType::Miter, double miterLimit = 2.0, double arcTolerance = 0.25, unsigned workers = workerCount())
+{
+	TRACE_SCOPE("offsetPolygons", "geometry");
+	std::vector<std::vector<std::vector<Point2d>>> result(polygons.size());
+	parallelFor(polygons.size(), [&](unsigned, std::size_t begin, std::size_t end)
+	{
+		for (std::size_t i = begin; i < end; i++)
+		{
+			result[i] = offsetPolygon(polygons[i], delta, join, miterLimit, arcTolerance);
+		}
+	}, workers);
+	return result;
+}
@@ -0,0 +1,412 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+#include "parallel.h"
+#include "trace.h"
+
+// Сравнение ломаных дискретными расстояниями Фреше и Хаусдорфа. Обе функции принимают порог bound:
+// как только ясно, что расстояние больше порога, счет бросается и возвращается бесконечность.
+// Точки сравниваются как есть, без переноса и масштабирования.
+
+enum class PolylineMetric
+{
+	Frechet,
+	Hausdorff
+};
+
+struct PolylineMatch
+{
+	std::size_t index;
+	double distance;
+};
+
+// Счетчики одного поиска: сколько шаблонов отсечено оценкой снизу, сколько досчитано и сколько брошено на середине
+struct PolylineSearchStats
+{
+	std::size_t pruned = 0;
+	std::size_t evaluated = 0;
+	std::size_t abandoned = 0;
+};
+
+namespace match_detail
+{
+	// Ломаная в виде двух массивов координат
+	struct Polyline
+	{
+		const int* x;
+		const int* y;
+		std::size_t size;
+	};
+
+	// Рамка и концы ломаной для оценок снизу
+	struct Features
+	{
+		int minX;
+		int minY;
+		int maxX;
+		int maxY;
+		int firstX;
+		int firstY;
+		int lastX;
+		int lastY;
+	};
+
+	const long long unbounded = std::numeric_limits<long long>::max();
+
+	// Квадрат порога, целая часть: квадраты расстояний между целыми точками - целые
+	inline long long squaredLimit(double bound)
+	{
+		if (!(bound < std::sqrt(static_cast<double>(unbounded))))
+		{
+			return unbounded;
+		}
+		if (bound < 0)
+		{
+			return -1;
+		}
+		// квадрат округляется с ошибкой; граница сверяется с тем же корнем, что вернет toDistance
+		long long limit = static_cast<long long>(std::floor(bound * bound));
+		while (limit > 0 && std::sqrt(static_cast<double>(limit)) > bound)
+		{
+			limit--;
+		}
+		while (std::sqrt(static_cast<double>(limit + 1)) <= bound)
+		{
+			limit++;
+		}
+		return limit;
+	}
+
+	inline long long distance2(const Polyline& a, std::size_t i, const Polyline& b, std::size_t j)
+	{
+		const long long dx = static_cast<long long>(a.x[i]) - b.x[j];
+		const long long dy = static_cast<long long>(a.y[i]) - b.y[j];
+		return dx * dx + dy * dy;
+	}
+
+	inline Features features(const Polyline& p)
+	{
+		Features f{ p.x[0], p.y[0], p.x[0], p.y[0], p.x[0], p.y[0], p.x[p.size - 1], p.y[p.size - 1] };
+		for (std::size_t i = 1; i < p.size; i++)
+		{
+			f.minX = std::min(f.minX, p.x[i]);
+			f.minY = std::min(f.minY, p.y[i]);
+			f.maxX = std::max(f.maxX, p.x[i]);
+			f.maxY = std::max(f.maxY, p.y[i]);
+		}
+		return f;
+	}
+
+	// Хаусдорф не меньше сдвига любой стороны рамки: крайняя точка одной ломаной должна иметь соседку
+	// в другой не дальше расстояния. Фреше не меньше Хаусдорфа и к тому же сводит начала и концы
+	inline long long lowerBound2(const Features& a, const Features& b, PolylineMetric metric)
+	{
+		long long side = std::max({ std::abs(static_cast<long long>(a.minX) - b.minX), std::abs(static_cast<long long>(a.minY) - b.minY),
+			std::abs(static_cast<long long>(a.maxX) - b.maxX), std::abs(static_cast<long long>(a.maxY) - b.maxY) });
+		long long bound = side * side;
+		if (metric == PolylineMetric::Frechet)
+		{
+			const long long fx = static_cast<long long>(a.firstX) - b.firstX, fy = static_cast<long long>(a.firstY) - b.firstY;
+			const long long lx = static_cast<long long>(a.lastX) - b.lastX, ly = static_cast<long long>(a.lastY) - b.lastY;
+			bound = std::max({ bound, fx * fx + fy * fy, lx * lx + ly * ly });
+		}
+		return bound;
+	}
+
+	// Квадрат расстояния Фреше или unbounded, если оно больше limit. Считается по строкам с одной строкой памяти;
+	// каждая строка пересекается любым путем сопоставления, так что строка целиком выше limit дает отказ
+	inline long long frechet2(const Polyline& a, const Polyline& b, long long limit, std::vector<long long>& row)
+	{
+		row.assign(b.size, unbounded);
+		long long rowMin = unbounded;
+		for (std::size_t j = 0; j < b.size; j++)
+		{
+			const long long previous = j == 0 ? distance2(a, 0, b, 0) : row[j - 1];
+			row[j] = previous > limit ? unbounded : std::max(previous, distance2(a, 0, b, j));
+			rowMin = std::min(rowMin, row[j]);
+		}
+		if (rowMin > limit)
+		{
+			return unbounded;
+		}
+		for (std::size_t i = 1; i < a.size; i++)
+		{
+			long long diagonal = row[0];
+			row[0] = row[0] > limit ? unbounded : std::max(row[0], distance2(a, i, b, 0));
+			rowMin = row[0];
+			for (std::size_t j = 1; j < b.size; j++)
+			{
+				const long long reach = std::min({ diagonal, row[j], row[j - 1] });
+				diagonal = row[j];
+				row[j] = reach > limit ? unbounded : std::max(reach, distance2(a, i, b, j));
+				rowMin = std::min(rowMin, row[j]);
+			}
+			if (rowMin > limit)
+			{
+				return unbounded;
+			}
+		}
+		return row[b.size - 1] > limit ? unbounded : row[b.size - 1];
+	}
+
+	// Направленный Хаусдорф с ранним выходом: поиск соседки точки a обрывается, как только найдена соседка
+	// ближе текущего максимума - эта точка максимум уже не поднимет
+	inline long long directedHausdorff2(const Polyline& a, const Polyline& b, long long current, long long limit)
+	{
+		for (std::size_t i = 0; i < a.size; i++)
+		{
+			long long nearest = unbounded;
+			for (std::size_t j = 0; j < b.size && nearest > current; j++)
+			{
+				nearest = std::min(nearest, distance2(a, i, b, j));
+			}
+			if (nearest > current)
+			{
+				current = nearest;
+				if (current > limit)
+				{
+					return unbounded;
+				}
+			}
+		}
+		return current;
+	}
+
+	inline long long hausdorff2(const Polyline& a, const Polyline& b, long long limit)
+	{
+		const long long forward = directedHausdorff2(a, b, -1, limit);
+		return forward == unbounded ? unbounded : directedHausdorff2(b, a, forward, limit);
+	}
+
+	inline long long distance2(const Polyline& a, const Polyline& b, PolylineMetric metric, long long limit, std::vector<long long>& row)
+	{
+		return metric == PolylineMetric::Frechet ? frechet2(a, b, limit, row) : hausdorff2(a, b, limit);
+	}
+
+	inline double toDistance(long long squared)
+	{
+		return squared == unbounded ? std::numeric_limits<double>::infinity() : std::sqrt(static_cast<double>(squared));
+	}
+
+	// Копия ломаной из Point2d в массивы координат
+	struct Coordinates
+	{
+		std::vector<int> x;
+		std::vector<int> y;
+
+		explicit Coordinates(const std::vector<Point2d>& points)
+		{
+			if (points.empty())
+			{
+				throw std::invalid_argument("Ломаная должна содержать хотя бы одну точку");
+			}
+			x.reserve(points.size());
+			y.reserve(points.size());
+			for (const Point2d& p : points)
+			{
+				x.push_back(p.getX());
+				y.push_back(p.getY());
+			}
+		}
+
+		Polyline view() const { return { x.data(), y.data(), x.size() }; }
+	};
+}
+
+// Дискретное расстояние Фреше; больше bound - бесконечность
+inline double frechetDistance(const std::vector<Point2d>& a, const std::vector<Point2d>& b, double bound = std::numeric_limits<double>::infinity())
+{
+	const match_detail::Coordinates first(a), second(b);
+	std::vector<long long> row;
+	return match_detail::toDistance(match_detail::frechet2(first.view(), second.view(), match_detail::squaredLimit(bound), row));
+}
+
+// Расстояние Хаусдорфа между вершинами ломаных; больше bound - бесконечность
+inline double hausdorffDistance(const std::vector<Point2d>& a, const std::vector<Point2d>& b, double bound = std::numeric_limits<double>::infinity())
+{
+	const match_detail::Coordinates first(a), second(b);
+	return match_detail::toDistance(match_detail::hausdorff2(first.view(), second.view(), match_detail::squaredLimit(bound)));
+}
+
+// Библиотека шаблонов для поиска k ближайших к жесту. Вершины всех шаблонов лежат подряд в общих массивах,
+// рамки и концы посчитаны заранее. Запрос упорядочивает шаблоны по оценке снизу и досчитывает их по порядку,
+// пока оценка очередного не превысит k-е лучшее расстояние; остальные пропускаются не глядя
+class PolylineIndex
+{
+private:
+	std::vector<int> xs;
+	std::vector<int> ys;
+	std::vector<std::size_t> offsets{ 0 };
+	std::vector<match_detail::Features> features;
+
+	match_detail::Polyline polyline(std::size_t index) const
+	{
+		return { xs.data() + offsets[index], ys.data() + offsets[index], offsets[index + 1] - offsets[index] };
+	}
+
+	// Общий для потоков порог: наименьшее из k-х лучших по потокам, каждое из них не меньше общего k-го
+	static void lowerThreshold(std::atomic<long long>& threshold, long long value)
+	{
+		long long current = threshold.load(std::memory_order_relaxed);
+		while (value < current && !threshold.compare_exchange_weak(current, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+public:
+	PolylineIndex() = default;
+
+	explicit PolylineIndex(const std::vector<std::vector<Point2d>>& templates)
+	{
+		for (const std::vector<Point2d>& t : templates)
+		{
+			add(t);
+		}
+	}
+
+	// Номер добавленного шаблона
+	std::size_t add(const std::vector<Point2d>& points)
+	{
+		if (points.empty())
+		{
+			throw std::invalid_argument("Шаблон должен содержать хотя бы одну точку");
+		}
+		for (const Point2d& p : points)
+		{
+			xs.push_back(p.getX());
+			ys.push_back(p.getY());
+		}
+		offsets.push_back(xs.size());
+		features.push_back(match_detail::features(polyline(features.size())));
+		return features.size() - 1;
+	}
+
+	std::size_t size() const { return features.size(); }
+	bool empty() const { return features.empty(); }
+
+	// k ближайших шаблонов не дальше maxDistance по возрастанию расстояния. Потоки берут шаблоны
+	// из общей очереди в порядке оценки снизу и держат свои k лучших
+	std::vector<PolylineMatch> nearest(const std::vector<Point2d>& query, std::size_t k, PolylineMetric metric = PolylineMetric::Frechet,
+		double maxDistance = std::numeric_limits<double>::infinity(), PolylineSearchStats* stats = nullptr, unsigned workers = workerCount()) const
+	{
+		TRACE_SCOPE("PolylineIndex::nearest", "geometry");
+		const match_detail::Coordinates coordinates(query);
+		const match_detail::Polyline q = coordinates.view();
+		const match_detail::Features qf = match_detail::features(q);
+		if (stats)
+		{
+			*stats = PolylineSearchStats{};
+		}
+		if (k == 0 || empty())
+		{
+			return {};
+		}
+
+		const long long limit = match_detail::squaredLimit(maxDistance);
+		std::vector<std::pair<long long, std::size_t>> order;
+		order.reserve(size());
+		for (std::size_t i = 0; i < size(); i++)
+		{
+			const long long bound = match_detail::lowerBound2(qf, features[i], metric);
+			if (bound <= limit)
+			{
+				order.push_back({ bound, i });
+			}
+		}
+		std::sort(order.begin(), order.end());
+
+		std::atomic<long long> threshold{ limit };
+		std::atomic<std::size_t> cursor{ 0 };
+		std::vector<std::vector<std::pair<long long, std::size_t>>> local(std::max(workers, 1u));
+		std::vector<PolylineSearchStats> counters(local.size());
+		parallelFor(local.size(), [&](unsigned, std::size_t begin, std::size_t end)
+		{
+			for (std::size_t w = begin; w < end; w++)
+			{
+				// свои k лучших - куча с худшим наверху
+				std::vector<std::pair<long long, std::size_t>>& best = local[w];
+				std::vector<long long> row;
+				for (std::size_t next = cursor.fetch_add(1, std::memory_order_relaxed); next < order.size(); next = cursor.fetch_add(1, std::memory_order_relaxed))
+				{
+					const long long own = best.size() == k ? best.front().first : limit;
+					const long long cutoff = std::min(own, threshold.load(std::memory_order_relaxed));
+					if (order[next].first > cutoff)
+					{
+						// дальше оценки только растут
+						break;
+					}
+					counters[w].evaluated++;
+					const long long d2 = match_detail::distance2(q, polyline(order[next].second), metric, cutoff, row);
+					if (d2 == match_detail::unbounded)
+					{
+						counters[w].abandoned++;
+						continue;
+					}
+					best.push_back({ d2, order[next].second });
+					std::push_heap(best.begin(), best.end());
+					if (best.size() > k)
+					{
+						std::pop_heap(best.begin(), best.end());
+						best.pop_back();
+					}
+					if (best.size() == k)
+					{
+						lowerThreshold(threshold, best.front().first);
+					}
+				}
+			}
+		}, static_cast<unsigned>(local.size()));
+
+		std::vector<std::pair<long long, std::size_t>> merged;
+		for (const auto& best : local)
+		{
+			merged.insert(merged.end(), best.begin(), best.end());
+		}
+		std::sort(merged.begin(), merged.end());
+		merged.resize(std::min(merged.size(), k));
+		std::vector<PolylineMatch> result;
+		for (const auto& m : merged)
+		{
+			result.push_back({ m.second, match_detail::toDistance(m.first) });
+		}
+		if (stats)
+		{
+			for (const PolylineSearchStats& c : counters)
+			{
+				stats->evaluated += c.evaluated;
+				stats->abandoned += c.abandoned;
+			}
+			stats->pruned = size() - stats->evaluated;
+		}
+		return result;
+	}
+
+	// Полный перебор без оценок и раннего выхода - для сверки
+	std::vector<PolylineMatch> nearestExhaustive(const std::vector<Point2d>& query, std::size_t k, PolylineMetric metric = PolylineMetric::Frechet) const
+	{
+		const match_detail::Coordinates coordinates(query);
+		std::vector<std::pair<long long, std::size_t>> all;
+		std::vector<long long> row;
+		for (std::size_t i = 0; i < size(); i++)
+		{
+			all.push_back({ match_detail::distance2(coordinates.view(), polyline(i), metric, match_detail::unbounded, row), i });
+		}
+		std::sort(all.begin(), all.end());
+		all.resize(std::min(all.size(), k));
+		std::vector<PolylineMatch> result;
+		for (const auto& m : all)
+		{
+			result.push_back({ m.second, match_detail::toDistance(m.first) });
+		}
+		return result;
+	}
+};
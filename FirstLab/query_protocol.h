@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include <cstdint>
+
+// Двоичный протокол сервиса запросов (локальный сокет, порядок байт машины).
+// Клиент может отправлять запросы подряд, не дожидаясь ответов; ответы приходят в том же порядке.
+
+enum class QueryOp : std::uint8_t
+{
+	Nearest = 1, // args: x, y
+	Range = 2,   // args: x0, y0, x1, y1
+	Hull = 3
+};
+
+enum class QueryStatus : std::uint32_t
+{
+	Ok = 0,
+	NotFound = 1,
+	BadRequest = 2
+};
+
+struct QueryRequest
+{
+	std::uint32_t id;
+	QueryOp op;
+	std::uint8_t reserved[3];
+	std::int32_t args[4];
+};
+
+// За заголовком следуют count пар (x, y) по std::int32_t
+struct QueryResponseHeader
+{
+	std::uint32_t id;
+	QueryStatus status;
+	std::uint32_t count;
+};
+
+static_assert(sizeof(QueryRequest) == 24, "QueryRequest layout");
+static_assert(sizeof(QueryResponseHeader) == 12, "QueryResponseHeader layout");
@@ -0,0 +1,402 @@
+﻿#pragma once
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "geometry.h"
+#include "spatial_grid.h"
+#include "query_protocol.h"
+
+// Долгоживущий сервер запросов ближайшей точки, прямоугольника и оболочки по Unix-сокету.
+// Запросы ближайшей точки от всех клиентов за один проход цикла epoll собираются в один пакет.
+class GeometryQueryServer
+{
+private:
+	struct Connection
+	{
+		int fd;
+		std::vector<char> in;
+		std::vector<char> out;
+		std::size_t sent = 0;
+		std::uint32_t interest = EPOLLIN;
+		// клиент закончил писать; уже принятые запросы еще нужно ответить
+		bool readClosed = false;
+		// ошибка чтения или записи - соединение закрывается сразу
+		bool closed = false;
+
+		bool finished() const { return closed || (readClosed && out.empty()); }
+	};
+
+	struct Pending
+	{
+		Connection* connection;
+		QueryRequest request;
+		std::size_t batchIndex;
+	};
+
+	static constexpr std::size_t maxOutput = 4 << 20;
+
+	SpatialGridView grid;
+	std::vector<Point2d> hull;
+	std::string path;
+	int listenFd = -1;
+	int epollFd = -1;
+	int stopFd = -1;
+	std::unordered_map<int, Connection> connections;
+
+	std::uint64_t queries = 0;
+	std::uint64_t batches = 0;
+	std::size_t largestBatch = 0;
+
+public:
+	// Данные index принадлежат вызывающему (SpatialGrid или отображенный снимок) и должны жить дольше сервера
+	GeometryQueryServer(const std::string& socketPath, const SpatialGridView& index, const std::vector<Point2d>& hull)
+		: grid(index), hull(hull), path(socketPath)
+	{
+		listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (listenFd < 0)
+		{
+			fail("socket");
+		}
+
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path))
+		{
+			throw std::invalid_argument("Слишком длинный путь сокета");
+		}
+		std::strcpy(address.sun_path, path.c_str());
+		unlink(path.c_str());
+		if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenFd, 128) != 0)
+		{
+			fail("bind");
+		}
+
+		epollFd = epoll_create1(EPOLL_CLOEXEC);
+		stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (epollFd < 0 || stopFd < 0)
+		{
+			fail("epoll");
+		}
+		watch(listenFd, EPOLLIN, EPOLL_CTL_ADD);
+		watch(stopFd, EPOLLIN, EPOLL_CTL_ADD);
+	}
+
+	GeometryQueryServer(const GeometryQueryServer&) = delete;
+	GeometryQueryServer& operator=(const GeometryQueryServer&) = delete;
+
+	~GeometryQueryServer()
+	{
+		for (auto& entry : connections)
+		{
+			close(entry.first);
+		}
+		for (int fd : { listenFd, epollFd, stopFd })
+		{
+			if (fd >= 0)
+			{
+				close(fd);
+			}
+		}
+		unlink(path.c_str());
+	}
+
+	std::uint64_t getQueries() const { return queries; }
+	std::uint64_t getBatches() const { return batches; }
+	std::size_t getLargestBatch() const { return largestBatch; }
+
+	// Можно вызывать из другого потока или обработчика сигнала
+	void stop()
+	{
+		std::uint64_t one = 1;
+		ssize_t written = write(stopFd, &one, sizeof(one));
+		(void)written;
+	}
+
+	void run()
+	{
+		epoll_event events[64];
+		std::vector<Connection*> active;
+
+		for (;;)
+		{
+			int ready = epoll_wait(epollFd, events, 64, -1);
+			if (ready < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				fail("epoll_wait");
+			}
+
+			active.clear();
+			for (int i = 0; i < ready; i++)
+			{
+				int fd = events[i].data.fd;
+				if (fd == stopFd)
+				{
+					return;
+				}
+				if (fd == listenFd)
+				{
+					acceptClients();
+					continue;
+				}
+
+				auto found = connections.find(fd);
+				if (found == connections.end())
+				{
+					continue;
+				}
+				Connection& connection = found->second;
+				if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+				{
+					receive(connection);
+				}
+				if (events[i].events & EPOLLOUT)
+				{
+					flush(connection);
+				}
+				active.push_back(&connection);
+			}
+
+			serve(active);
+
+			for (Connection* connection : active)
+			{
+				if (connection->finished())
+				{
+					int fd = connection->fd;
+					epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+					close(fd);
+					connections.erase(fd);
+				}
+			}
+		}
+	}
+
+private:
+	[[noreturn]] static void fail(const char* what)
+	{
+		throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+	}
+
+	void watch(int fd, std::uint32_t events, int op)
+	{
+		epoll_event event{};
+		event.events = events;
+		event.data.fd = fd;
+		if (epoll_ctl(epollFd, op, fd, &event) != 0)
+		{
+			fail("epoll_ctl");
+		}
+	}
+
+	void acceptClients()
+	{
+		for (;;)
+		{
+			int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (fd < 0)
+			{
+				return;
+			}
+			connections[fd].fd = fd;
+			watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+		}
+	}
+
+	void receive(Connection& connection)
+	{
+		char buffer[16384];
+		for (;;)
+		{
+			ssize_t got = read(connection.fd, buffer, sizeof(buffer));
+			if (got > 0)
+			{
+				connection.in.insert(connection.in.end(), buffer, buffer + got);
+				continue;
+			}
+			if (got == 0)
+			{
+				connection.readClosed = true;
+			}
+			else if (errno != EAGAIN && errno != EINTR)
+			{
+				connection.closed = true;
+			}
+			if (got == 0 || errno != EINTR)
+			{
+				return;
+			}
+		}
+	}
+
+	// Разбирает все полные запросы, выполняет пакет ближайших точек и пишет ответы по порядку
+	void serve(const std::vector<Connection*>& active)
+	{
+		std::vector<Pending> pending;
+		std::vector<int> batchX;
+		std::vector<int> batchY;
+
+		for (Connection* connection : active)
+		{
+			std::size_t offset = 0;
+			while (connection->in.size() - offset >= sizeof(QueryRequest))
+			{
+				Pending item{ connection, {}, 0 };
+				std::memcpy(&item.request, connection->in.data() + offset, sizeof(QueryRequest));
+				offset += sizeof(QueryRequest);
+				if (item.request.op == QueryOp::Nearest)
+				{
+					item.batchIndex = batchX.size();
+					batchX.push_back(item.request.args[0]);
+					batchY.push_back(item.request.args[1]);
+				}
+				pending.push_back(item);
+			}
+			connection->in.erase(connection->in.begin(), connection->in.begin() + offset);
+		}
+
+		std::vector<long long> nearest(batchX.size());
+		if (!batchX.empty())
+		{
+			grid.nearestBatch(batchX.data(), batchY.data(), nearest.data(), batchX.size());
+			batches++;
+			largestBatch = std::max(largestBatch, batchX.size());
+		}
+
+		std::vector<std::uint32_t> selected;
+		for (const Pending& item : pending)
+		{
+			const QueryRequest& request = item.request;
+			std::vector<char>& out = item.connection->out;
+			queries++;
+
+			switch (request.op)
+			{
+			case QueryOp::Nearest:
+			{
+				long long index = nearest[item.batchIndex];
+				if (index < 0)
+				{
+					append(out, request.id, QueryStatus::NotFound, nullptr, 0);
+				}
+				else
+				{
+					const Point2d& p = grid.point(index);
+					std::int32_t xy[2] = { p.getX(), p.getY() };
+					append(out, request.id, QueryStatus::Ok, xy, 1);
+				}
+				break;
+			}
+			case QueryOp::Range:
+			{
+				selected = grid.range(request.args[0], request.args[1], request.args[2], request.args[3]);
+				appendPoints(out, request.id, selected);
+				break;
+			}
+			case QueryOp::Hull:
+			{
+				std::vector<std::int32_t> xy;
+				for (const Point2d& p : hull)
+				{
+					xy.push_back(p.getX());
+					xy.push_back(p.getY());
+				}
+				append(out, request.id, QueryStatus::Ok, xy.data(), static_cast<std::uint32_t>(hull.size()));
+				break;
+			}
+			default:
+				append(out, request.id, QueryStatus::BadRequest, nullptr, 0);
+				break;
+			}
+		}
+
+		for (Connection* connection : active)
+		{
+			flush(*connection);
+		}
+	}
+
+	static void append(std::vector<char>& out, std::uint32_t id, QueryStatus status, const std::int32_t* xy, std::uint32_t count)
+	{
+		QueryResponseHeader header{ id, status, count };
+		const char* raw = reinterpret_cast<const char*>(&header);
+		out.insert(out.end(), raw, raw + sizeof(header));
+		if (count)
+		{
+			raw = reinterpret_cast<const char*>(xy);
+			out.insert(out.end(), raw, raw + sizeof(std::int32_t) * 2 * count);
+		}
+	}
+
+	void appendPoints(std::vector<char>& out, std::uint32_t id, const std::vector<std::uint32_t>& indices) const
+	{
+		std::vector<std::int32_t> xy;
+		xy.reserve(indices.size() * 2);
+		for (std::uint32_t index : indices)
+		{
+			xy.push_back(grid.point(index).getX());
+			xy.push_back(grid.point(index).getY());
+		}
+		append(out, id, QueryStatus::Ok, xy.data(), static_cast<std::uint32_t>(indices.size()));
+	}
+
+	void flush(Connection& connection)
+	{
+		while (connection.sent < connection.out.size() && !connection.closed)
+		{
+			ssize_t written = send(connection.fd, connection.out.data() + connection.sent,
+				connection.out.size() - connection.sent, MSG_NOSIGNAL);
+			if (written > 0)
+			{
+				connection.sent += written;
+			}
+			else if (errno == EAGAIN)
+			{
+				break;
+			}
+			else if (errno != EINTR)
+			{
+				connection.closed = true;
+			}
+		}
+
+		if (connection.sent == connection.out.size())
+		{
+			connection.out.clear();
+			connection.sent = 0;
+		}
+
+		if (connection.closed)
+		{
+			return;
+		}
+
+		// пока клиент не забирает ответы, новые запросы не читаем; после конца чтения ждем только записи
+		std::size_t backlog = connection.out.size() - connection.sent;
+		std::uint32_t interest = (connection.readClosed || backlog > maxOutput ? 0u : static_cast<std::uint32_t>(EPOLLIN)) | (backlog ? static_cast<std::uint32_t>(EPOLLOUT) : 0u);
+		if (interest != connection.interest)
+		{
+			watch(connection.fd, interest, EPOLL_CTL_MOD);
+			connection.interest = interest;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,149 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Растеризация толстых линий в двухцветную картинку
+
+class Bitmap
+{
+private:
+	int width;
+	int height;
+	std::vector<std::uint8_t> bits;
+
+public:
+	Bitmap(int width = 0, int height = 0) : width(width), height(height)
+	{
+		if (width < 0 || height < 0)
+		{
+			throw std::invalid_argument("Размеры картинки не могут быть отрицательными");
+		}
+		bits.assign(static_cast<std::size_t>(width) * height, 0);
+	}
+
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+
+	bool get(int x, int y) const
+	{
+		return x >= 0 && y >= 0 && x < width && y < height && bits[static_cast<std::size_t>(y) * width + x];
+	}
+
+	void set(int x, int y)
+	{
+		if (x >= 0 && y >= 0 && x < width && y < height)
+		{
+			bits[static_cast<std::size_t>(y) * width + x] = 1;
+		}
+	}
+
+	// Закрашивает [x0, x1] в строке y с отсечением по краям
+	void fillSpan(int y, int x0, int x1)
+	{
+		if (y < 0 || y >= height)
+		{
+			return;
+		}
+		x0 = std::max(x0, 0);
+		x1 = std::min(x1, width - 1);
+		if (x0 <= x1)
+		{
+			std::fill(bits.begin() + static_cast<std::size_t>(y) * width + x0, bits.begin() + static_cast<std::size_t>(y) * width + x1 + 1, 1);
+		}
+	}
+
+	std::string toString(char on = '#', char off = ' ') const
+	{
+		std::string text;
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				text += get(x, y) ? on : off;
+			}
+			text += '\n';
+		}
+		return text;
+	}
+};
+
+namespace raster_detail
+{
+	// Сужает [lo, hi] до x, при которых low <= a * x + b <= high
+	inline void clipLinear(double a, double b, double low, double high, double& lo, double& hi)
+	{
+		if (a == 0)
+		{
+			if (b < low || b > high)
+			{
+				lo = 1;
+				hi = 0;
+			}
+			return;
+		}
+		double from = (low - b) / a;
+		double to = (high - b) / a;
+		if (from > to)
+		{
+			std::swap(from, to);
+		}
+		lo = std::max(lo, from);
+		hi = std::min(hi, to);
+	}
+}
+
+// Отрезок толщины thickness с круглыми концами (капсула). Капсула выпуклая, поэтому в каждой строке
+// это один интервал: он считается как объединение сечений прямоугольника и двух кругов, без перебора пикселей.
+// Закрашиваются пиксели, центры которых попали внутрь.
+inline void drawThickLine(Bitmap& bitmap, double x0, double y0, double x1, double y1, double thickness)
+{
+	const double half = std::max(thickness, 1.0) / 2;
+	const double dx = x1 - x0;
+	const double dy = y1 - y0;
+	const double length = std::sqrt(dx * dx + dy * dy);
+
+	const int rowFrom = std::max(0, static_cast<int>(std::floor(std::min(y0, y1) - half)));
+	const int rowTo = std::min(bitmap.getHeight() - 1, static_cast<int>(std::ceil(std::max(y0, y1) + half)));
+	for (int row = rowFrom; row <= rowTo; row++)
+	{
+		const double py = row + 0.5;
+		double left = INFINITY;
+		double right = -INFINITY;
+
+		const double ends[2][2] = { { x0, y0 }, { x1, y1 } };
+		for (const auto& end : ends)
+		{
+			const double h = py - end[1];
+			if (h * h <= half * half)
+			{
+				const double w = std::sqrt(half * half - h * h);
+				left = std::min(left, end[0] - w);
+				right = std::max(right, end[0] + w);
+			}
+		}
+
+		if (length > 0)
+		{
+			// t - проекция на отрезок, n - расстояние до прямой; обе линейны по x
+			double lo = -INFINITY;
+			double hi = INFINITY;
+			raster_detail::clipLinear(dx / (length * length), ((py - y0) * dy - x0 * dx) / (length * length), 0, 1, lo, hi);
+			raster_detail::clipLinear(dy / length, -(x0 * dy + (py - y0) * dx) / length, -half, half, lo, hi);
+			if (lo <= hi)
+			{
+				left = std::min(left, lo);
+				right = std::max(right, hi);
+			}
+		}
+
+		if (left <= right)
+		{
+			bitmap.fillSpan(row, static_cast<int>(std::ceil(left - 0.5)), static_cast<int>(std::floor(right - 0.5)));
+		}
+	}
+}
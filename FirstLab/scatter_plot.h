@@ -0,0 +1,286 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "geometry.h"
+#include "console.h"
+#include "palette.h"
+#include "parallel.h"
+
+// Диаграмма рассеяния с агрегацией: точки считаются по клеткам терминала, а клетка
+// закрашивается по плотности. Новые точки только увеличивают счетчики своих клеток,
+// перевыводятся лишь клетки, у которых сменилась ступень шкалы.
+class ScatterPlot
+{
+private:
+	int columns;
+	int rows;
+	int viewWidth;
+	int viewHeight;
+	std::vector<ShadeLevel> ramp;
+	std::vector<std::uint32_t> bins;
+	std::vector<std::uint8_t> levels;
+	std::vector<std::uint8_t> shown;
+	std::vector<std::uint32_t> touched;
+	std::vector<std::uint8_t> touchedFlag;
+	std::uint64_t total = 0;
+	std::uint32_t maxCount = 0;
+	int scaleBits = 0;
+	bool rescaled = true;
+	bool shownValid = false;
+
+public:
+	ScatterPlot(int columns = 80, int rows = 24, int viewWidth = screenWidth, int viewHeight = screenHeight, int shades = 8)
+		: columns(columns), rows(rows), viewWidth(viewWidth), viewHeight(viewHeight)
+	{
+		if (columns <= 0 || rows <= 0 || viewWidth <= 0 || viewHeight <= 0)
+		{
+			throw std::invalid_argument("Размеры графика должны быть положительными");
+		}
+		if (shades < 1 || shades > 255)
+		{
+			throw std::invalid_argument("Число ступеней шкалы должно быть от 1 до 255");
+		}
+		ramp = densityRamp(shades);
+		const std::size_t cells = static_cast<std::size_t>(columns) * rows;
+		bins.assign(cells, 0);
+		levels.assign(cells, 0);
+		shown.assign(cells, 0);
+		touchedFlag.assign(cells, 0);
+	}
+
+	int getColumns() const { return columns; }
+	int getRows() const { return rows; }
+	std::uint64_t size() const { return total; }
+	std::uint32_t count(int column, int row) const { return bins[static_cast<std::size_t>(row) * columns + column]; }
+
+	void clear()
+	{
+		std::fill(bins.begin(), bins.end(), 0);
+		total = 0;
+		maxCount = 0;
+		scaleBits = 0;
+		rescaled = true;
+		touched.clear();
+		std::fill(touchedFlag.begin(), touchedFlag.end(), 0);
+	}
+
+	// Небольшая порция точек увеличивает только счетчики своих клеток. Большая считается за один
+	// параллельный проход: каждый поток считает в свои счетчики, потом они сливаются
+	void add(const Point2d* points, std::size_t n)
+	{
+		if (n < 65536)
+		{
+			for (std::size_t i = 0; i < n; i++)
+			{
+				addToCell(cellOf(points[i]), 1);
+			}
+		}
+		else
+		{
+			const std::size_t cells = bins.size();
+			std::vector<std::vector<std::uint32_t>> local(workerCount());
+			parallelFor(n, [&](unsigned worker, std::size_t begin, std::size_t end)
+			{
+				std::vector<std::uint32_t>& counts = local[worker];
+				counts.assign(cells, 0);
+				for (std::size_t i = begin; i < end; i++)
+				{
+					counts[cellOf(points[i])]++;
+				}
+			}, static_cast<unsigned>(local.size()));
+
+			for (std::size_t cell = 0; cell < cells; cell++)
+			{
+				std::uint32_t added = 0;
+				for (const std::vector<std::uint32_t>& counts : local)
+				{
+					added += counts.empty() ? 0 : counts[cell];
+				}
+				if (added)
+				{
+					addToCell(cell, added);
+				}
+			}
+		}
+		total += n;
+
+		const int bits = bitWidth(maxCount);
+		if (bits != scaleBits)
+		{
+			scaleBits = bits;
+			rescaled = true;
+		}
+	}
+
+	void add(const std::vector<Point2d>& points) { add(points.data(), points.size()); }
+
+	void add(const Point2d& p) { add(&p, 1); }
+
+	// Выводит изменившиеся клетки в консоль начиная с (line, column); возвращает их число
+	std::size_t present(int line = 0, int column = 0)
+	{
+		updateLevels();
+		Console::enableUtf8();
+		std::size_t emitted = 0;
+		bool colorKnown = false;
+		Color current = Color::BrightWhite;
+		std::string run;
+		for (int row = 0; row < rows; row++)
+		{
+			const std::size_t base = static_cast<std::size_t>(row) * columns;
+			int x = 0;
+			while (x < columns)
+			{
+				if (shownValid && levels[base + x] == shown[base + x])
+				{
+					x++;
+					continue;
+				}
+				Console::setCursor(line + row, column + x);
+				while (x < columns && (!shownValid || levels[base + x] != shown[base + x]))
+				{
+					const std::uint8_t level = levels[base + x];
+					if (level && (!colorKnown || ramp[level - 1].color != current))
+					{
+						Console::write(run);
+						run.clear();
+						current = ramp[level - 1].color;
+						Console::setColor(current);
+						colorKnown = true;
+					}
+					run += level ? ramp[level - 1].glyph : std::string(" ");
+					shown[base + x] = level;
+					emitted++;
+					x++;
+				}
+				Console::write(run);
+				run.clear();
+			}
+		}
+		shownValid = true;
+		if (colorKnown)
+		{
+			Console::resetColor();
+		}
+		Console::flush();
+		return emitted;
+	}
+
+	// Число клеток, которые выведет следующий present()
+	std::size_t changedCells()
+	{
+		updateLevels();
+		if (!shownValid)
+		{
+			return levels.size();
+		}
+		std::size_t changed = 0;
+		for (std::size_t i = 0; i < levels.size(); i++)
+		{
+			changed += levels[i] != shown[i];
+		}
+		return changed;
+	}
+
+	// Считать текущий кадр уже показанным, например после вывода toString()
+	void markPresented()
+	{
+		updateLevels();
+		shown = levels;
+		shownValid = true;
+	}
+
+	void invalidate()
+	{
+		shownValid = false;
+	}
+
+	// Кадр целиком строками UTF-8 без цвета
+	std::string toString()
+	{
+		updateLevels();
+		std::string text;
+		for (int row = 0; row < rows; row++)
+		{
+			for (int column = 0; column < columns; column++)
+			{
+				const std::uint8_t level = levels[static_cast<std::size_t>(row) * columns + column];
+				text += level ? ramp[level - 1].glyph : std::string(" ");
+			}
+			text += '\n';
+		}
+		return text;
+	}
+
+private:
+	void addToCell(std::size_t cell, std::uint32_t added)
+	{
+		bins[cell] += added;
+		maxCount = std::max(maxCount, bins[cell]);
+		if (!touchedFlag[cell])
+		{
+			touchedFlag[cell] = 1;
+			touched.push_back(static_cast<std::uint32_t>(cell));
+		}
+	}
+
+	std::size_t cellOf(const Point2d& p) const
+	{
+		const int column = std::clamp(static_cast<int>(static_cast<long long>(p.getX()) * columns / viewWidth), 0, columns - 1);
+		// ось y окна направлена вверх, строки терминала - вниз
+		const int row = std::clamp(static_cast<int>(static_cast<long long>(viewHeight - 1 - p.getY()) * rows / viewHeight), 0, rows - 1);
+		return static_cast<std::size_t>(row) * columns + column;
+	}
+
+	static int bitWidth(std::uint32_t value)
+	{
+		int bits = 0;
+		while (value)
+		{
+			bits++;
+			value >>= 1;
+		}
+		return bits;
+	}
+
+	// Логарифмическая шкала зависит от максимума только через его разрядность,
+	// поэтому все клетки пересчитываются лишь когда максимум переходит степень двойки
+	std::uint8_t levelOf(std::uint32_t count) const
+	{
+		if (!count)
+		{
+			return 0;
+		}
+		return static_cast<std::uint8_t>(1 + (bitWidth(count) - 1) * static_cast<int>(ramp.size()) / scaleBits);
+	}
+
+	void updateLevels()
+	{
+		if (rescaled)
+		{
+			for (std::size_t i = 0; i < bins.size(); i++)
+			{
+				levels[i] = levelOf(bins[i]);
+			}
+			rescaled = false;
+		}
+		else
+		{
+			for (std::uint32_t cell : touched)
+			{
+				levels[cell] = levelOf(bins[cell]);
+			}
+		}
+		for (std::uint32_t cell : touched)
+		{
+			touchedFlag[cell] = 0;
+		}
+		touched.clear();
+	}
+};
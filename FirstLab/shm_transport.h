@@ -0,0 +1,258 @@
+﻿#pragma once
+
+#ifdef __linux__
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Кольцо пакетов точек в разделяемой памяти (memfd + mmap) для одного писателя и одного читателя.
+// Читатель получает указатели прямо в память писателя, без копирования и разбора.
+
+struct ShmBatchSlot
+{
+	std::uint32_t* count;
+	int* x;
+	int* y;
+	std::uint32_t capacity;
+};
+
+class ShmBatchRing
+{
+private:
+	static constexpr std::uint32_t magic = 0x42545347;
+	static constexpr std::size_t alignment = 64;
+
+	struct Header
+	{
+		std::uint32_t magic;
+		std::uint32_t slotCount;
+		std::uint32_t slotCapacity;
+		std::uint32_t slotBytes;
+		alignas(alignment) std::atomic<std::uint32_t> head;
+		// меняется при каждой публикации и закрытии, на нем спит читатель
+		std::atomic<std::uint32_t> signal;
+		std::atomic<std::uint32_t> readerWaiting;
+		alignas(alignment) std::atomic<std::uint32_t> tail;
+		std::atomic<std::uint32_t> writerWaiting;
+		alignas(alignment) std::atomic<std::uint32_t> closed;
+	};
+
+	int memfd = -1;
+	std::size_t mappedBytes = 0;
+	Header* header = nullptr;
+	unsigned char* slots = nullptr;
+
+public:
+	ShmBatchRing() {}
+
+	// Создает сегмент для slotCount пакетов по slotCapacity точек
+	static ShmBatchRing create(std::uint32_t slotCount, std::uint32_t slotCapacity)
+	{
+		if (slotCount == 0 || (slotCount & (slotCount - 1)) != 0 || slotCapacity == 0)
+		{
+			// степень двойки: номер слота остается верным при переполнении счетчиков
+			throw std::invalid_argument("Число слотов должно быть степенью двойки, размер слота - положительным");
+		}
+
+		ShmBatchRing ring;
+		ring.memfd = static_cast<int>(syscall(SYS_memfd_create, "point-batches", 0));
+		if (ring.memfd < 0)
+		{
+			fail("memfd_create");
+		}
+
+		std::uint32_t slotBytes = static_cast<std::uint32_t>(roundUp(alignment + 2 * sizeof(int) * slotCapacity));
+		std::size_t bytes = roundUp(sizeof(Header)) + static_cast<std::size_t>(slotBytes) * slotCount;
+		if (ftruncate(ring.memfd, static_cast<off_t>(bytes)) != 0)
+		{
+			fail("ftruncate");
+		}
+		ring.map(bytes);
+
+		Header* h = new (ring.header) Header();
+		h->slotCount = slotCount;
+		h->slotCapacity = slotCapacity;
+		h->slotBytes = slotBytes;
+		h->magic = magic;
+		return ring;
+	}
+
+	// Подключается к сегменту по дескриптору, полученному от писателя (fork или SCM_RIGHTS)
+	static ShmBatchRing attach(int fd)
+	{
+		ShmBatchRing ring;
+		ring.memfd = dup(fd);
+		if (ring.memfd < 0)
+		{
+			fail("dup");
+		}
+
+		std::uint32_t probe[4];
+		if (pread(ring.memfd, probe, sizeof(probe), 0) != sizeof(probe) || probe[0] != magic)
+		{
+			throw std::runtime_error("Дескриптор не является кольцом пакетов");
+		}
+		ring.map(roundUp(sizeof(Header)) + static_cast<std::size_t>(probe[3]) * probe[1]);
+		return ring;
+	}
+
+	ShmBatchRing(const ShmBatchRing&) = delete;
+	ShmBatchRing& operator=(const ShmBatchRing&) = delete;
+
+	ShmBatchRing(ShmBatchRing&& other) noexcept { swap(other); }
+
+	ShmBatchRing& operator=(ShmBatchRing&& other) noexcept
+	{
+		swap(other);
+		return *this;
+	}
+
+	~ShmBatchRing()
+	{
+		if (header)
+		{
+			munmap(header, mappedBytes);
+		}
+		if (memfd >= 0)
+		{
+			::close(memfd);
+		}
+	}
+
+	int fd() const { return memfd; }
+	std::uint32_t capacity() const { return header->slotCapacity; }
+
+	// Писатель: ждет свободный слот и отдает его для заполнения
+	ShmBatchSlot acquireWrite()
+	{
+		std::uint32_t head = header->head.load(std::memory_order_relaxed);
+		waitWhile(header->tail, header->writerWaiting, [&](std::uint32_t tail) { return head - tail == header->slotCount; });
+		return slot(head);
+	}
+
+	void publish()
+	{
+		header->head.fetch_add(1, std::memory_order_release);
+		header->signal.fetch_add(1, std::memory_order_seq_cst);
+		wake(header->signal, header->readerWaiting);
+	}
+
+	// Читатель: ждет заполненный слот; пустой count == nullptr означает, что писатель закрыл кольцо
+	ShmBatchSlot acquireRead()
+	{
+		std::uint32_t tail = header->tail.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			std::uint32_t signal = header->signal.load(std::memory_order_seq_cst);
+			if (header->head.load(std::memory_order_acquire) != tail)
+			{
+				return slot(tail);
+			}
+			if (header->closed.load(std::memory_order_acquire))
+			{
+				return ShmBatchSlot{ nullptr, nullptr, nullptr, 0 };
+			}
+			header->readerWaiting.store(1, std::memory_order_seq_cst);
+			futex(&header->signal, FUTEX_WAIT, signal);
+			header->readerWaiting.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	void release()
+	{
+		header->tail.fetch_add(1, std::memory_order_release);
+		wake(header->tail, header->writerWaiting);
+	}
+
+	void close()
+	{
+		header->closed.store(1, std::memory_order_seq_cst);
+		header->signal.fetch_add(1, std::memory_order_seq_cst);
+		futex(&header->signal, FUTEX_WAKE, 1);
+	}
+
+private:
+	static std::size_t roundUp(std::size_t bytes)
+	{
+		return (bytes + alignment - 1) / alignment * alignment;
+	}
+
+	[[noreturn]] static void fail(const char* what)
+	{
+		throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+	}
+
+	static long futex(std::atomic<std::uint32_t>* word, int op, std::uint32_t value)
+	{
+		static_assert(std::atomic<std::uint32_t>::is_always_lock_free && sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t), "futex word");
+		return syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(word), op, value, nullptr, nullptr, 0);
+	}
+
+	template <class Full>
+	static void waitWhile(std::atomic<std::uint32_t>& word, std::atomic<std::uint32_t>& waiting, Full full)
+	{
+		for (;;)
+		{
+			std::uint32_t value = word.load(std::memory_order_acquire);
+			if (!full(value))
+			{
+				return;
+			}
+			waiting.store(1, std::memory_order_seq_cst);
+			if (word.load(std::memory_order_seq_cst) == value)
+			{
+				futex(&word, FUTEX_WAIT, value);
+			}
+			waiting.store(0, std::memory_order_relaxed);
+		}
+	}
+
+	// Системный вызов только если другая сторона уснула
+	static void wake(std::atomic<std::uint32_t>& word, std::atomic<std::uint32_t>& waiting)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiting.load(std::memory_order_seq_cst))
+		{
+			futex(&word, FUTEX_WAKE, 1);
+		}
+	}
+
+	void map(std::size_t bytes)
+	{
+		void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+		if (memory == MAP_FAILED)
+		{
+			fail("mmap");
+		}
+		mappedBytes = bytes;
+		header = static_cast<Header*>(memory);
+		slots = static_cast<unsigned char*>(memory) + roundUp(sizeof(Header));
+	}
+
+	ShmBatchSlot slot(std::uint32_t sequence) const
+	{
+		unsigned char* base = slots + static_cast<std::size_t>(sequence % header->slotCount) * header->slotBytes;
+		int* x = reinterpret_cast<int*>(base + alignment);
+		return ShmBatchSlot{ reinterpret_cast<std::uint32_t*>(base), x, x + header->slotCapacity, header->slotCapacity };
+	}
+
+	void swap(ShmBatchRing& other) noexcept
+	{
+		std::swap(memfd, other.memfd);
+		std::swap(mappedBytes, other.mappedBytes);
+		std::swap(header, other.header);
+		std::swap(slots, other.slots);
+	}
+};
+
+#endif
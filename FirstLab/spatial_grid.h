@@ -0,0 +1,478 @@
+﻿#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "geometry.h"
+#include "vector_n.h"
+
+namespace spatial_grid_detail
+{
+	// Четыре запроса на полосах: точка ячейки загружается один раз и сравнивается со всеми сразу.
+	// Индекс лучшей точки хранится в double рядом с расстоянием, чтобы выбирать их одной маской;
+	// полосы обновляются только при улучшении, как ветка в скалярном nearest()
+#ifdef __AVX__
+	struct NearestLanes
+	{
+		__m256d qx;
+		__m256d qy;
+		__m256d best;
+		__m256d index;
+
+		NearestLanes(const double* x, const double* y, double maxDist2)
+			: qx(_mm256_loadu_pd(x)), qy(_mm256_loadu_pd(y)), best(_mm256_set1_pd(maxDist2)), index(_mm256_set1_pd(-1)) {}
+
+		void visit(double px, double py, double i)
+		{
+			__m256d dx = _mm256_sub_pd(_mm256_set1_pd(px), qx);
+			__m256d dy = _mm256_sub_pd(_mm256_set1_pd(py), qy);
+			__m256d d2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+			__m256d closer = _mm256_cmp_pd(d2, best, _CMP_LT_OQ);
+			if (_mm256_movemask_pd(closer))
+			{
+				best = _mm256_blendv_pd(best, d2, closer);
+				index = _mm256_blendv_pd(index, _mm256_set1_pd(i), closer);
+			}
+		}
+
+		void get(double* bestOut, double* indexOut) const
+		{
+			_mm256_storeu_pd(bestOut, best);
+			_mm256_storeu_pd(indexOut, index);
+		}
+	};
+#elif defined(VECTOR_N_SSE2)
+	// без AVX - две половины по 2 полосы
+	struct NearestLanes
+	{
+		__m128d qx[2];
+		__m128d qy[2];
+		__m128d best[2];
+		__m128d index[2];
+
+		NearestLanes(const double* x, const double* y, double maxDist2)
+		{
+			for (int h = 0; h < 2; h++)
+			{
+				qx[h] = _mm_loadu_pd(x + 2 * h);
+				qy[h] = _mm_loadu_pd(y + 2 * h);
+				best[h] = _mm_set1_pd(maxDist2);
+				index[h] = _mm_set1_pd(-1);
+			}
+		}
+
+		void visit(double px, double py, double i)
+		{
+			const __m128d x = _mm_set1_pd(px), y = _mm_set1_pd(py), k = _mm_set1_pd(i);
+			for (int h = 0; h < 2; h++)
+			{
+				__m128d dx = _mm_sub_pd(x, qx[h]);
+				__m128d dy = _mm_sub_pd(y, qy[h]);
+				__m128d d2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+				__m128d closer = _mm_cmplt_pd(d2, best[h]);
+				if (!_mm_movemask_pd(closer))
+				{
+					continue;
+				}
+				best[h] = _mm_or_pd(_mm_and_pd(closer, d2), _mm_andnot_pd(closer, best[h]));
+				index[h] = _mm_or_pd(_mm_and_pd(closer, k), _mm_andnot_pd(closer, index[h]));
+			}
+		}
+
+		void get(double* bestOut, double* indexOut) const
+		{
+			for (int h = 0; h < 2; h++)
+			{
+				_mm_storeu_pd(bestOut + 2 * h, best[h]);
+				_mm_storeu_pd(indexOut + 2 * h, index[h]);
+			}
+		}
+	};
+#else
+	struct NearestLanes
+	{
+		double qx[4];
+		double qy[4];
+		double best[4];
+		double index[4];
+
+		NearestLanes(const double* x, const double* y, double maxDist2)
+		{
+			for (int l = 0; l < 4; l++)
+			{
+				qx[l] = x[l];
+				qy[l] = y[l];
+				best[l] = maxDist2;
+				index[l] = -1;
+			}
+		}
+
+		void visit(double px, double py, double i)
+		{
+			for (int l = 0; l < 4; l++)
+			{
+				double dx = px - qx[l];
+				double dy = py - qy[l];
+				double d2 = dx * dx + dy * dy;
+				if (d2 < best[l])
+				{
+					best[l] = d2;
+					index[l] = i;
+				}
+			}
+		}
+
+		void get(double* bestOut, double* indexOut) const
+		{
+			for (int l = 0; l < 4; l++)
+			{
+				bestOut[l] = best[l];
+				indexOut[l] = index[l];
+			}
+		}
+	};
+#endif
+}
+
+// Запросы к построенной сетке; данные могут лежать как в SpatialGrid, так и в отображенном файле
+class SpatialGridView
+{
+public:
+	int cellSize = 16;
+	int columns = 0;
+	int rows = 0;
+	const std::uint32_t* cellStart = nullptr;
+	const std::uint32_t* order = nullptr;
+	const Point2d* points = nullptr;
+	std::size_t count = 0;
+
+	std::size_t size() const { return count; }
+	const Point2d& point(std::size_t index) const { return points[index]; }
+
+	// Индекс ближайшей точки не дальше maxDistance или -1
+	long long nearest(double x, double y, double maxDistance = std::numeric_limits<double>::infinity(), double* distance2 = nullptr) const
+	{
+		long long best = -1;
+		double bestDist2 = maxDistance * maxDistance;
+		if (count == 0)
+		{
+			return best;
+		}
+
+		const int cx = std::clamp(static_cast<int>(std::floor(x / cellSize)), 0, columns - 1);
+		const int cy = std::clamp(static_cast<int>(std::floor(y / cellSize)), 0, rows - 1);
+		const int maxRing = std::max(columns, rows);
+
+		for (int ring = 0; ring <= maxRing; ring++)
+		{
+			// ближайшая возможная точка кольца дальше найденной - дальше искать незачем
+			double ringGap = ringDistance(x, y, cx, cy, ring);
+			if (ringGap * ringGap > bestDist2)
+			{
+				break;
+			}
+
+			for (int gy = cy - ring; gy <= cy + ring; gy++)
+			{
+				if (gy < 0 || gy >= rows)
+				{
+					continue;
+				}
+				bool edgeRow = gy == cy - ring || gy == cy + ring;
+				int step = edgeRow ? 1 : 2 * ring;
+				for (int gx = cx - ring; gx <= cx + ring; gx += std::max(step, 1))
+				{
+					if (gx < 0 || gx >= columns)
+					{
+						continue;
+					}
+					std::size_t cell = static_cast<std::size_t>(gy) * columns + gx;
+					for (std::uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+					{
+						const Point2d& p = points[order[k]];
+						double dx = p.getX() - x;
+						double dy = p.getY() - y;
+						double d2 = dx * dx + dy * dy;
+						if (d2 < bestDist2)
+						{
+							bestDist2 = d2;
+							best = order[k];
+						}
+					}
+				}
+			}
+		}
+
+		if (distance2 && best >= 0)
+		{
+			*distance2 = bestDist2;
+		}
+		return best;
+	}
+
+	// Пакет запросов обходится в порядке ячеек; запросы одной ячейки идут четверками через NearestLanes,
+	// так что кольца ячеек читаются один раз на четверку. Результаты те же, что у nearest()
+	void nearestBatch(const int* x, const int* y, long long* out, std::size_t n,
+		double maxDistance = std::numeric_limits<double>::infinity()) const
+	{
+		if (count == 0)
+		{
+			std::fill(out, out + n, -1);
+			return;
+		}
+
+		std::vector<std::pair<std::size_t, std::uint32_t>> byCell(n);
+		for (std::size_t i = 0; i < n; i++)
+		{
+			byCell[i] = { clampedCell(x[i], y[i]), static_cast<std::uint32_t>(i) };
+		}
+		std::sort(byCell.begin(), byCell.end());
+
+		for (std::size_t first = 0; first < n;)
+		{
+			const std::size_t cell = byCell[first].first;
+			std::size_t last = first + 1;
+			while (last < n && last - first < 4 && byCell[last].first == cell)
+			{
+				last++;
+			}
+			if (last - first == 1)
+			{
+				const std::uint32_t query = byCell[first].second;
+				out[query] = nearest(x[query], y[query], maxDistance);
+			}
+			else
+			{
+				// недостающие полосы повторяют последний запрос
+				double qx[4];
+				double qy[4];
+				for (std::size_t l = 0; l < 4; l++)
+				{
+					const std::uint32_t query = byCell[std::min(first + l, last - 1)].second;
+					qx[l] = x[query];
+					qy[l] = y[query];
+				}
+				long long found[4];
+				nearestPack(qx, qy, last - first, cell, maxDistance, found);
+				for (std::size_t l = 0; l < last - first; l++)
+				{
+					out[byCell[first + l].second] = found[l];
+				}
+			}
+			first = last;
+		}
+	}
+
+	// Индексы точек в прямоугольнике [x0, x1] x [y0, y1]
+	std::vector<std::uint32_t> range(int x0, int y0, int x1, int y1) const
+	{
+		std::vector<std::uint32_t> result;
+		if (count == 0 || x1 < x0 || y1 < y0)
+		{
+			return result;
+		}
+
+		const int gx0 = std::clamp(x0 / cellSize, 0, columns - 1);
+		const int gx1 = std::clamp(x1 / cellSize, 0, columns - 1);
+		const int gy0 = std::clamp(y0 / cellSize, 0, rows - 1);
+		const int gy1 = std::clamp(y1 / cellSize, 0, rows - 1);
+
+		for (int gy = gy0; gy <= gy1; gy++)
+		{
+			for (int gx = gx0; gx <= gx1; gx++)
+			{
+				std::size_t cell = static_cast<std::size_t>(gy) * columns + gx;
+				for (std::uint32_t k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+				{
+					const Point2d& p = points[order[k]];
+					if (p.getX() >= x0 && p.getX() <= x1 && p.getY() >= y0 && p.getY() <= y1)
+					{
+						result.push_back(order[k]);
+					}
+				}
+			}
+		}
+		return result;
+	}
+
+private:
+	// Кольцевой обход как в nearest(), общий для запросов одной ячейки: кольцо пропускается,
+	// только когда оно дальше лучшей точки у всех полос
+	void nearestPack(const double* qx, const double* qy, std::size_t lanes, std::size_t cell, double maxDistance, long long* out) const
+	{
+		const int cx = static_cast<int>(cell % columns);
+		const int cy = static_cast<int>(cell / columns);
+		const int maxRing = std::max(columns, rows);
+		spatial_grid_detail::NearestLanes kernel(qx, qy, maxDistance * maxDistance);
+		double best[4];
+		double index[4];
+
+		for (int ring = 0; ring <= maxRing; ring++)
+		{
+			kernel.get(best, index);
+			bool beyond = true;
+			for (std::size_t l = 0; l < lanes && beyond; l++)
+			{
+				double ringGap = ringDistance(qx[l], qy[l], cx, cy, ring);
+				beyond = ringGap * ringGap > best[l];
+			}
+			if (beyond)
+			{
+				break;
+			}
+
+			for (int gy = cy - ring; gy <= cy + ring; gy++)
+			{
+				if (gy < 0 || gy >= rows)
+				{
+					continue;
+				}
+				bool edgeRow = gy == cy - ring || gy == cy + ring;
+				int step = edgeRow ? 1 : 2 * ring;
+				for (int gx = cx - ring; gx <= cx + ring; gx += std::max(step, 1))
+				{
+					if (gx < 0 || gx >= columns)
+					{
+						continue;
+					}
+					std::size_t visited = static_cast<std::size_t>(gy) * columns + gx;
+					for (std::uint32_t k = cellStart[visited]; k < cellStart[visited + 1]; k++)
+					{
+						const Point2d& p = points[order[k]];
+						kernel.visit(p.getX(), p.getY(), order[k]);
+					}
+				}
+			}
+		}
+
+		kernel.get(best, index);
+		for (std::size_t l = 0; l < lanes; l++)
+		{
+			out[l] = index[l] < 0 ? -1 : static_cast<long long>(index[l]);
+		}
+	}
+
+	std::size_t clampedCell(int x, int y) const
+	{
+		int gx = std::clamp(x < 0 ? -1 : x / cellSize, 0, columns - 1);
+		int gy = std::clamp(y < 0 ? -1 : y / cellSize, 0, rows - 1);
+		return static_cast<std::size_t>(gy) * columns + gx;
+	}
+
+	double ringDistance(double x, double y, int cx, int cy, int ring) const
+	{
+		if (ring == 0)
+		{
+			return 0;
+		}
+		double left = (cx - ring + 1) * static_cast<double>(cellSize);
+		double right = (cx + ring) * static_cast<double>(cellSize);
+		double bottom = (cy - ring + 1) * static_cast<double>(cellSize);
+		double top = (cy + ring) * static_cast<double>(cellSize);
+		double dx = std::min(x - left, right - x);
+		double dy = std::min(y - bottom, top - y);
+		return std::max(0.0, std::min(dx, dy));
+	}
+};
+
+// Равномерная сетка по окну, точки лежат подряд по ячейкам (cellStart - смещения ячеек)
+class SpatialGrid
+{
+private:
+	int cellSize = 16;
+	int columns = 0;
+	int rows = 0;
+	std::vector<std::uint32_t> cellStart;
+	std::vector<std::uint32_t> order;
+	std::vector<Point2d> points;
+
+public:
+	SpatialGrid() {}
+
+	SpatialGrid(const std::vector<Point2d>& points, int cellSize = 16, int width = screenWidth, int height = screenHeight)
+	{
+		build(points, cellSize, width, height);
+	}
+
+	void build(const std::vector<Point2d>& points, int cellSize = 16, int width = screenWidth, int height = screenHeight)
+	{
+		if (cellSize <= 0)
+		{
+			throw std::invalid_argument("Размер ячейки должен быть положительным");
+		}
+
+		this->cellSize = cellSize;
+		this->points = points;
+		columns = (width + cellSize - 1) / cellSize;
+		rows = (height + cellSize - 1) / cellSize;
+
+		cellStart.assign(static_cast<std::size_t>(columns) * rows + 1, 0);
+		for (const Point2d& p : points)
+		{
+			cellStart[cellOf(p) + 1]++;
+		}
+		for (std::size_t c = 1; c < cellStart.size(); c++)
+		{
+			cellStart[c] += cellStart[c - 1];
+		}
+
+		order.resize(points.size());
+		std::vector<std::uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+		for (std::size_t i = 0; i < points.size(); i++)
+		{
+			order[fill[cellOf(points[i])]++] = static_cast<std::uint32_t>(i);
+		}
+	}
+
+	// Размер ячейки, при котором в ячейку попадает около pointsPerCell точек
+	static int suggestedCellSize(std::size_t count, double pointsPerCell = 4, int width = screenWidth, int height = screenHeight)
+	{
+		if (count == 0)
+		{
+			return 16;
+		}
+		double side = std::sqrt(static_cast<double>(width) * height * pointsPerCell / count);
+		return std::clamp(static_cast<int>(side), 1, std::max(width, height));
+	}
+
+	int getCellSize() const { return cellSize; }
+	int getColumns() const { return columns; }
+	int getRows() const { return rows; }
+	std::size_t size() const { return points.size(); }
+	const std::vector<Point2d>& getPoints() const { return points; }
+	const std::vector<std::uint32_t>& getCellStart() const { return cellStart; }
+	const std::vector<std::uint32_t>& getOrder() const { return order; }
+
+	SpatialGridView view() const
+	{
+		return SpatialGridView{ cellSize, columns, rows, cellStart.data(), order.data(), points.data(), points.size() };
+	}
+
+	long long nearest(double x, double y, double maxDistance = std::numeric_limits<double>::infinity(), double* distance2 = nullptr) const
+	{
+		return view().nearest(x, y, maxDistance, distance2);
+	}
+
+	void nearestBatch(const int* x, const int* y, long long* out, std::size_t n,
+		double maxDistance = std::numeric_limits<double>::infinity()) const
+	{
+		view().nearestBatch(x, y, out, n, maxDistance);
+	}
+
+	std::vector<std::uint32_t> range(int x0, int y0, int x1, int y1) const
+	{
+		return view().range(x0, y0, x1, y1);
+	}
+
+private:
+	std::size_t cellOf(const Point2d& p) const
+	{
+		int gx = std::min(p.getX() / cellSize, columns - 1);
+		int gy = std::min(p.getY() / cellSize, rows - 1);
+		return static_cast<std::size_t>(gy) * columns + gx;
+	}
+};
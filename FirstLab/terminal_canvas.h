@@ -0,0 +1,305 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "geometry.h"
+#include "console.h"
+
+// Холст в символах Брайля: каждая клетка терминала - 2x4 точки, область screenWidth x screenHeight
+// масштабируется на весь холст, ось y направлена вверх, как у Point2d. present() выводит только клетки,
+// изменившиеся с прошлого кадра, поэтому живой график из тысяч векторов перерисовывает лишь то, что сдвинулось.
+class TerminalCanvas
+{
+private:
+	struct Cell
+	{
+		std::uint8_t dots = 0;
+		Color color = Color::BrightWhite;
+
+		bool operator==(const Cell& other) const { return dots == other.dots && (dots == 0 || color == other.color); }
+		bool operator!=(const Cell& other) const { return !(*this == other); }
+	};
+
+	int columns;
+	int rows;
+	int viewWidth;
+	int viewHeight;
+	std::vector<Cell> cells;
+	std::vector<Cell> shown;
+	std::vector<std::uint8_t> dirtyRows;
+	bool shownValid = false;
+
+public:
+	TerminalCanvas(int columns = 80, int rows = 24, int viewWidth = screenWidth, int viewHeight = screenHeight)
+		: columns(columns), rows(rows), viewWidth(viewWidth), viewHeight(viewHeight)
+	{
+		if (columns <= 0 || rows <= 0 || viewWidth <= 0 || viewHeight <= 0)
+		{
+			throw std::invalid_argument("Размеры холста должны быть положительными");
+		}
+		cells.resize(static_cast<std::size_t>(columns) * rows);
+		shown.resize(cells.size());
+		dirtyRows.assign(rows, 1);
+	}
+
+	int getColumns() const { return columns; }
+	int getRows() const { return rows; }
+	int pixelWidth() const { return columns * 2; }
+	int pixelHeight() const { return rows * 4; }
+
+	// Стирает кадр; на экране исчезнет только то, что не будет нарисовано заново
+	void clear()
+	{
+		for (int row = 0; row < rows; row++)
+		{
+			Cell* line = &cells[static_cast<std::size_t>(row) * columns];
+			for (int column = 0; column < columns; column++)
+			{
+				if (line[column].dots)
+				{
+					line[column] = Cell();
+					dirtyRows[row] = 1;
+				}
+			}
+		}
+	}
+
+	// Точка в координатах холста (точки Брайля)
+	void plot(int px, int py, Color color = Color::BrightWhite)
+	{
+		if (px < 0 || py < 0 || px >= pixelWidth() || py >= pixelHeight())
+		{
+			return;
+		}
+		static const std::uint8_t bits[4][2] = { { 0x01, 0x08 }, { 0x02, 0x10 }, { 0x04, 0x20 }, { 0x40, 0x80 } };
+		Cell& cell = cells[static_cast<std::size_t>(py / 4) * columns + px / 2];
+		cell.dots |= bits[py % 4][px % 2];
+		cell.color = color;
+		dirtyRows[py / 4] = 1;
+	}
+
+	// Отрезок Брезенхэма в координатах холста
+	void line(int x0, int y0, int x1, int y1, Color color = Color::BrightWhite)
+	{
+		const int dx = std::abs(x1 - x0);
+		const int dy = -std::abs(y1 - y0);
+		const int sx = x0 < x1 ? 1 : -1;
+		const int sy = y0 < y1 ? 1 : -1;
+		int error = dx + dy;
+		while (true)
+		{
+			plot(x0, y0, color);
+			if (x0 == x1 && y0 == y1)
+			{
+				break;
+			}
+			const int doubled = 2 * error;
+			if (doubled >= dy)
+			{
+				error += dy;
+				x0 += sx;
+			}
+			if (doubled <= dx)
+			{
+				error += dx;
+				y0 += sy;
+			}
+		}
+	}
+
+	// Точек холста на единицу координат окна по горизонтали
+	double dotsPerUnit() const { return static_cast<double>(pixelWidth()) / viewWidth; }
+
+	// Координаты окна (начало в левом нижнем углу) в точки холста (строка 0 сверху)
+	int toPixelX(double x) const
+	{
+		return static_cast<int>(std::floor(x * pixelWidth() / viewWidth));
+	}
+
+	int toPixelY(double y) const
+	{
+		return static_cast<int>(std::floor((viewHeight - 1 - y) * pixelHeight() / viewHeight));
+	}
+
+	// Точка в координатах окна без проверки границ: все, что вне холста, отсекается
+	void plotView(double x, double y, Color color = Color::BrightWhite)
+	{
+		plot(toPixelX(x), toPixelY(y), color);
+	}
+
+	void point(const Point2d& p, Color color = Color::BrightWhite)
+	{
+		plot(toPixelX(p.getX()), toPixelY(p.getY()), color);
+	}
+
+	void segment(const Point2d& a, const Point2d& b, Color color = Color::BrightWhite)
+	{
+		line(toPixelX(a.getX()), toPixelY(a.getY()), toPixelX(b.getX()), toPixelY(b.getY()), color);
+	}
+
+	void polyline(const std::vector<Point2d>& points, Color color = Color::BrightWhite, bool closed = false)
+	{
+		for (std::size_t i = 1; i < points.size(); i++)
+		{
+			segment(points[i - 1], points[i], color);
+		}
+		if (closed && points.size() > 2)
+		{
+			segment(points.back(), points.front(), color);
+		}
+	}
+
+	// Вектор v, отложенный от точки origin, с наконечником из двух штрихов
+	void arrow(const Point2d& origin, const Vector2d& v, Color color = Color::BrightWhite)
+	{
+		const int x0 = toPixelX(origin.getX());
+		const int y0 = toPixelY(origin.getY());
+		const int x1 = toPixelX(origin.getX() + v.getCoordX());
+		const int y1 = toPixelY(origin.getY() + v.getCoordY());
+		line(x0, y0, x1, y1, color);
+
+		const double length = std::hypot(x1 - x0, y1 - y0);
+		if (length < 2)
+		{
+			return;
+		}
+		const double head = std::min(4.0, length / 3);
+		const double ux = (x0 - x1) / length;
+		const double uy = (y0 - y1) / length;
+		const double c = std::cos(0.5);
+		const double s = std::sin(0.5);
+		line(x1, y1, x1 + static_cast<int>(std::lround(head * (ux * c - uy * s))), y1 + static_cast<int>(std::lround(head * (ux * s + uy * c))), color);
+		line(x1, y1, x1 + static_cast<int>(std::lround(head * (ux * c + uy * s))), y1 + static_cast<int>(std::lround(head * (uy * c - ux * s))), color);
+	}
+
+	// Число клеток, которые выведет следующий present()
+	std::size_t changedCells() const
+	{
+		if (!shownValid)
+		{
+			return cells.size();
+		}
+		std::size_t changed = 0;
+		for (int row = 0; row < rows; row++)
+		{
+			if (!dirtyRows[row])
+			{
+				continue;
+			}
+			for (int column = 0; column < columns; column++)
+			{
+				const std::size_t i = static_cast<std::size_t>(row) * columns + column;
+				changed += cells[i] != shown[i];
+			}
+		}
+		return changed;
+	}
+
+	// Выводит изменения в консоль начиная с (line, column); возвращает число выведенных клеток.
+	// Подряд идущие изменения одного цвета уходят одной строкой без лишних перемещений курсора.
+	std::size_t present(int line = 0, int column = 0)
+	{
+		Console::enableUtf8();
+		std::size_t emitted = 0;
+		bool colorKnown = false;
+		Color current = Color::BrightWhite;
+		std::string run;
+		for (int row = 0; row < rows; row++)
+		{
+			if (shownValid && !dirtyRows[row])
+			{
+				continue;
+			}
+			dirtyRows[row] = 0;
+			const std::size_t base = static_cast<std::size_t>(row) * columns;
+			int x = 0;
+			while (x < columns)
+			{
+				if (shownValid && cells[base + x] == shown[base + x])
+				{
+					x++;
+					continue;
+				}
+				Console::setCursor(line + row, column + x);
+				while (x < columns && (!shownValid || cells[base + x] != shown[base + x]))
+				{
+					const Cell& cell = cells[base + x];
+					if (cell.dots && (!colorKnown || cell.color != current))
+					{
+						Console::write(run);
+						run.clear();
+						Console::setColor(cell.color);
+						current = cell.color;
+						colorKnown = true;
+					}
+					appendCell(run, cell);
+					shown[base + x] = cell;
+					emitted++;
+					x++;
+				}
+				Console::write(run);
+				run.clear();
+			}
+		}
+		shownValid = true;
+		if (colorKnown)
+		{
+			Console::resetColor();
+		}
+		Console::flush();
+		return emitted;
+	}
+
+	// Следующий present() перерисует весь холст (например, после очистки экрана)
+	void invalidate()
+	{
+		shownValid = false;
+		std::fill(dirtyRows.begin(), dirtyRows.end(), 1);
+	}
+
+	// Считать текущий кадр уже показанным, например после вывода toString()
+	void markPresented()
+	{
+		shown = cells;
+		std::fill(dirtyRows.begin(), dirtyRows.end(), 0);
+		shownValid = true;
+	}
+
+	// Кадр целиком строками UTF-8 без цвета
+	std::string toString() const
+	{
+		std::string text;
+		text.reserve(cells.size() * 3 + rows);
+		for (int row = 0; row < rows; row++)
+		{
+			for (int column = 0; column < columns; column++)
+			{
+				appendCell(text, cells[static_cast<std::size_t>(row) * columns + column]);
+			}
+			text += '\n';
+		}
+		return text;
+	}
+
+private:
+	// Пустая клетка - пробел, иначе символ U+2800 + маска точек в UTF-8
+	static void appendCell(std::string& text, const Cell& cell)
+	{
+		if (!cell.dots)
+		{
+			text += ' ';
+			return;
+		}
+		const unsigned code = 0x2800u + cell.dots;
+		text += static_cast<char>(0xE0 | (code >> 12));
+		text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+		text += static_cast<char>(0x80 | (code & 0x3F));
+	}
+};
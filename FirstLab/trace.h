@@ -0,0 +1,194 @@
+﻿#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Трассировка этапов в формате Chrome trace-event (chrome://tracing, Perfetto).
+// Каждый поток пишет в свой буфер без блокировок, завершившийся поток отдает буфер следующему; выключенный трассировщик стоит одну загрузку атомика.
+// Сборка с -DGEOMETRY_NO_TRACE убирает TRACE_SCOPE совсем.
+
+struct TraceEvent
+{
+	const char* name;
+	const char* category;
+	double start;
+	double duration;
+};
+
+class Tracer
+{
+private:
+	struct ThreadBuffer
+	{
+		std::uint32_t tid;
+		std::vector<TraceEvent> events;
+	};
+
+	std::atomic<bool> enabled{ false };
+	std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+	std::mutex registration;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	std::vector<ThreadBuffer*> freeBuffers;
+
+	// Буфер занят потоком до его завершения, потом возвращается в запас вместе с событиями.
+	// parallelFor заводит новые потоки на каждый вызов, так что буферов столько, сколько потоков
+	// жило одновременно, а дорожка tid в трассе - это слот, который потоки занимают по очереди
+	struct BufferLease
+	{
+		Tracer* tracer = nullptr;
+		ThreadBuffer* buffer = nullptr;
+
+		~BufferLease()
+		{
+			if (buffer)
+			{
+				std::lock_guard<std::mutex> lock(tracer->registration);
+				tracer->freeBuffers.push_back(buffer);
+			}
+		}
+	};
+
+	Tracer() {}
+
+public:
+	static Tracer& instance()
+	{
+		static Tracer tracer;
+		return tracer;
+	}
+
+	bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+	void enable() { enabled.store(true, std::memory_order_relaxed); }
+	void disable() { enabled.store(false, std::memory_order_relaxed); }
+
+	double now() const
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+	}
+
+	// name и category должны жить до экспорта (обычно строковые литералы)
+	void record(const char* name, const char* category, double start, double duration)
+	{
+		threadBuffer().events.push_back({ name, category, start, duration });
+	}
+
+	// Вызывать после disable() и завершения трассируемых потоков
+	bool writeChromeTrace(const std::string& path)
+	{
+		std::lock_guard<std::mutex> lock(registration);
+		std::ofstream out(path);
+		out << std::fixed << std::setprecision(3);
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		for (const std::unique_ptr<ThreadBuffer>& buffer : buffers)
+		{
+			for (const TraceEvent& event : buffer->events)
+			{
+				out << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"" << event.category
+					<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+					<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+				first = false;
+			}
+		}
+		out << "\n]}\n";
+		return static_cast<bool>(out);
+	}
+
+private:
+	ThreadBuffer& threadBuffer()
+	{
+		thread_local BufferLease lease;
+		if (!lease.buffer)
+		{
+			std::lock_guard<std::mutex> lock(registration);
+			if (!freeBuffers.empty())
+			{
+				lease.buffer = freeBuffers.back();
+				freeBuffers.pop_back();
+			}
+			else
+			{
+				buffers.push_back(std::make_unique<ThreadBuffer>());
+				lease.buffer = buffers.back().get();
+				lease.buffer->tid = static_cast<std::uint32_t>(buffers.size());
+				lease.buffer->events.reserve(1024);
+			}
+			lease.tracer = this;
+		}
+		return *lease.buffer;
+	}
+};
+
+class TraceScope
+{
+private:
+	const char* name;
+	const char* category;
+	double start = -1;
+
+public:
+	TraceScope(const char* name, const char* category) : name(name), category(category)
+	{
+		if (Tracer::instance().isEnabled())
+		{
+			start = Tracer::instance().now();
+		}
+	}
+
+	~TraceScope()
+	{
+		if (start >= 0)
+		{
+			Tracer& tracer = Tracer::instance();
+			tracer.record(name, category, start, tracer.now() - start);
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+};
+
+// Включает трассировку, если задан путь, и пишет файл при выходе из области видимости
+class TraceSession
+{
+private:
+	std::string path;
+
+public:
+	explicit TraceSession(const char* path) : path(path ? path : "")
+	{
+		if (!this->path.empty())
+		{
+			Tracer::instance().enable();
+		}
+	}
+
+	~TraceSession()
+	{
+		if (!path.empty())
+		{
+			Tracer::instance().disable();
+			Tracer::instance().writeChromeTrace(path);
+		}
+	}
+
+	TraceSession(const TraceSession&) = delete;
+	TraceSession& operator=(const TraceSession&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef GEOMETRY_NO_TRACE
+#define TRACE_SCOPE(name, category)
+#else
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name, category)
+#endif
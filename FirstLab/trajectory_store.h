@@ -0,0 +1,450 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "geometry.h"
+
+// Хранилище траекторий: для каждого объекта последовательность (время, Point2d) по кускам.
+// Заполненный кусок сжимается по столбцам: время - разностями второго порядка, координаты - разностями.
+// Разности упакованы фиксированной для куска шириной 1, 2, 4 или 8 байт, поэтому распаковка -
+// простой цикл без ветвлений, который компилятор векторизует.
+
+struct TrajectorySample
+{
+	std::int64_t time;
+	Point2d point;
+};
+
+struct TrajectoryHit
+{
+	std::uint32_t object;
+	std::int64_t time;
+	Point2d point;
+};
+
+namespace trajectory_detail
+{
+	inline std::uint64_t zigzag(std::int64_t value)
+	{
+		return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+	}
+
+	inline std::int64_t unzigzag(std::uint64_t value)
+	{
+		return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+	}
+
+	// Столбец целых одинаковой ширины
+	class PackedColumn
+	{
+	private:
+		std::uint8_t width = 1;
+		std::vector<std::uint8_t> bytes;
+
+		template <class U>
+		void pack(const std::vector<std::uint64_t>& values)
+		{
+			for (std::size_t i = 0; i < values.size(); i++)
+			{
+				const U value = static_cast<U>(values[i]);
+				std::memcpy(bytes.data() + i * sizeof(U), &value, sizeof(U));
+			}
+		}
+
+		template <class U>
+		void unpack(std::int64_t* out, std::size_t count) const
+		{
+			const std::uint8_t* source = bytes.data();
+			for (std::size_t i = 0; i < count; i++)
+			{
+				U value;
+				std::memcpy(&value, source + i * sizeof(U), sizeof(U));
+				out[i] = unzigzag(value);
+			}
+		}
+
+	public:
+		PackedColumn() {}
+
+		explicit PackedColumn(const std::vector<std::int64_t>& values)
+		{
+			std::vector<std::uint64_t> encoded(values.size());
+			std::uint64_t largest = 0;
+			for (std::size_t i = 0; i < values.size(); i++)
+			{
+				encoded[i] = zigzag(values[i]);
+				largest = std::max(largest, encoded[i]);
+			}
+			width = largest <= UINT8_MAX ? 1 : largest <= UINT16_MAX ? 2 : largest <= UINT32_MAX ? 4 : 8;
+			bytes.resize(values.size() * width);
+			switch (width)
+			{
+			case 1: pack<std::uint8_t>(encoded); break;
+			case 2: pack<std::uint16_t>(encoded); break;
+			case 4: pack<std::uint32_t>(encoded); break;
+			default: pack<std::uint64_t>(encoded); break;
+			}
+		}
+
+		void decode(std::int64_t* out, std::size_t count) const
+		{
+			switch (width)
+			{
+			case 1: unpack<std::uint8_t>(out, count); break;
+			case 2: unpack<std::uint16_t>(out, count); break;
+			case 4: unpack<std::uint32_t>(out, count); break;
+			default: unpack<std::uint64_t>(out, count); break;
+			}
+		}
+
+		std::size_t byteSize() const { return bytes.size(); }
+	};
+}
+
+class TrajectoryStore
+{
+public:
+	static constexpr std::size_t chunkSize = 256;
+
+private:
+	// Границы куска по времени и по координатам - по ним куски отсеиваются без распаковки
+	struct ChunkInfo
+	{
+		std::int64_t firstTime = 0;
+		std::int64_t lastTime = 0;
+		int minX = INT_MAX;
+		int minY = INT_MAX;
+		int maxX = INT_MIN;
+		int maxY = INT_MIN;
+		std::size_t count = 0;
+	};
+
+	struct SealedChunk
+	{
+		ChunkInfo info;
+		std::int64_t baseTime;
+		std::int64_t baseDelta;
+		int baseX;
+		int baseY;
+		trajectory_detail::PackedColumn times;  // разности второго порядка, начиная с третьего отсчета
+		trajectory_detail::PackedColumn xs;     // разности, начиная со второго отсчета
+		trajectory_detail::PackedColumn ys;
+	};
+
+	// Незаполненный кусок хранится как есть в массиве фиксированного размера: добавление не выделяет память
+	struct Track
+	{
+		std::deque<SealedChunk> sealed;
+		ChunkInfo openInfo;
+		std::array<std::int64_t, chunkSize> openTimes;
+		std::array<int, chunkSize> openX;
+		std::array<int, chunkSize> openY;
+	};
+
+	std::vector<std::unique_ptr<Track>> tracks;
+
+public:
+	TrajectoryStore() {}
+
+	// Время у одного объекта не должно убывать
+	void append(std::uint32_t object, std::int64_t time, const Point2d& p)
+	{
+		if (object >= tracks.size())
+		{
+			tracks.resize(object + 1);
+		}
+		if (!tracks[object])
+		{
+			tracks[object] = std::make_unique<Track>();
+		}
+		Track& track = *tracks[object];
+		const bool hasPrevious = track.openInfo.count > 0 || !track.sealed.empty();
+		const std::int64_t previous = track.openInfo.count > 0 ? track.openInfo.lastTime : hasPrevious ? track.sealed.back().info.lastTime : 0;
+		if (hasPrevious && time < previous)
+		{
+			throw std::invalid_argument("Время отсчетов объекта должно не убывать");
+		}
+
+		ChunkInfo& info = track.openInfo;
+		const std::size_t i = info.count;
+		track.openTimes[i] = time;
+		track.openX[i] = p.getX();
+		track.openY[i] = p.getY();
+		if (i == 0)
+		{
+			info.firstTime = time;
+		}
+		info.lastTime = time;
+		info.minX = std::min(info.minX, p.getX());
+		info.minY = std::min(info.minY, p.getY());
+		info.maxX = std::max(info.maxX, p.getX());
+		info.maxY = std::max(info.maxY, p.getY());
+		info.count++;
+		if (info.count == chunkSize)
+		{
+			seal(track);
+		}
+	}
+
+	std::size_t objectCount() const { return tracks.size(); }
+
+	std::size_t size(std::uint32_t object) const
+	{
+		if (object >= tracks.size() || !tracks[object])
+		{
+			return 0;
+		}
+		return tracks[object]->sealed.size() * chunkSize + tracks[object]->openInfo.count;
+	}
+
+	// Отсчеты объекта с временем в [from, to]
+	std::vector<TrajectorySample> range(std::uint32_t object, std::int64_t from, std::int64_t to) const
+	{
+		std::vector<TrajectorySample> result;
+		if (object >= tracks.size() || !tracks[object])
+		{
+			return result;
+		}
+		std::vector<std::int64_t> times, xs, ys;
+		forEachChunk(*tracks[object], from, to, times, xs, ys, [&](std::size_t count)
+		{
+			for (std::size_t i = 0; i < count; i++)
+			{
+				if (times[i] >= from && times[i] <= to)
+				{
+					result.push_back({ times[i], makePoint(xs[i], ys[i]) });
+				}
+			}
+		}, anyChunk);
+		return result;
+	}
+
+	// Отсчеты всех объектов в прямоугольнике [x0, x1] x [y0, y1] за время [from, to]
+	std::vector<TrajectoryHit> inBox(int x0, int y0, int x1, int y1, std::int64_t from, std::int64_t to) const
+	{
+		std::vector<TrajectoryHit> result;
+		std::vector<std::int64_t> times, xs, ys;
+		for (std::uint32_t object = 0; object < tracks.size(); object++)
+		{
+			if (!tracks[object])
+			{
+				continue;
+			}
+			forEachChunk(*tracks[object], from, to, times, xs, ys, [&](std::size_t count)
+			{
+				for (std::size_t i = 0; i < count; i++)
+				{
+					if (times[i] >= from && times[i] <= to && xs[i] >= x0 && xs[i] <= x1 && ys[i] >= y0 && ys[i] <= y1)
+					{
+						result.push_back({ object, times[i], makePoint(xs[i], ys[i]) });
+					}
+				}
+			}, [x0, y0, x1, y1](const ChunkInfo& info)
+			{
+				return info.maxX >= x0 && info.minX <= x1 && info.maxY >= y0 && info.minY <= y1;
+			});
+		}
+		return result;
+	}
+
+	// Положения в моменты from, from + step, ... (count штук) линейной интерполяцией между соседними
+	// отсчетами; до первого и после последнего отсчета - крайнее положение
+	std::vector<Point2d> resample(std::uint32_t object, std::int64_t from, std::int64_t step, std::size_t count) const
+	{
+		if (step <= 0)
+		{
+			throw std::invalid_argument("Шаг по времени должен быть положительным");
+		}
+		std::vector<Point2d> result;
+		if (count == 0 || size(object) == 0)
+		{
+			return result;
+		}
+		const std::int64_t to = from + step * static_cast<std::int64_t>(count - 1);
+
+		// отсчеты в [from, to] и по одному соседу снаружи с каждой стороны
+		std::vector<TrajectorySample> samples;
+		std::vector<std::int64_t> times, xs, ys;
+		const Track& track = *tracks[object];
+		forEachChunk(track, from, to, times, xs, ys, [&](std::size_t n)
+		{
+			for (std::size_t i = 0; i < n; i++)
+			{
+				if (times[i] < from)
+				{
+					samples.assign(1, { times[i], makePoint(xs[i], ys[i]) });
+				}
+				else if (times[i] <= to || samples.empty() || samples.back().time <= to)
+				{
+					samples.push_back({ times[i], makePoint(xs[i], ys[i]) });
+				}
+			}
+		}, anyChunk, true);
+
+		std::size_t next = 0;
+		for (std::size_t k = 0; k < count; k++)
+		{
+			const std::int64_t time = from + step * static_cast<std::int64_t>(k);
+			while (next < samples.size() && samples[next].time <= time)
+			{
+				next++;
+			}
+			if (next == 0)
+			{
+				result.push_back(samples.front().point);
+			}
+			else if (next == samples.size())
+			{
+				result.push_back(samples.back().point);
+			}
+			else
+			{
+				const TrajectorySample& a = samples[next - 1];
+				const TrajectorySample& b = samples[next];
+				const double t = static_cast<double>(time - a.time) / static_cast<double>(b.time - a.time);
+				result.push_back(makePoint(std::lround(a.point.getX() + (b.point.getX() - a.point.getX()) * t),
+					std::lround(a.point.getY() + (b.point.getY() - a.point.getY()) * t)));
+			}
+		}
+		return result;
+	}
+
+	// Объем сжатых кусков и незаполненных буферов в байтах
+	std::size_t memoryBytes() const
+	{
+		std::size_t bytes = 0;
+		for (const auto& track : tracks)
+		{
+			if (!track)
+			{
+				continue;
+			}
+			bytes += sizeof(Track);
+			for (const SealedChunk& chunk : track->sealed)
+			{
+				bytes += sizeof(SealedChunk) + chunk.times.byteSize() + chunk.xs.byteSize() + chunk.ys.byteSize();
+			}
+		}
+		return bytes;
+	}
+
+private:
+	static Point2d makePoint(std::int64_t x, std::int64_t y)
+	{
+		return Point2d(static_cast<int>(x), static_cast<int>(y), INT_MAX, INT_MAX);
+	}
+
+	static void seal(Track& track)
+	{
+		const std::size_t count = track.openInfo.count;
+		SealedChunk chunk;
+		chunk.info = track.openInfo;
+		chunk.baseTime = track.openTimes[0];
+		chunk.baseDelta = count > 1 ? track.openTimes[1] - track.openTimes[0] : 0;
+		chunk.baseX = track.openX[0];
+		chunk.baseY = track.openY[0];
+
+		std::vector<std::int64_t> values;
+		for (std::size_t i = 2; i < count; i++)
+		{
+			values.push_back((track.openTimes[i] - track.openTimes[i - 1]) - (track.openTimes[i - 1] - track.openTimes[i - 2]));
+		}
+		chunk.times = trajectory_detail::PackedColumn(values);
+		values.clear();
+		for (std::size_t i = 1; i < count; i++)
+		{
+			values.push_back(static_cast<std::int64_t>(track.openX[i]) - track.openX[i - 1]);
+		}
+		chunk.xs = trajectory_detail::PackedColumn(values);
+		values.clear();
+		for (std::size_t i = 1; i < count; i++)
+		{
+			values.push_back(static_cast<std::int64_t>(track.openY[i]) - track.openY[i - 1]);
+		}
+		chunk.ys = trajectory_detail::PackedColumn(values);
+
+		track.sealed.push_back(std::move(chunk));
+		track.openInfo = ChunkInfo();
+	}
+
+	// Распаковка: сначала разности из упакованных столбцов, потом префиксные суммы
+	static std::size_t decode(const SealedChunk& chunk, std::vector<std::int64_t>& times, std::vector<std::int64_t>& xs, std::vector<std::int64_t>& ys)
+	{
+		const std::size_t count = chunk.info.count;
+		times.resize(count);
+		xs.resize(count);
+		ys.resize(count);
+		times[0] = chunk.baseTime;
+		xs[0] = chunk.baseX;
+		ys[0] = chunk.baseY;
+		if (count > 2)
+		{
+			chunk.times.decode(times.data() + 2, count - 2);
+		}
+		chunk.xs.decode(xs.data() + 1, count - 1);
+		chunk.ys.decode(ys.data() + 1, count - 1);
+
+		std::int64_t delta = chunk.baseDelta;
+		if (count > 1)
+		{
+			times[1] = times[0] + delta;
+		}
+		for (std::size_t i = 2; i < count; i++)
+		{
+			delta += times[i];
+			times[i] = times[i - 1] + delta;
+		}
+		for (std::size_t i = 1; i < count; i++)
+		{
+			xs[i] += xs[i - 1];
+			ys[i] += ys[i - 1];
+		}
+		return count;
+	}
+
+	static bool anyChunk(const ChunkInfo&) { return true; }
+
+	// Распаковывает в times/xs/ys куски, пересекающие [from, to] и прошедшие filter, и для каждого вызывает
+	// body(count). С withNeighbors добавляются еще ближайшие куски до и после интервала
+	template <class Body, class Filter>
+	static void forEachChunk(const Track& track, std::int64_t from, std::int64_t to, std::vector<std::int64_t>& times,
+		std::vector<std::int64_t>& xs, std::vector<std::int64_t>& ys, Body body, Filter filter, bool withNeighbors = false)
+	{
+		// куски упорядочены по времени, границы ищутся двоичным поиском
+		std::size_t first = std::lower_bound(track.sealed.begin(), track.sealed.end(), from,
+			[](const SealedChunk& chunk, std::int64_t time) { return chunk.info.lastTime < time; }) - track.sealed.begin();
+		std::size_t last = std::upper_bound(track.sealed.begin(), track.sealed.end(), to,
+			[](std::int64_t time, const SealedChunk& chunk) { return time < chunk.info.firstTime; }) - track.sealed.begin();
+		if (withNeighbors)
+		{
+			first = first > 0 ? first - 1 : 0;
+			last = std::min(last + 1, track.sealed.size());
+		}
+
+		for (std::size_t c = first; c < last; c++)
+		{
+			if (filter(track.sealed[c].info))
+			{
+				body(decode(track.sealed[c], times, xs, ys));
+			}
+		}
+
+		const ChunkInfo& open = track.openInfo;
+		if (open.count > 0 && (withNeighbors || (open.lastTime >= from && open.firstTime <= to)) && filter(open))
+		{
+			times.assign(track.openTimes.begin(), track.openTimes.begin() + open.count);
+			xs.assign(track.openX.begin(), track.openX.begin() + open.count);
+			ys.assign(track.openY.begin(), track.openY.begin() + open.count);
+			body(open.count);
+		}
+	}
+};
@@ -0,0 +1,381 @@
+﻿#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VECTOR_N_SSE2 1
+#include <immintrin.h>
+#endif
+
+#include "geometry.h"
+
+// Операции над N компонентами. Общий вариант - циклы фиксированной длины,
+// ниже явные специализации на SSE/AVX для float и int при N = 2, 4, 8.
+template <class T, std::size_t N>
+struct VectorKernels
+{
+	static void add(const T* a, const T* b, T* out)
+	{
+		for (std::size_t i = 0; i < N; i++)
+		{
+			out[i] = a[i] + b[i];
+		}
+	}
+
+	static void sub(const T* a, const T* b, T* out)
+	{
+		for (std::size_t i = 0; i < N; i++)
+		{
+			out[i] = a[i] - b[i];
+		}
+	}
+
+	static void scale(const T* a, T k, T* out)
+	{
+		for (std::size_t i = 0; i < N; i++)
+		{
+			out[i] = a[i] * k;
+		}
+	}
+
+	static T dot(const T* a, const T* b)
+	{
+		T sum = T();
+		for (std::size_t i = 0; i < N; i++)
+		{
+			sum += a[i] * b[i];
+		}
+		return sum;
+	}
+};
+
+#ifdef VECTOR_N_SSE2
+
+namespace vector_n_detail
+{
+	inline __m128i mullo32(__m128i a, __m128i b)
+	{
+#ifdef __SSE4_1__
+		return _mm_mullo_epi32(a, b);
+#else
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+#endif
+	}
+
+	inline int sum32(__m128i v)
+	{
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+		v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_cvtsi128_si32(v);
+	}
+
+	inline float sumPs(__m128 v)
+	{
+		v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(v);
+	}
+
+	// Загрузка 2 или 4 элементов в один регистр, старшие полосы при N = 2 нулевые
+	template <std::size_t N>
+	inline __m128i loadInt(const int* p)
+	{
+		if constexpr (N == 2)
+		{
+			return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+		}
+		else
+		{
+			return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+		}
+	}
+
+	template <std::size_t N>
+	inline void storeInt(int* p, __m128i v)
+	{
+		if constexpr (N == 2)
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(p), v);
+		}
+		else
+		{
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+		}
+	}
+
+	template <std::size_t N>
+	inline __m128 loadFloat(const float* p)
+	{
+		if constexpr (N == 2)
+		{
+			return _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)));
+		}
+		else
+		{
+			return _mm_loadu_ps(p);
+		}
+	}
+
+	template <std::size_t N>
+	inline void storeFloat(float* p, __m128 v)
+	{
+		if constexpr (N == 2)
+		{
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(p), _mm_castps_si128(v));
+		}
+		else
+		{
+			_mm_storeu_ps(p, v);
+		}
+	}
+
+	template <std::size_t N>
+	struct IntKernels
+	{
+		static void add(const int* a, const int* b, int* out) { storeInt<N>(out, _mm_add_epi32(loadInt<N>(a), loadInt<N>(b))); }
+		static void sub(const int* a, const int* b, int* out) { storeInt<N>(out, _mm_sub_epi32(loadInt<N>(a), loadInt<N>(b))); }
+		static void scale(const int* a, int k, int* out) { storeInt<N>(out, mullo32(loadInt<N>(a), _mm_set1_epi32(k))); }
+		static int dot(const int* a, const int* b) { return sum32(mullo32(loadInt<N>(a), loadInt<N>(b))); }
+	};
+
+	template <std::size_t N>
+	struct FloatKernels
+	{
+		static void add(const float* a, const float* b, float* out) { storeFloat<N>(out, _mm_add_ps(loadFloat<N>(a), loadFloat<N>(b))); }
+		static void sub(const float* a, const float* b, float* out) { storeFloat<N>(out, _mm_sub_ps(loadFloat<N>(a), loadFloat<N>(b))); }
+		static void scale(const float* a, float k, float* out) { storeFloat<N>(out, _mm_mul_ps(loadFloat<N>(a), _mm_set1_ps(k))); }
+		static float dot(const float* a, const float* b) { return sumPs(_mm_mul_ps(loadFloat<N>(a), loadFloat<N>(b))); }
+	};
+}
+
+template <> struct VectorKernels<int, 2> : vector_n_detail::IntKernels<2> {};
+template <> struct VectorKernels<int, 4> : vector_n_detail::IntKernels<4> {};
+template <> struct VectorKernels<float, 2> : vector_n_detail::FloatKernels<2> {};
+template <> struct VectorKernels<float, 4> : vector_n_detail::FloatKernels<4> {};
+
+#ifdef __AVX__
+template <>
+struct VectorKernels<float, 8>
+{
+	static void add(const float* a, const float* b, float* out) { _mm256_storeu_ps(out, _mm256_add_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b))); }
+	static void sub(const float* a, const float* b, float* out) { _mm256_storeu_ps(out, _mm256_sub_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b))); }
+	static void scale(const float* a, float k, float* out) { _mm256_storeu_ps(out, _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_set1_ps(k))); }
+
+	static float dot(const float* a, const float* b)
+	{
+		__m256 m = _mm256_mul_ps(_mm256_loadu_ps(a), _mm256_loadu_ps(b));
+		return vector_n_detail::sumPs(_mm_add_ps(_mm256_castps256_ps128(m), _mm256_extractf128_ps(m, 1)));
+	}
+};
+#else
+// без AVX - две половины по 4 полосы
+template <>
+struct VectorKernels<float, 8>
+{
+	using Half = VectorKernels<float, 4>;
+	static void add(const float* a, const float* b, float* out) { Half::add(a, b, out); Half::add(a + 4, b + 4, out + 4); }
+	static void sub(const float* a, const float* b, float* out) { Half::sub(a, b, out); Half::sub(a + 4, b + 4, out + 4); }
+	static void scale(const float* a, float k, float* out) { Half::scale(a, k, out); Half::scale(a + 4, k, out + 4); }
+	static float dot(const float* a, const float* b) { return Half::dot(a, b) + Half::dot(a + 4, b + 4); }
+};
+#endif
+
+#ifdef __AVX2__
+template <>
+struct VectorKernels<int, 8>
+{
+	static __m256i load(const int* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+	static void store(int* p, __m256i v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+
+	static void add(const int* a, const int* b, int* out) { store(out, _mm256_add_epi32(load(a), load(b))); }
+	static void sub(const int* a, const int* b, int* out) { store(out, _mm256_sub_epi32(load(a), load(b))); }
+	static void scale(const int* a, int k, int* out) { store(out, _mm256_mullo_epi32(load(a), _mm256_set1_epi32(k))); }
+
+	static int dot(const int* a, const int* b)
+	{
+		__m256i m = _mm256_mullo_epi32(load(a), load(b));
+		return vector_n_detail::sum32(_mm_add_epi32(_mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1)));
+	}
+};
+#else
+template <>
+struct VectorKernels<int, 8>
+{
+	using Half = VectorKernels<int, 4>;
+	static void add(const int* a, const int* b, int* out) { Half::add(a, b, out); Half::add(a + 4, b + 4, out + 4); }
+	static void sub(const int* a, const int* b, int* out) { Half::sub(a, b, out); Half::sub(a + 4, b + 4, out + 4); }
+	static void scale(const int* a, int k, int* out) { Half::scale(a, k, out); Half::scale(a + 4, k, out + 4); }
+	static int dot(const int* a, const int* b) { return Half::dot(a, b) + Half::dot(a + 4, b + 4); }
+};
+#endif
+
+#endif
+
+template <class T, std::size_t N>
+constexpr std::size_t vectorAlignment()
+{
+	constexpr std::size_t bytes = sizeof(T) * N;
+	return (bytes & (bytes - 1)) == 0 && bytes <= 32 ? bytes : alignof(T);
+}
+
+template <class T, std::size_t N>
+class alignas(vectorAlignment<T, N>()) VectorN
+{
+	static_assert(N > 0, "VectorN requires at least one component");
+
+private:
+	using Kernels = VectorKernels<T, N>;
+
+	T v[N];
+
+	struct Raw {};
+	explicit VectorN(Raw) {}
+
+public:
+	VectorN() : v{} {}
+
+	template <class... Args>
+		requires (sizeof...(Args) == N && (std::is_convertible_v<Args, T> && ...))
+	VectorN(Args... args) : v{ static_cast<T>(args)... } {}
+
+	// Двумерный целочисленный вектор по координатам должен лежать внутри окна, как и раньше
+	VectorN(int x, int y) requires (N == 2 && std::is_same_v<T, int>)
+	{
+		if (x <= 0 || y <= 0 || x >= screenWidth || y >= screenHeight)
+		{
+			throw std::invalid_argument("Координаты должны быть внутри окна (начало координат левый нижний угол)");
+		}
+
+		v[0] = x;
+		v[1] = y;
+	}
+
+	VectorN(Point2d headPoint, Point2d endPoint) requires (N == 2)
+		: v{ static_cast<T>(headPoint.getX() - endPoint.getX()), static_cast<T>(headPoint.getY() - endPoint.getY()) } {}
+
+	static constexpr std::size_t size() { return N; }
+
+	T& operator[](std::size_t i) { return v[i]; }
+	const T& operator[](std::size_t i) const { return v[i]; }
+
+	T* data() { return v; }
+	const T* data() const { return v; }
+
+	VectorN operator+(const VectorN& other) const
+	{
+		VectorN result{ Raw() };
+		Kernels::add(v, other.v, result.v);
+		return result;
+	}
+
+	VectorN operator-(const VectorN& other) const
+	{
+		VectorN result{ Raw() };
+		Kernels::sub(v, other.v, result.v);
+		return result;
+	}
+
+	VectorN operator*(T k) const
+	{
+		VectorN result{ Raw() };
+		Kernels::scale(v, k, result.v);
+		return result;
+	}
+
+	VectorN operator-() const { return *this * static_cast<T>(-1); }
+
+	VectorN& operator+=(const VectorN& other)
+	{
+		Kernels::add(v, other.v, v);
+		return *this;
+	}
+
+	VectorN& operator-=(const VectorN& other)
+	{
+		Kernels::sub(v, other.v, v);
+		return *this;
+	}
+
+	VectorN& operator*=(T k)
+	{
+		Kernels::scale(v, k, v);
+		return *this;
+	}
+
+	bool operator==(const VectorN& other) const
+	{
+		for (std::size_t i = 0; i < N; i++)
+		{
+			if (v[i] != other.v[i])
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool operator!=(const VectorN& other) const { return !(*this == other); }
+
+	T dot(const VectorN& other) const { return Kernels::dot(v, other.v); }
+
+	T normSquared() const { return dot(*this); }
+
+	double norm() const { return std::sqrt(static_cast<double>(normSquared())); }
+
+	// В 2D векторное произведение - скаляр (z-компонента), в 3D - вектор
+	T cross(const VectorN& other) const requires (N == 2)
+	{
+		return v[0] * other.v[1] - other.v[0] * v[1];
+	}
+
+	VectorN cross(const VectorN& other) const requires (N == 3)
+	{
+		return VectorN(v[1] * other.v[2] - v[2] * other.v[1], v[2] * other.v[0] - v[0] * other.v[2], v[0] * other.v[1] - v[1] * other.v[0]);
+	}
+
+	std::string toString() const
+	{
+		std::string result = "vector(";
+		for (std::size_t i = 0; i < N; i++)
+		{
+			result += (i ? ", " : "") + std::to_string(v[i]);
+		}
+		return result + ")";
+	}
+
+	// Интерфейс Vector2d
+
+	void setCoordX(T coordX) requires (N == 2) { v[0] = coordX; }
+	void setCoordY(T coordY) requires (N == 2) { v[1] = coordY; }
+
+	T getCoordX() const requires (N == 2) { return v[0]; }
+	T getCoordY() const requires (N == 2) { return v[1]; }
+
+	double lenght() const requires (N == 2) { return norm(); }
+
+	T dotProduct(const VectorN& other) const requires (N == 2) { return dot(other); }
+
+	T crossProduct(const VectorN& other) const requires (N == 2) { return cross(other); }
+
+	// Три вектора плоскости лежат в одной плоскости, поэтому смешанное произведение равно нулю
+	T mixedProduct(const VectorN&, const VectorN&, const VectorN&) const requires (N == 2) { return T(); }
+
+	std::string vectorToString() const requires (N == 2)
+	{
+		return "vector(x= " + std::to_string(v[0]) + ", y= " + std::to_string(v[1]) + ")";
+	}
+};
+
+using Vector2d = VectorN<int, 2>;
+using Vector3d = VectorN<int, 3>;
+using Vector2f = VectorN<float, 2>;
+using Vector4f = VectorN<float, 4>;
+using Vector8f = VectorN<float, 8>;
+using Vector4i = VectorN<int, 4>;
+using Vector8i = VectorN<int, 8>;
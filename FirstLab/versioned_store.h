@@ -0,0 +1,367 @@
+﻿#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "geometry.h"
+
+// Версионное хранилище точек и векторов. Читатель берет снимок за O(1) без блокировок и видит
+// согласованную версию, пока держит его; писатель копирует только измененные куски массивов
+// и публикует новую версию одной атомарной заменой указателя. Старые версии освобождаются по эпохам.
+
+// Эпохи: читатель отмечает в своем слоте эпоху, в которую вошел; версию, убранную в эпоху e,
+// можно удалить, когда в слотах не осталось эпох <= e.
+class EpochReclaimer
+{
+private:
+	static constexpr std::uint64_t idle = UINT64_MAX;
+	static constexpr std::size_t slotCount = 256;
+
+	struct alignas(64) Slot
+	{
+		std::atomic<std::uint64_t> epoch{ idle };
+	};
+
+	struct Retired
+	{
+		std::uint64_t epoch;
+		std::function<void()> destroy;
+	};
+
+	Slot slots[slotCount];
+	std::atomic<std::uint64_t> globalEpoch{ 1 };
+	std::mutex retiredMutex;
+	std::vector<Retired> retired;
+
+public:
+	class Guard
+	{
+	private:
+		std::atomic<std::uint64_t>* slot = nullptr;
+
+	public:
+		Guard() {}
+		explicit Guard(std::atomic<std::uint64_t>* slot) : slot(slot) {}
+		Guard(Guard&& other) noexcept : slot(other.slot) { other.slot = nullptr; }
+
+		Guard& operator=(Guard&& other) noexcept
+		{
+			std::swap(slot, other.slot);
+			return *this;
+		}
+
+		~Guard()
+		{
+			if (slot)
+			{
+				slot->store(idle, std::memory_order_release);
+			}
+		}
+
+		Guard(const Guard&) = delete;
+		Guard& operator=(const Guard&) = delete;
+	};
+
+	EpochReclaimer() {}
+
+	EpochReclaimer(const EpochReclaimer&) = delete;
+	EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+	~EpochReclaimer()
+	{
+		for (Retired& item : retired)
+		{
+			item.destroy();
+		}
+	}
+
+	// Занимает свободный слот; если все заняты (больше slotCount одновременных читателей), ждет
+	Guard pin()
+	{
+		const std::size_t start = std::hash<std::thread::id>()(std::this_thread::get_id());
+		while (true)
+		{
+			for (std::size_t i = 0; i < slotCount; i++)
+			{
+				std::atomic<std::uint64_t>& slot = slots[(start + i) % slotCount].epoch;
+				std::uint64_t expected = idle;
+				if (slot.load(std::memory_order_relaxed) == idle
+					&& slot.compare_exchange_strong(expected, globalEpoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst))
+				{
+					return Guard(&slot);
+				}
+			}
+			std::this_thread::yield();
+		}
+	}
+
+	// Вызывать после того, как объект стал недоступен новым читателям
+	template <class T>
+	void retire(const T* object)
+	{
+		const std::uint64_t epoch = globalEpoch.fetch_add(1, std::memory_order_seq_cst);
+		std::lock_guard<std::mutex> lock(retiredMutex);
+		retired.push_back({ epoch, [object]() { delete object; } });
+	}
+
+	// Удаляет все, что убрано раньше самой старой эпохи активных читателей; возвращает число удаленных
+	std::size_t collect()
+	{
+		std::uint64_t oldest = idle;
+		for (const Slot& slot : slots)
+		{
+			oldest = std::min(oldest, slot.epoch.load(std::memory_order_seq_cst));
+		}
+
+		std::vector<Retired> ready;
+		{
+			std::lock_guard<std::mutex> lock(retiredMutex);
+			std::size_t kept = 0;
+			for (Retired& item : retired)
+			{
+				if (item.epoch < oldest)
+				{
+					ready.push_back(std::move(item));
+				}
+				else
+				{
+					retired[kept++] = std::move(item);
+				}
+			}
+			retired.resize(kept);
+		}
+		for (Retired& item : ready)
+		{
+			item.destroy();
+		}
+		return ready.size();
+	}
+
+	std::size_t pending()
+	{
+		std::lock_guard<std::mutex> lock(retiredMutex);
+		return retired.size();
+	}
+};
+
+// Неизменяемый массив из кусков по ChunkSize элементов. Версии делят общие куски,
+// поэтому новая версия стоит копию таблицы указателей и измененных кусков.
+template <class T, std::size_t ChunkSize = 1024>
+class ChunkedArray
+{
+public:
+	using Chunk = std::array<T, ChunkSize>;
+
+private:
+	std::vector<std::shared_ptr<const Chunk>> chunks;
+	std::size_t count = 0;
+
+	template <class, std::size_t>
+	friend class ChunkedArrayBuilder;
+
+public:
+	std::size_t size() const { return count; }
+
+	const T& operator[](std::size_t i) const { return (*chunks[i / ChunkSize])[i % ChunkSize]; }
+
+	const T& at(std::size_t i) const
+	{
+		if (i >= count)
+		{
+			throw std::out_of_range("Индекс за пределами массива");
+		}
+		return (*this)[i];
+	}
+
+	std::size_t chunkCount() const { return chunks.size(); }
+
+	// Общий ли кусок с другой версией (для диагностики копирования при записи)
+	bool sharesChunk(const ChunkedArray& other, std::size_t chunk) const
+	{
+		return chunk < chunks.size() && chunk < other.chunks.size() && chunks[chunk] == other.chunks[chunk];
+	}
+};
+
+// Изменяемая копия версии: кусок копируется при первой записи в него, остальные остаются общими
+template <class T, std::size_t ChunkSize = 1024>
+class ChunkedArrayBuilder
+{
+private:
+	using Chunk = typename ChunkedArray<T, ChunkSize>::Chunk;
+
+	std::vector<std::shared_ptr<const Chunk>> chunks;
+	std::vector<std::shared_ptr<Chunk>> owned;
+	std::size_t count = 0;
+
+public:
+	ChunkedArrayBuilder() {}
+
+	explicit ChunkedArrayBuilder(const ChunkedArray<T, ChunkSize>& base)
+		: chunks(base.chunks), owned(base.chunks.size()), count(base.count) {}
+
+	std::size_t size() const { return count; }
+
+	const T& operator[](std::size_t i) const { return (*chunks[i / ChunkSize])[i % ChunkSize]; }
+
+	void set(std::size_t i, const T& value)
+	{
+		if (i >= count)
+		{
+			throw std::out_of_range("Индекс за пределами массива");
+		}
+		writable(i / ChunkSize)[i % ChunkSize] = value;
+	}
+
+	void push(const T& value)
+	{
+		if (count % ChunkSize == 0)
+		{
+			chunks.push_back(nullptr);
+			owned.push_back(std::make_shared<Chunk>());
+			chunks.back() = owned.back();
+		}
+		writable(count / ChunkSize)[count % ChunkSize] = value;
+		count++;
+	}
+
+	void resize(std::size_t n)
+	{
+		while (count < n)
+		{
+			push(T());
+		}
+		count = n;
+		const std::size_t needed = (n + ChunkSize - 1) / ChunkSize;
+		chunks.resize(needed);
+		owned.resize(needed);
+	}
+
+	ChunkedArray<T, ChunkSize> build() const
+	{
+		ChunkedArray<T, ChunkSize> result;
+		result.chunks = chunks;
+		result.count = count;
+		return result;
+	}
+
+private:
+	Chunk& writable(std::size_t chunk)
+	{
+		if (!owned[chunk])
+		{
+			owned[chunk] = std::make_shared<Chunk>(*chunks[chunk]);
+			chunks[chunk] = owned[chunk];
+		}
+		return *owned[chunk];
+	}
+};
+
+struct GeometryVersion
+{
+	std::uint64_t number = 0;
+	ChunkedArray<Point2d> points;
+	ChunkedArray<Vector2d> vectors;
+};
+
+class VersionedGeometryStore
+{
+private:
+	std::atomic<const GeometryVersion*> current;
+	EpochReclaimer reclaimer;
+	std::mutex writerMutex;
+
+public:
+	// Согласованное неизменяемое состояние; пока снимок жив, его версия не освобождается
+	class Snapshot
+	{
+	private:
+		EpochReclaimer::Guard guard;
+		const GeometryVersion* version;
+
+	public:
+		Snapshot(EpochReclaimer::Guard guard, const GeometryVersion* version) : guard(std::move(guard)), version(version) {}
+
+		std::uint64_t number() const { return version->number; }
+		const ChunkedArray<Point2d>& points() const { return version->points; }
+		const ChunkedArray<Vector2d>& vectors() const { return version->vectors; }
+	};
+
+	// Изменения одного писателя; видны читателям только после commit()
+	class Writer
+	{
+	private:
+		VersionedGeometryStore& store;
+		std::unique_lock<std::mutex> lock;
+		std::uint64_t base;
+		bool committed = false;
+
+	public:
+		ChunkedArrayBuilder<Point2d> points;
+		ChunkedArrayBuilder<Vector2d> vectors;
+
+		explicit Writer(VersionedGeometryStore& store) : store(store), lock(store.writerMutex)
+		{
+			const GeometryVersion* version = store.current.load(std::memory_order_acquire);
+			base = version->number;
+			points = ChunkedArrayBuilder<Point2d>(version->points);
+			vectors = ChunkedArrayBuilder<Vector2d>(version->vectors);
+		}
+
+		// Публикует версию и освобождает те прежние, которые уже никто не читает; возвращает ее номер
+		std::uint64_t commit()
+		{
+			if (committed)
+			{
+				throw std::logic_error("Версия уже опубликована");
+			}
+			GeometryVersion* version = new GeometryVersion{ base + 1, points.build(), vectors.build() };
+			const GeometryVersion* old = store.current.exchange(version, std::memory_order_seq_cst);
+			store.reclaimer.retire(old);
+			store.reclaimer.collect();
+			committed = true;
+			return version->number;
+		}
+	};
+
+	VersionedGeometryStore() : current(new GeometryVersion()) {}
+
+	VersionedGeometryStore(const VersionedGeometryStore&) = delete;
+	VersionedGeometryStore& operator=(const VersionedGeometryStore&) = delete;
+
+	~VersionedGeometryStore()
+	{
+		delete current.load();
+	}
+
+	Snapshot snapshot()
+	{
+		EpochReclaimer::Guard guard = reclaimer.pin();
+		return Snapshot(std::move(guard), current.load(std::memory_order_seq_cst));
+	}
+
+	// Писатели выстраиваются в очередь друг за другом, читателей это не касается
+	Writer write()
+	{
+		return Writer(*this);
+	}
+
+	std::uint64_t version() const
+	{
+		return current.load(std::memory_order_acquire)->number;
+	}
+
+	// Версии, которые еще ждут ухода читателей
+	std::size_t pendingVersions()
+	{
+		reclaimer.collect();
+		return reclaimer.pending();
+	}
+};
@@ -0,0 +1,377 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+#include "geometry.h"
+#include "convex_hull.h"
+#include "parallel.h"
+#include "trace.h"
+
+// Многоугольник видимости из точки среди отрезков-препятствий (угловой заметающий луч).
+// Все сравнения углов и порядка отрезков - точные, через orientation; вещественные только
+// итоговые вершины, где луч упирается в отрезок. Окно замыкается рамкой, поэтому многоугольник ограничен.
+
+struct Obstacle
+{
+	Point2d from;
+	Point2d to;
+};
+
+struct VisiblePoint
+{
+	double x;
+	double y;
+};
+
+// Препятствия не должны пересекаться (касаться концами можно)
+class VisibilityScene
+{
+private:
+	std::vector<Point2d> vertices;                  // различные концы отрезков
+	std::vector<std::pair<int, int>> segments;      // индексы концов
+	std::vector<std::vector<int>> incident;         // отрезки при каждой вершине
+	int width;
+	int height;
+
+	// Порядок отрезков вдоль луча из q
+	struct Closer
+	{
+		const VisibilityScene* scene;
+		Point2d q;
+
+		bool operator()(int a, int b) const { return scene->closer(q, a, b); }
+	};
+
+public:
+	// Порядок вершин по углу от предыдущей точки обзора. Для близкой точки он почти верен,
+	// поэтому его достаточно поправить вставками вместо полной сортировки
+	class Sweep
+	{
+	private:
+		friend class VisibilityScene;
+		std::vector<int> order;
+		std::vector<int> start;     // конец, с которого луч входит в отрезок, или -1
+		std::vector<std::set<int, Closer>::iterator> positions;
+
+	public:
+		std::size_t resorted = 0;   // сколько раз пришлось сортировать заново
+	};
+
+	VisibilityScene(const std::vector<Obstacle>& obstacles, int width = screenWidth, int height = screenHeight) : width(width), height(height)
+	{
+		if (width <= 1 || height <= 1)
+		{
+			throw std::invalid_argument("Окно слишком мало");
+		}
+		std::vector<Obstacle> all = obstacles;
+		const Point2d corners[4] = { Point2d(0, 0, width, height), Point2d(width - 1, 0, width, height),
+			Point2d(width - 1, height - 1, width, height), Point2d(0, height - 1, width, height) };
+		for (int i = 0; i < 4; i++)
+		{
+			all.push_back({ corners[i], corners[(i + 1) % 4] });
+		}
+
+		// одинаковые концы сливаются, чтобы события в одной точке обрабатывались вместе
+		std::vector<std::pair<long long, int>> keys;
+		for (std::size_t i = 0; i < all.size(); i++)
+		{
+			keys.push_back({ key(all[i].from), static_cast<int>(2 * i) });
+			keys.push_back({ key(all[i].to), static_cast<int>(2 * i + 1) });
+		}
+		std::sort(keys.begin(), keys.end());
+		std::vector<int> vertexOf(keys.size());
+		for (std::size_t k = 0; k < keys.size(); k++)
+		{
+			if (k == 0 || keys[k].first != keys[k - 1].first)
+			{
+				const Obstacle& obstacle = all[keys[k].second / 2];
+				vertices.push_back(keys[k].second % 2 ? obstacle.to : obstacle.from);
+			}
+			vertexOf[keys[k].second] = static_cast<int>(vertices.size()) - 1;
+		}
+		incident.resize(vertices.size());
+		for (std::size_t i = 0; i < all.size(); i++)
+		{
+			const int a = vertexOf[2 * i];
+			const int b = vertexOf[2 * i + 1];
+			if (a == b)
+			{
+				continue;
+			}
+			incident[a].push_back(static_cast<int>(segments.size()));
+			incident[b].push_back(static_cast<int>(segments.size()));
+			segments.push_back({ a, b });
+		}
+	}
+
+	std::size_t segmentCount() const { return segments.size(); }
+
+	// Вершины многоугольника видимости против часовой стрелки. Точка обзора - строго внутри окна
+	std::vector<VisiblePoint> visibility(const Point2d& viewpoint) const
+	{
+		Sweep sweep;
+		return visibility(viewpoint, sweep);
+	}
+
+	// То же с переиспользованием углового порядка от прошлого вызова с этим sweep
+	std::vector<VisiblePoint> visibility(const Point2d& viewpoint, Sweep& sweep) const
+	{
+		if (viewpoint.getX() <= 0 || viewpoint.getY() <= 0 || viewpoint.getX() >= width - 1 || viewpoint.getY() >= height - 1)
+		{
+			throw std::invalid_argument("Точка обзора должна быть строго внутри окна");
+		}
+		sortByAngle(viewpoint, sweep);
+
+		// отрезок ориентируется так, чтобы луч, вращаясь против часовой стрелки, входил в него в start
+		sweep.start.assign(segments.size(), -1);
+		for (std::size_t s = 0; s < segments.size(); s++)
+		{
+			const long long turn = orientation(viewpoint, vertices[segments[s].first], vertices[segments[s].second]);
+			if (turn != 0)
+			{
+				sweep.start[s] = turn > 0 ? segments[s].first : segments[s].second;
+			}
+		}
+
+		// активные отрезки упорядочены по расстоянию вдоль текущего луча
+		std::set<int, Closer> active(Closer{ this, viewpoint });
+		sweep.positions.assign(segments.size(), active.end());
+		for (std::size_t s = 0; s < segments.size(); s++)
+		{
+			// отрезки, которые уже пересекает начальный луч (направление +x)
+			if (sweep.start[s] >= 0 && angleLess(viewpoint, vertices[endOf(s, sweep)], vertices[sweep.start[s]]))
+			{
+				sweep.positions[s] = active.insert(static_cast<int>(s)).first;
+			}
+		}
+
+		std::vector<VisiblePoint> polygon;
+		std::size_t i = 0;
+		// точка обзора, совпавшая с концом отрезка, не задает направления; такая вершина сортируется первой
+		while (i < sweep.order.size() && same(vertices[sweep.order[i]], viewpoint))
+		{
+			i++;
+		}
+		while (i < sweep.order.size())
+		{
+			// все вершины на одном луче обрабатываются вместе
+			std::size_t j = i;
+			while (j < sweep.order.size() && sameAngle(viewpoint, vertices[sweep.order[i]], vertices[sweep.order[j]]))
+			{
+				j++;
+			}
+			const int before = active.empty() ? -1 : *active.begin();
+			for (std::size_t k = i; k < j; k++)
+			{
+				for (int s : incident[sweep.order[k]])
+				{
+					if (sweep.start[s] >= 0 && endOf(s, sweep) == sweep.order[k] && sweep.positions[s] != active.end())
+					{
+						active.erase(sweep.positions[s]);
+						sweep.positions[s] = active.end();
+					}
+				}
+			}
+			for (std::size_t k = i; k < j; k++)
+			{
+				for (int s : incident[sweep.order[k]])
+				{
+					if (sweep.start[s] == sweep.order[k] && sweep.positions[s] == active.end())
+					{
+						sweep.positions[s] = active.insert(s).first;
+					}
+				}
+			}
+			const int after = active.empty() ? -1 : *active.begin();
+			if (before != after)
+			{
+				const Point2d& ray = vertices[sweep.order[i]];
+				if (before >= 0)
+				{
+					push(polygon, hit(viewpoint, ray, before));
+				}
+				if (after >= 0)
+				{
+					push(polygon, hit(viewpoint, ray, after));
+				}
+			}
+			i = j;
+		}
+		while (polygon.size() > 1 && polygon.front().x == polygon.back().x && polygon.front().y == polygon.back().y)
+		{
+			polygon.pop_back();
+		}
+		return polygon;
+	}
+
+	// Многоугольники для многих точек обзора. Точки упорядочиваются полосами, чтобы соседние
+	// запросы одного потока были близко и угловой порядок почти не менялся
+	std::vector<std::vector<VisiblePoint>> visibilityBatch(const std::vector<Point2d>& viewpoints, unsigned workers = workerCount()) const
+	{
+		TRACE_SCOPE("visibilityBatch", "geometry");
+		std::vector<int> order(viewpoints.size());
+		for (std::size_t i = 0; i < order.size(); i++)
+		{
+			order[i] = static_cast<int>(i);
+		}
+		std::sort(order.begin(), order.end(), [&viewpoints](int a, int b)
+		{
+			const int bandA = viewpoints[a].getY() / 32;
+			const int bandB = viewpoints[b].getY() / 32;
+			if (bandA != bandB)
+			{
+				return bandA < bandB;
+			}
+			// змейкой, чтобы на границе полос не было скачка через все окно
+			return bandA % 2 ? viewpoints[a].getX() > viewpoints[b].getX() : viewpoints[a].getX() < viewpoints[b].getX();
+		});
+
+		std::vector<std::vector<VisiblePoint>> result(viewpoints.size());
+		parallelFor(order.size(), [this, &order, &viewpoints, &result](unsigned, std::size_t begin, std::size_t end)
+		{
+			Sweep sweep;
+			for (std::size_t k = begin; k < end; k++)
+			{
+				result[order[k]] = visibility(viewpoints[order[k]], sweep);
+			}
+		}, workers);
+		return result;
+	}
+
+private:
+	static long long key(const Point2d& p)
+	{
+		return static_cast<long long>(p.getX()) << 32 | static_cast<unsigned>(p.getY());
+	}
+
+	int endOf(std::size_t s, const Sweep& sweep) const
+	{
+		return sweep.start[s] == segments[s].first ? segments[s].second : segments[s].first;
+	}
+
+	// Нижняя полуплоскость (и луч -x) идет после верхней: углы отсчитываются от +x против часовой стрелки
+	static bool lowerHalf(const Point2d& q, const Point2d& p)
+	{
+		const int dy = p.getY() - q.getY();
+		return dy < 0 || (dy == 0 && p.getX() < q.getX());
+	}
+
+	static bool angleLess(const Point2d& q, const Point2d& a, const Point2d& b)
+	{
+		if (same(a, q) || same(b, q))
+		{
+			return same(a, q) && !same(b, q);
+		}
+		const bool lowerA = lowerHalf(q, a);
+		const bool lowerB = lowerHalf(q, b);
+		if (lowerA != lowerB)
+		{
+			return lowerB;
+		}
+		return orientation(q, a, b) > 0;
+	}
+
+	static bool sameAngle(const Point2d& q, const Point2d& a, const Point2d& b)
+	{
+		return lowerHalf(q, a) == lowerHalf(q, b) && orientation(q, a, b) == 0;
+	}
+
+	void sortByAngle(const Point2d& q, Sweep& sweep) const
+	{
+		if (sweep.order.size() != vertices.size())
+		{
+			sweep.order.clear();
+			for (std::size_t v = 0; v < vertices.size(); v++)
+			{
+				sweep.order.push_back(static_cast<int>(v));
+			}
+		}
+
+		// вставками, пока перестановок немного; иначе - полная сортировка
+		auto less = [this, &q](int a, int b) { return angleLess(q, vertices[a], vertices[b]); };
+		const std::size_t budget = 8 * sweep.order.size();
+		std::size_t moves = 0;
+		for (std::size_t i = 1; i < sweep.order.size() && moves <= budget; i++)
+		{
+			const int item = sweep.order[i];
+			std::size_t j = i;
+			while (j > 0 && less(item, sweep.order[j - 1]))
+			{
+				sweep.order[j] = sweep.order[j - 1];
+				j--;
+				moves++;
+			}
+			sweep.order[j] = item;
+		}
+		if (moves > budget)
+		{
+			std::sort(sweep.order.begin(), sweep.order.end(), less);
+			sweep.resorted++;
+		}
+	}
+
+	// Ближе ли отрезок a к q, чем b, вдоль общего луча. Отрезки не пересекаются, поэтому один из них
+	// целиком лежит по одну сторону от прямой другого
+	bool closer(const Point2d& q, int a, int b) const
+	{
+		if (a == b)
+		{
+			return false;
+		}
+		const Point2d& a0 = vertices[segments[a].first];
+		const Point2d& a1 = vertices[segments[a].second];
+		const Point2d& b0 = vertices[segments[b].first];
+		const Point2d& b1 = vertices[segments[b].second];
+
+		const long long s0 = orientation(b0, b1, a0);
+		const long long s1 = orientation(b0, b1, a1);
+		if ((s0 >= 0 && s1 >= 0) || (s0 <= 0 && s1 <= 0))
+		{
+			const long long side = s0 != 0 ? s0 : s1;
+			const long long viewer = orientation(b0, b1, q);
+			if (side != 0)
+			{
+				return (side > 0) == (viewer > 0);
+			}
+		}
+		const long long t0 = orientation(a0, a1, b0);
+		const long long t1 = orientation(a0, a1, b1);
+		const long long side = t0 != 0 ? t0 : t1;
+		const long long viewer = orientation(a0, a1, q);
+		return side != 0 && (side > 0) != (viewer > 0);
+	}
+
+	// Точка, где луч из q через ray встречает прямую отрезка s
+	VisiblePoint hit(const Point2d& q, const Point2d& ray, int s) const
+	{
+		const Point2d& a = vertices[segments[s].first];
+		const Point2d& b = vertices[segments[s].second];
+		if (same(ray, a) || same(ray, b))
+		{
+			return { static_cast<double>(ray.getX()), static_cast<double>(ray.getY()) };
+		}
+		const double dx = ray.getX() - q.getX();
+		const double dy = ray.getY() - q.getY();
+		const double ex = b.getX() - a.getX();
+		const double ey = b.getY() - a.getY();
+		const double t = ((a.getX() - q.getX()) * ey - (a.getY() - q.getY()) * ex) / (dx * ey - dy * ex);
+		return { q.getX() + dx * t, q.getY() + dy * t };
+	}
+
+	static bool same(const Point2d& a, const Point2d& b)
+	{
+		return a.getX() == b.getX() && a.getY() == b.getY();
+	}
+
+	static void push(std::vector<VisiblePoint>& polygon, const VisiblePoint& p)
+	{
+		if (polygon.empty() || polygon.back().x != p.x || polygon.back().y != p.y)
+		{
+			polygon.push_back(p);
+		}
+	}
+};
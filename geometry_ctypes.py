@@ -0,0 +1,135 @@
+import ctypes
+import os
+import sys
+from array import array
+from typing import Sequence, Tuple
+
+# Обертка над библиотекой geometry_c (цель CMake в FirstLab) через ctypes.
+# Массивы array('i') / array('q') / array('d') передаются в библиотеку без копирования;
+# координаты - array('i'), массив другого типа или длины отвергается до вызова библиотеки.
+
+
+def _library_name() -> str:
+    if sys.platform.startswith("win"):
+        return "geometry_c.dll"
+    if sys.platform == "darwin":
+        return "libgeometry_c.dylib"
+    return "libgeometry_c.so"
+
+
+def load_library(path: str = None) -> ctypes.CDLL:
+    """Загружает библиотеку по пути из аргумента, переменной GEOMETRY_C_LIBRARY или по имени"""
+    path = path or os.environ.get("GEOMETRY_C_LIBRARY") or _library_name()
+    lib = ctypes.CDLL(path)
+
+    i32p = ctypes.POINTER(ctypes.c_int32)
+    i64p = ctypes.POINTER(ctypes.c_int64)
+    f64p = ctypes.POINTER(ctypes.c_double)
+    size = ctypes.c_size_t
+
+    lib.geometry_api_version.restype = ctypes.c_int32
+    lib.geometry_api_version.argtypes = []
+    for name in ("geometry_dot", "geometry_cross"):
+        func = getattr(lib, name)
+        func.restype = ctypes.c_int32
+        func.argtypes = [i32p, i32p, i32p, i32p, i64p, size]
+    lib.geometry_length.restype = ctypes.c_int32
+    lib.geometry_length.argtypes = [i32p, i32p, f64p, size]
+    lib.geometry_clip.restype = ctypes.c_int32
+    lib.geometry_clip.argtypes = [i32p, i32p, size, ctypes.c_int32, ctypes.c_int32, ctypes.c_int32, ctypes.c_int32,
+                                  i32p, i32p, ctypes.POINTER(size)]
+    lib.geometry_transform.restype = ctypes.c_int32
+    lib.geometry_transform.argtypes = [i32p, i32p, f64p, f64p, f64p, size]
+
+    if lib.geometry_api_version() != 1:
+        raise RuntimeError("Unsupported geometry_c API version")
+    return lib
+
+
+def _pointer(buffer: array, ctype):
+    """Указатель на память массива без копирования; тип элементов должен совпадать с ctype"""
+    floating = ctype in (ctypes.c_float, ctypes.c_double)
+    if not isinstance(buffer, array):
+        raise TypeError("Expected array.array, got " + type(buffer).__name__)
+    if buffer.itemsize != ctypes.sizeof(ctype) or buffer.typecode not in ("fd" if floating else "bhilq"):
+        raise TypeError(f"array('{buffer.typecode}') does not match {ctype.__name__}")
+    if len(buffer) == 0:
+        return ctypes.cast(None, ctypes.POINTER(ctype))
+    return ctypes.cast((ctype * len(buffer)).from_buffer(buffer), ctypes.POINTER(ctype))
+
+
+def _same_length(*arrays: array) -> int:
+    n = len(arrays[0])
+    if any(len(a) != n for a in arrays):
+        raise ValueError("All coordinate arrays must have the same length")
+    return n
+
+
+def _check(status: int) -> None:
+    if status != 0:
+        raise ValueError(f"geometry_c error {status}")
+
+
+class GeometryBatch:
+    """Пакетные операции над векторами в раскладке SoA"""
+
+    def __init__(self, library: ctypes.CDLL = None):
+        self._lib = library or load_library()
+
+    def _pair(self, ax: array, ay: array, bx: array, by: array, func) -> array:
+        n = _same_length(ax, ay, bx, by)
+        out = array('q', bytes(8 * n))
+        i32 = ctypes.c_int32
+        _check(func(_pointer(ax, i32), _pointer(ay, i32), _pointer(bx, i32), _pointer(by, i32),
+                    _pointer(out, ctypes.c_int64), n))
+        return out
+
+    def dot(self, ax: array, ay: array, bx: array, by: array) -> array:
+        return self._pair(ax, ay, bx, by, self._lib.geometry_dot)
+
+    def cross(self, ax: array, ay: array, bx: array, by: array) -> array:
+        return self._pair(ax, ay, bx, by, self._lib.geometry_cross)
+
+    def length(self, x: array, y: array) -> array:
+        n = _same_length(x, y)
+        out = array('d', bytes(8 * n))
+        _check(self._lib.geometry_length(_pointer(x, ctypes.c_int32), _pointer(y, ctypes.c_int32),
+                                         _pointer(out, ctypes.c_double), n))
+        return out
+
+    def clip(self, x: array, y: array, x0: int, y0: int, x1: int, y1: int) -> Tuple[array, array]:
+        n = _same_length(x, y)
+        out_x = array('i', bytes(4 * n))
+        out_y = array('i', bytes(4 * n))
+        kept = ctypes.c_size_t(0)
+        i32 = ctypes.c_int32
+        _check(self._lib.geometry_clip(_pointer(x, i32), _pointer(y, i32), n, x0, y0, x1, y1,
+                                       _pointer(out_x, i32), _pointer(out_y, i32), ctypes.byref(kept)))
+        return out_x[:kept.value], out_y[:kept.value]
+
+    def transform(self, x: array, y: array, matrix: Sequence[float]) -> Tuple[array, array]:
+        m = array('d', matrix)
+        if len(m) != 6:
+            raise ValueError("Matrix must have 6 elements: a, b, tx, c, d, ty")
+        n = _same_length(x, y)
+        out_x = array('d', bytes(8 * n))
+        out_y = array('d', bytes(8 * n))
+        f64 = ctypes.c_double
+        _check(self._lib.geometry_transform(_pointer(x, ctypes.c_int32), _pointer(y, ctypes.c_int32), _pointer(m, f64),
+                                            _pointer(out_x, f64), _pointer(out_y, f64), n))
+        return out_x, out_y
+
+
+def main():
+    batch = GeometryBatch()
+    ax, ay = array('i', [3, 1, 0]), array('i', [4, 2, 5])
+    bx, by = array('i', [1, 2, 3]), array('i', [0, 1, 1])
+    print(f"dot = {list(batch.dot(ax, ay, bx, by))}")
+    print(f"cross = {list(batch.cross(ax, ay, bx, by))}")
+    print(f"length = {list(batch.length(ax, ay))}")
+    print(f"clip = {batch.clip(ax, ay, 0, 0, 2, 4)}")
+    print(f"transform = {batch.transform(ax, ay, [1, 0, 10, 0, 1, 20])}")
+
+
+if __name__ == "__main__":
+    main()